@@ -16,11 +16,16 @@ linux {
 HEADERS += \
     $$PWD/applicationmonitor.h \
     $$PWD/applicationmonitor_p.h \
+    $$PWD/binarylog.h \
+    $$PWD/binarylog_p.h \
     $$PWD/bitmaptext_p.h \
     $$PWD/bitmaptextfont_p.h \
     $$PWD/events.h \
     $$PWD/events_p.h \
+    $$PWD/eventqueue_p.h \
+    $$PWD/flightrecorder_p.h \
     $$PWD/gputimer_p.h \
+    $$PWD/histogram_p.h \
     $$PWD/logger.h \
     $$PWD/logger_p.h \
     $$PWD/overlay_p.h \
@@ -29,9 +34,13 @@ HEADERS += \
 
 SOURCES += \
     $$PWD/applicationmonitor.cpp \
+    $$PWD/binarylog.cpp \
     $$PWD/bitmaptext.cpp \
     $$PWD/events.cpp \
+    $$PWD/eventqueue.cpp \
+    $$PWD/flightrecorder.cpp \
     $$PWD/gputimer.cpp \
+    $$PWD/histogram.cpp \
     $$PWD/logger.cpp \
     $$PWD/overlay.cpp \
     $$PWD/ubuntumetricsglobal.cpp
@@ -17,26 +17,71 @@
 
 #include "applicationmonitor_p.h"
 
+#include <atomic>
+#if defined(Q_OS_UNIX)
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#endif
+#if defined(Q_OS_LINUX)
+#include <sys/syscall.h>
+#endif
+
+#include <QtCore/QSocketNotifier>
 #include <QtCore/QTimer>
+#include <QtCore/private/qabstractanimation_p.h>
 #include <QtGui/QGuiApplication>
+#include <QtGui/QScreen>
 #include <QtQuick/QQuickWindow>
+#include <QtQuick/private/qquickitem_p.h>
+#include <QtQuick/private/qquickwindow_p.h>
 
 // FIXME(loicm) When a monitored window is destroyed and if there's a window
 //     that's not monitored because the max count was reached, enable monitoring
 //     on it if possible.
 
-const int logQueueSize = 16;
-const int logQueueAlignment = 64;
+const int logBatchSize = 64;
+const int logBatchAlignment = 64;
+
+// Maximum time in milliseconds the logging thread waits for new events. A
+// producer never blocks to wake up the logging thread, in the rare case the
+// wake-up is missed, events are logged after that delay.
+const unsigned long logWaitTimeout = 100;
+
+// Maximum time in nanoseconds a flight recorder dump waits for a frame rendered
+// after the request.
+const quint64 dumpTimeout = Q_UINT64_C(500000000);
+
+// Minimum time in milliseconds between two asynchronous flight recorder dumps.
+const qint64 dumpInterval = 5000;
 
-LoggingThread::LoggingThread()
-    : m_loggerCount(0)
+LoggingThread::LoggingThread(
+    int queueCapacity, UMApplicationMonitor::QueuePolicy queuePolicy,
+    QAtomicInteger<quint32>* droppedEventCount, FlightRecorder* flightRecorder)
+    : m_sharedQueue(queueCapacity)
+#if !defined(QT_NO_DEBUG)
+    , m_queues{}
+#endif
+    , m_flightRecorder(flightRecorder->ref())
+    , m_droppedEventCount(droppedEventCount)
+    , m_queueCapacity(queueCapacity)
+    , m_queueCount(0)
+    , m_loggerCount(0)
+    , m_queuePolicy(queuePolicy)
     , m_refCount(1)
-    , m_queueIndex(0)
-    , m_queueSize(0)
+    , m_waiting(0)
+    , m_releasedQueues(0)
+    , m_dumpDuration(0)
+    , m_dumpTimeStamp(0)
     , m_flags(0)
 {
-    m_queue = static_cast<UMEvent*>(
-        alignedAlloc(logQueueAlignment, logQueueSize * sizeof(UMEvent)));
+    DASSERT(droppedEventCount);
+    DASSERT(flightRecorder);
+
+    m_batch = static_cast<UMEvent*>(
+        alignedAlloc(logBatchAlignment, logBatchSize * sizeof(UMEvent)));
 
 #if !defined(QT_NO_DEBUG)
     setObjectName(QStringLiteral("UbuntuMetrics logging"));  // Thread name.
@@ -48,75 +93,202 @@ LoggingThread::~LoggingThread()
 {
     m_mutex.lock();
     m_flags |= JoinRequested;
-    if (m_flags & Waiting) {
-        m_condition.wakeOne();
-    }
+    m_condition.wakeOne();
     m_mutex.unlock();
     wait();
 
-    free(m_queue);
-}
-
-#define BREAK_ON_JOIN_REQUEST()                \
-    if (Q_UNLIKELY(m_flags & JoinRequested)) { \
-        m_mutex.unlock();                      \
-        break;                                 \
+    for (int i = 0; i < m_queueCount; ++i) {
+        delete m_queues[i];
     }
+    free(m_batch);
+    m_flightRecorder->deref();
+}
 
 // Logging thread entry point.
 void LoggingThread::run()
 {
     DLOG("Entering logging thread.");
+    UMEventUtils::registerThread(UMProcessEvent::LoggingThread);
+    quint64 latestFrameTimeStamp = 0;
     while (true) {
-        // Wait for new events in the log queue.
+        // Get a snapshot of the queues.
         m_mutex.lock();
-        DASSERT(m_queueSize >= 0);
-        if (m_queueSize == 0) {
-            BREAK_ON_JOIN_REQUEST();
-            m_flags |= Waiting;
-            m_condition.wait(&m_mutex);
-            if (m_queueSize == 0) {
-                BREAK_ON_JOIN_REQUEST();
+        const int queueCount = m_queueCount;
+        const quint32 releasedQueues = m_releasedQueues;
+        EventQueue* queues[maxQueues];
+        memcpy(queues, m_queues, queueCount * sizeof(EventQueue*));
+        m_mutex.unlock();
+
+        // Unqueue the pending events of all the queues and log them by batches.
+        int eventCount = 0;
+        int count;
+        do {
+            count = m_sharedQueue.pop(m_batch, logBatchSize);
+            for (int i = 0; i < queueCount && count < logBatchSize; ++i) {
+                count += queues[i]->pop(&m_batch[count], logBatchSize - count);
             }
-            m_flags &= ~Waiting;
+            if (count > 0) {
+                for (int i = 0; i < count; ++i) {
+                    if (m_batch[i].type == UMEvent::Frame) {
+                        latestFrameTimeStamp = qMax(latestFrameTimeStamp, m_batch[i].timeStamp);
+                    }
+                }
+                m_flightRecorder->record(m_batch, count);
+                m_loggersMutex.lock();
+                for (int i = 0; i < m_loggerCount; ++i) {
+                    m_loggers[i]->log(m_batch, count);
+                }
+                m_loggersMutex.unlock();
+                eventCount += count;
+            }
+        } while (count == logBatchSize);
+
+        // Delete the queues released before the snapshot, they've been drained
+        // and can't be pushed to anymore.
+        if (releasedQueues) {
+            m_mutex.lock();
+            for (int i = m_queueCount - 1; i >= 0; --i) {
+                if (releasedQueues & (1u << i)) {
+                    delete m_queues[i];
+                    m_queueCount--;
+                    if (i < m_queueCount) {
+                        memmove(&m_queues[i], &m_queues[i+1],
+                                (m_queueCount - i) * sizeof(EventQueue*));
+                    }
+#if !defined(QT_NO_DEBUG)
+                    m_queues[m_queueCount] = nullptr;
+#endif
+                }
+            }
+            // Queue indices have changed, shift the remaining released bits.
+            quint32 remainingReleasedQueues = 0;
+            for (int i = 0, j = 0; i < maxQueues; ++i) {
+                if (!(releasedQueues & (1u << i))) {
+                    if (m_releasedQueues & (1u << i)) {
+                        remainingReleasedQueues |= 1u << j;
+                    }
+                    j++;
+                }
+            }
+            m_releasedQueues = remainingReleasedQueues;
+            m_mutex.unlock();
         }
 
-        // Unqueue oldest events from the log queue.
-        DASSERT(m_queueSize > 0);
-        UMEvent event;
-        memcpy(&event, &m_queue[m_queueIndex], sizeof(UMEvent));
-        m_queueIndex = (m_queueIndex + 1) % logQueueSize;
-        m_queueSize--;
-
-        // Log.
-        const int loggerCount = m_loggerCount;
-        UMLogger* loggers[UMApplicationMonitorPrivate::maxLoggers];
-        memcpy(loggers, m_loggers, loggerCount * sizeof(UMLogger*));
-        m_mutex.unlock();
-        for (int i = 0; i < loggerCount; ++i) {
-            loggers[i]->log(event);
+        processDumpRequest(latestFrameTimeStamp);
+
+        // Wait for new events.
+        if (eventCount == 0) {
+            m_mutex.lock();
+            if (Q_UNLIKELY(m_flags & JoinRequested)) {
+                m_mutex.unlock();
+                break;
+            }
+            m_waiting.storeRelease(1);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (!hasPendingEvents()) {
+                m_condition.wait(&m_mutex, logWaitTimeout);
+            }
+            m_waiting.storeRelease(0);
+            m_mutex.unlock();
         }
     }
+    UMEventUtils::unregisterThread();
     DLOG("Leaving logging thread.");
 }
 
+// Must be called with m_mutex locked.
+bool LoggingThread::hasPendingEvents()
+{
+    if (!m_sharedQueue.isEmpty() || m_releasedQueues) {
+        return true;
+    }
+    for (int i = 0; i < m_queueCount; ++i) {
+        if (!m_queues[i]->isEmpty()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void LoggingThread::wakeUp()
+{
+    // Only wake up the logging thread if it's waiting. In order not to block
+    // the caller, the lock is just tried, a missed wake-up only delays logging
+    // by logWaitTimeout.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_waiting.loadAcquire()) {
+        if (m_mutex.tryLock()) {
+            m_condition.wakeOne();
+            m_mutex.unlock();
+        }
+    }
+}
+
 void LoggingThread::push(const UMEvent* event)
 {
-    // Ensure the log queue is not full.
-    m_mutex.lock();
-    DASSERT(m_queueSize <= logQueueSize);
-    while (m_queueSize == logQueueSize) {
-        m_mutex.unlock();
-        QThread::yieldCurrentThread();
-        m_mutex.lock();
+    DASSERT(event);
+
+    if (Q_UNLIKELY(!m_sharedQueue.push(*event))) {
+        if (m_queuePolicy == UMApplicationMonitor::DropWhenFull) {
+            m_droppedEventCount->ref();
+            return;
+        }
+        do {
+            wakeUp();
+            QThread::yieldCurrentThread();
+        } while (!m_sharedQueue.push(*event));
     }
+    wakeUp();
+}
 
-    // Push event to the log queue.
-    DASSERT(m_queueSize < logQueueSize);
-    memcpy(&m_queue[(m_queueIndex + m_queueSize++) % logQueueSize], event, sizeof(UMEvent));
-    if (m_flags & Waiting) {
-        m_condition.wakeOne();
+void LoggingThread::push(EventQueue* queue, const UMEvent* event)
+{
+    DASSERT(event);
+
+    if (Q_UNLIKELY(!queue)) {
+        push(event);
+        return;
+    }
+    if (Q_UNLIKELY(!queue->push(*event))) {
+        if (m_queuePolicy == UMApplicationMonitor::DropWhenFull) {
+            m_droppedEventCount->ref();
+            return;
+        }
+        do {
+            wakeUp();
+            QThread::yieldCurrentThread();
+        } while (!queue->push(*event));
     }
+    wakeUp();
+}
+
+EventQueue* LoggingThread::createQueue()
+{
+    QMutexLocker locker(&m_mutex);
+    if (m_queueCount < maxQueues) {
+        EventQueue* queue = new EventQueue(m_queueCapacity);
+        m_queues[m_queueCount++] = queue;
+        return queue;
+    } else {
+        DWARN("ApplicationMonitor: Can't create more than %d logging queues.", maxQueues);
+        return nullptr;
+    }
+}
+
+void LoggingThread::releaseQueue(EventQueue* queue)
+{
+    if (!queue) {
+        return;
+    }
+
+    m_mutex.lock();
+    for (int i = 0; i < m_queueCount; ++i) {
+        if (m_queues[i] == queue) {
+            m_releasedQueues |= 1u << i;
+            break;
+        }
+    }
+    m_condition.wakeOne();
     m_mutex.unlock();
 }
 
@@ -125,11 +297,47 @@ void LoggingThread::setLoggers(UMLogger** loggers, int count)
     DASSERT(count >= 0);
     DASSERT(count <= UMApplicationMonitorPrivate::maxLoggers);
 
-    QMutexLocker locker(&m_mutex);
+    QMutexLocker locker(&m_loggersMutex);
     memcpy(m_loggers, loggers, count * sizeof(UMLogger*));
     m_loggerCount = count;
 }
 
+void LoggingThread::requestDump(const QString& fileName, quint64 duration)
+{
+    QMutexLocker locker(&m_mutex);
+    m_dumpFileName = fileName;
+    m_dumpDuration = duration;
+    m_dumpTimeStamp = UMEventUtils::timeStamp();
+    m_flags |= DumpRequested;
+    m_condition.wakeOne();
+}
+
+// Called by the logging thread after draining the queues. Frames are completed
+// in order, so once a frame time stamped after the request has been recorded,
+// the frames that were waiting for their GPU time have been recorded too.
+void LoggingThread::processDumpRequest(quint64 latestFrameTimeStamp)
+{
+    m_mutex.lock();
+    if (!(m_flags & DumpRequested)
+        || (latestFrameTimeStamp < m_dumpTimeStamp
+            && UMEventUtils::timeStamp() - m_dumpTimeStamp < dumpTimeout)) {
+        m_mutex.unlock();
+        return;
+    }
+    m_flags &= ~DumpRequested;
+    const QString fileName = m_dumpFileName;
+    const quint64 duration = m_dumpDuration;
+    m_mutex.unlock();
+
+    if (m_flightRecorder->dump(fileName, duration)) {
+        LOG("ApplicationMonitor: Flight recorder dumped to '%s'.",
+            fileName.toLocal8Bit().constData());
+    } else {
+        WARN("ApplicationMonitor: Can't dump flight recorder to '%s'.",
+             fileName.toLocal8Bit().constData());
+    }
+}
+
 LoggingThread* LoggingThread::ref()
 {
     m_refCount.ref();
@@ -147,6 +355,32 @@ void LoggingThread::deref()
     }
 }
 
+#if defined(Q_OS_UNIX)
+// Signal handlers can't do much, the signal is forwarded to the GUI thread
+// through a pipe. The handler installed before is chained so that the
+// application still gets the signal.
+static int flightRecorderPipe[2] = { -1, -1 };
+static struct sigaction previousFlightRecorderAction;
+
+static void flightRecorderSignalHandler(int signal, siginfo_t* info, void* context)
+{
+    const int savedErrno = errno;
+    const char c = 0;
+    const ssize_t size = write(flightRecorderPipe[1], &c, 1);
+    Q_UNUSED(size);
+    errno = savedErrno;
+
+    if (previousFlightRecorderAction.sa_flags & SA_SIGINFO) {
+        if (previousFlightRecorderAction.sa_sigaction) {
+            previousFlightRecorderAction.sa_sigaction(signal, info, context);
+        }
+    } else if (previousFlightRecorderAction.sa_handler != SIG_DFL
+               && previousFlightRecorderAction.sa_handler != SIG_IGN) {
+        previousFlightRecorderAction.sa_handler(signal);
+    }
+}
+#endif
+
 UMApplicationMonitor* UMApplicationMonitor::self = nullptr;
 
 UMApplicationMonitor::UMApplicationMonitor()
@@ -163,9 +397,17 @@ UMApplicationMonitorPrivate::UMApplicationMonitorPrivate(UMApplicationMonitor* a
     , m_loggers{}
 #endif
     , m_loggingThread(nullptr)
+    , m_flightRecorder(new FlightRecorder)
+    , m_flightRecorderNotifier(nullptr)
     , m_monitorCount(0)
     , m_loggerCount(0)
-    , m_updateInterval{1000, -1, -1}
+    , m_updateInterval{1000, -1, -1, -1, -1, -1, -1}
+    , m_longFrameBudget(-1)
+    , m_queueCapacity(defaultQueueCapacity)
+    , m_queuePolicy(UMApplicationMonitor::DropWhenFull)
+    , m_droppedEventCount(0)
+    , m_flightRecorderDuration(-1)
+    , m_flightRecorderSignal(0)
     , m_flags(UMApplicationMonitor::AllEvents)
 {
     Q_Q(UMApplicationMonitor);
@@ -194,6 +436,13 @@ UMApplicationMonitorPrivate::~UMApplicationMonitorPrivate()
 {
     DASSERT(!(m_flags & Started));
 
+#if defined(Q_OS_UNIX)
+    if (m_flightRecorderSignal != 0) {
+        sigaction(m_flightRecorderSignal, &previousFlightRecorderAction, nullptr);
+    }
+#endif
+    m_flightRecorder->deref();
+
     // Note that there's no need to disconnect from QGuiApplication signals
     // since the application monitor instance is automatically destroyed when
     // the application is destroyed (parenting), the application instance would
@@ -234,30 +483,55 @@ void UMApplicationMonitor::setLogging(bool logging)
 {
     Q_D(UMApplicationMonitor);
 
-    if (!!(d->m_flags & UMApplicationMonitorPrivate::Logging) != logging) {
+    if (!!(d->m_flags & UMApplicationMonitorPrivate::LoggersEnabled) != logging) {
         if (logging) {
-            d->m_flags |= UMApplicationMonitorPrivate::Logging;
-            if (!(d->m_flags & (UMApplicationMonitorPrivate::Started
-                                | UMApplicationMonitorPrivate::ClosingDown))) {
-                d->start();
+            d->m_flags |= UMApplicationMonitorPrivate::LoggersEnabled;
+        } else {
+            d->m_flags &= ~UMApplicationMonitorPrivate::LoggersEnabled;
+        }
+        d->updateLogging();
+        Q_EMIT loggingChanged();
+    }
+}
+
+bool UMApplicationMonitor::logging()
+{
+    return !!(d_func()->m_flags & UMApplicationMonitorPrivate::LoggersEnabled);
+}
+
+// Events are pushed to the logging thread as long as the loggers or the flight
+// recorder are enabled, the loggers being fed only when enabled.
+void UMApplicationMonitorPrivate::updateLogging()
+{
+    const bool logging = !!(m_flags & (LoggersEnabled | FlightRecording));
+    if (!!(m_flags & Logging) != logging) {
+        if (logging) {
+            m_flags |= Logging;
+            if (!(m_flags & (Started | ClosingDown))) {
+                start();
             } else {
-                d->setMonitoringFlags(d->m_flags);
+                setMonitoringFlags(m_flags);
             }
         } else {
-            d->m_flags &= ~UMApplicationMonitorPrivate::Logging;
-            if (!(d->m_flags & UMApplicationMonitorPrivate::Overlay)) {
-                d->stop();
+            m_flags &= ~Logging;
+            if (!(m_flags & Overlay)) {
+                if (m_flags & Started) {
+                    stop();
+                }
             } else {
-                d->setMonitoringFlags(d->m_flags);
+                setMonitoringFlags(m_flags);
             }
         }
-        Q_EMIT loggingChanged();
     }
+    updateLoggers();
 }
 
-bool UMApplicationMonitor::logging()
+void UMApplicationMonitorPrivate::updateLoggers()
 {
-    return !!(d_func()->m_flags & UMApplicationMonitorPrivate::Logging);
+    if (m_flags & Started) {
+        DASSERT(m_loggingThread);
+        m_loggingThread->setLoggers(m_loggers, (m_flags & LoggersEnabled) ? m_loggerCount : 0);
+    }
 }
 
 void UMApplicationMonitorPrivate::startMonitoring(QQuickWindow* window)
@@ -271,6 +545,9 @@ void UMApplicationMonitorPrivate::startMonitoring(QQuickWindow* window)
         m_monitors[m_monitorCount] =
             new WindowMonitor(q_func(), window, m_loggingThread->ref(), m_flags, ++id);
         m_monitors[m_monitorCount]->setProcessEvent(m_processEvent);
+        m_monitors[m_monitorCount]->setFrameSummaryInterval(
+            m_updateInterval[UMEvent::FrameSummary]);
+        m_monitors[m_monitorCount]->setLongFrameBudget(m_longFrameBudget);
         m_monitorCount++;
     } else {
         WARN("ApplicationMonitor: Can't monitor more than %d QQuickWindows.", maxMonitors);
@@ -282,8 +559,9 @@ void UMApplicationMonitorPrivate::start()
     DASSERT(!(m_flags & Started));
     DASSERT(!m_loggingThread);
 
-    m_loggingThread = new LoggingThread;
-    m_loggingThread->setLoggers(m_loggers, m_loggerCount);
+    m_loggingThread = new LoggingThread(
+        m_queueCapacity, m_queuePolicy, &m_droppedEventCount, m_flightRecorder);
+    m_loggingThread->setLoggers(m_loggers, (m_flags & LoggersEnabled) ? m_loggerCount : 0);
 
     QWindowList windows = QGuiApplication::allWindows();
     const int size = windows.size();
@@ -298,6 +576,7 @@ void UMApplicationMonitorPrivate::start()
     m_monitorsMutex.unlock();
 
     QGuiApplication::instance()->installEventFilter(q_func());
+    UMEventUtils::registerThread(UMProcessEvent::GuiThread);
 
     // Doing it here so that processTimeout can assert the monitoring started.
     m_flags |= Started;
@@ -382,6 +661,7 @@ void UMApplicationMonitorPrivate::stop()
     }
 
     QGuiApplication::instance()->removeEventFilter(q_func());
+    UMEventUtils::unregisterThread();
 
     m_monitorsMutex.lock();
     for (int i = 0; i < m_monitorCount; ++i) {
@@ -493,10 +773,7 @@ bool UMApplicationMonitor::installLogger(UMLogger* logger)
     if (d->m_loggerCount < UMApplicationMonitorPrivate::maxLoggers && logger) {
         DASSERT(d->m_loggers[d->m_loggerCount] == nullptr);
         d->m_loggers[d->m_loggerCount++] = logger;
-        if (d->m_flags & UMApplicationMonitorPrivate::Started) {
-            DASSERT(d->m_loggingThread);
-            d->m_loggingThread->setLoggers(d->m_loggers, d->m_loggerCount);
-        }
+        d->updateLoggers();
         Q_EMIT loggersChanged();
         return true;
     } else {
@@ -512,7 +789,7 @@ bool UMApplicationMonitor::removeLogger(UMLogger* logger, bool free)
 
     Q_D(UMApplicationMonitor);
 
-    for (int i = d->m_loggerCount; i > 0; --i) {
+    for (int i = d->m_loggerCount - 1; i >= 0; --i) {
         if (d->m_loggers[i] == logger) {
             if (i < --d->m_loggerCount) {
                 d->m_loggers[i] = d->m_loggers[d->m_loggerCount];
@@ -520,10 +797,7 @@ bool UMApplicationMonitor::removeLogger(UMLogger* logger, bool free)
 #if !defined(QT_NO_DEBUG)
             d->m_loggers[d->m_loggerCount] = nullptr;
 #endif
-            if (d->m_flags & UMApplicationMonitorPrivate::Started) {
-                DASSERT(d->m_loggingThread);
-                d->m_loggingThread->setLoggers(d->m_loggers, d->m_loggerCount);
-            }
+            d->updateLoggers();
             if (free) {
                 delete logger;
             }
@@ -539,17 +813,45 @@ void UMApplicationMonitor::clearLoggers(bool free)
     Q_D(UMApplicationMonitor);
 
     if (d->m_loggerCount > 0) {
+        const int count = d->m_loggerCount;
+        d->m_loggerCount = 0;
+        d->updateLoggers();
         if (free) {
-            const int count = d->m_loggerCount;
             for (int i = 0; i < count; ++i) {
                 delete d->m_loggers[i];
             }
         }
-        d->m_loggerCount = 0;
         Q_EMIT loggersChanged();
     }
 }
 
+void UMApplicationMonitor::setLoggingQueue(int capacity, QueuePolicy policy)
+{
+    Q_D(UMApplicationMonitor);
+
+    capacity = qMax(capacity, 1);
+    if (capacity != d->m_queueCapacity || policy != d->m_queuePolicy) {
+        d->m_queueCapacity = capacity;
+        d->m_queuePolicy = policy;
+        Q_EMIT loggingQueueChanged();
+    }
+}
+
+int UMApplicationMonitor::loggingQueueCapacity()
+{
+    return d_func()->m_queueCapacity;
+}
+
+UMApplicationMonitor::QueuePolicy UMApplicationMonitor::loggingQueuePolicy()
+{
+    return d_func()->m_queuePolicy;
+}
+
+quint32 UMApplicationMonitor::droppedEventCount()
+{
+    return d_func()->m_droppedEventCount.load();
+}
+
 quint32 UMApplicationMonitor::registerGenericEvent()
 {
     static quint32 id = 0;  // 0 is reserved for UMApplicationMonitor events.
@@ -579,12 +881,110 @@ bool UMApplicationMonitor::logGenericEvent(quint32 id, const char* string, quint
     }
 }
 
+// Per thread stack of the spans begun and not yet ended.
+struct SpanStack
+{
+    quint64 timeStamps[UMSpanEvent::maxDepth];
+    quint32 ids[UMSpanEvent::maxDepth];
+    quint8 stringSizes[UMSpanEvent::maxDepth];
+    char strings[UMSpanEvent::maxDepth][UMSpanEvent::maxStringSize];
+    quint32 threadId;
+    int depth;  // Can be higher than maxDepth, deeper spans are just counted.
+};
+static thread_local SpanStack spanStack;
+
+static quint32 currentThreadId()
+{
+#if defined(Q_OS_LINUX)
+    return static_cast<quint32>(syscall(SYS_gettid));
+#else
+    return static_cast<quint32>(reinterpret_cast<quintptr>(QThread::currentThreadId()));
+#endif
+}
+
+bool UMApplicationMonitor::beginSpan(quint32 id, const char* string, quint32 size)
+{
+    Q_D(UMApplicationMonitor);
+
+    SpanStack& stack = spanStack;
+    const int depth = stack.depth++;
+    if (Q_UNLIKELY(depth >= UMSpanEvent::maxDepth)) {
+        return false;
+    }
+    if (Q_UNLIKELY(!stack.threadId)) {
+        stack.threadId = currentThreadId();
+    }
+    // Fix up the string so that it's always null-terminated.
+    const quint8 stringSize = qMax(qMin(size, quint32(UMSpanEvent::maxStringSize)), 1u);
+    memcpy(stack.strings[depth], string, stringSize - 1);
+    stack.strings[depth][stringSize - 1] = '\0';
+    stack.stringSizes[depth] = stringSize;
+    stack.ids[depth] = id;
+    stack.timeStamps[depth] = UMEventUtils::timeStamp();
+
+    if ((d->m_flags & UMApplicationMonitorPrivate::Logging) && (d->m_flags & SpanEvent)) {
+        DASSERT(d->m_loggingThread);
+        UMEvent event;
+        memset(&event, 0, sizeof(event));
+        event.type = UMEvent::Span;
+        event.timeStamp = stack.timeStamps[depth];
+        event.span.id = id;
+        event.span.threadId = stack.threadId;
+        event.span.duration = 0;
+        event.span.depth = depth;
+        event.span.phase = UMSpanEvent::Begin;
+        event.span.stringSize = stringSize;
+        memcpy(event.span.string, stack.strings[depth], stringSize);
+        d->m_loggingThread->push(&event);
+        return true;
+    } else {
+        return false;
+    }
+}
+
+bool UMApplicationMonitor::endSpan()
+{
+    Q_D(UMApplicationMonitor);
+
+    SpanStack& stack = spanStack;
+    if (Q_UNLIKELY(stack.depth == 0)) {
+        DWARN("ApplicationMonitor: endSpan() called without a matching beginSpan().");
+        return false;
+    }
+    const int depth = --stack.depth;
+    if (Q_UNLIKELY(depth >= UMSpanEvent::maxDepth)) {
+        return false;
+    }
+
+    if ((d->m_flags & UMApplicationMonitorPrivate::Logging) && (d->m_flags & SpanEvent)) {
+        DASSERT(d->m_loggingThread);
+        UMEvent event;
+        memset(&event, 0, sizeof(event));
+        event.type = UMEvent::Span;
+        event.timeStamp = UMEventUtils::timeStamp();
+        event.span.id = stack.ids[depth];
+        event.span.threadId = stack.threadId;
+        event.span.duration = event.timeStamp - stack.timeStamps[depth];
+        event.span.depth = depth;
+        event.span.phase = UMSpanEvent::End;
+        event.span.stringSize = stack.stringSizes[depth];
+        memcpy(event.span.string, stack.strings[depth], stack.stringSizes[depth]);
+        d->m_loggingThread->push(&event);
+        return true;
+    } else {
+        return false;
+    }
+}
+
 bool UMApplicationMonitor::logEvent(Event event)
 {
     switch (event) {
     case UserInterfaceReady: {
         return logGenericEvent(0, "UserInterfaceReady", sizeof("UserInterfaceReady"));
     }
+    case FirstFrameSwapped: {
+        return logGenericEvent(0, "FirstFrameSwapped", sizeof("FirstFrameSwapped"));
+    }
     default: {
         DNOT_REACHED();
         return false;
@@ -596,8 +996,8 @@ void UMApplicationMonitor::setUpdateInterval(UMEvent::Type type, int interval)
 {
     Q_D(UMApplicationMonitor);
 
+    // Other types (like UMEvent::Frame) are ignored for now.
     if (type == UMEvent::Process) {
-        // Other types (like UMEvent::Frame) are ignored for now.
         if (interval != d->m_updateInterval[UMEvent::Process]) {
             if (interval >= 0) {
                 d->m_processTimer.setInterval(interval);
@@ -612,6 +1012,19 @@ void UMApplicationMonitor::setUpdateInterval(UMEvent::Type type, int interval)
             d->m_updateInterval[UMEvent::Process] = interval;
             Q_EMIT updateIntervalChanged(UMEvent::Process);
         }
+
+    } else if (type == UMEvent::FrameSummary) {
+        interval = qMax(interval, -1);
+        if (interval != d->m_updateInterval[UMEvent::FrameSummary]) {
+            d->m_updateInterval[UMEvent::FrameSummary] = interval;
+            d->m_monitorsMutex.lock();
+            for (int i = 0; i < d->m_monitorCount; ++i) {
+                DASSERT(d->m_monitors[i]);
+                d->m_monitors[i]->setFrameSummaryInterval(interval);
+            }
+            d->m_monitorsMutex.unlock();
+            Q_EMIT updateIntervalChanged(UMEvent::FrameSummary);
+        }
     }
 }
 
@@ -620,6 +1033,193 @@ int UMApplicationMonitor::updateInterval(UMEvent::Type type)
     return d_func()->m_updateInterval[type];
 }
 
+QList<UMEvent> UMApplicationMonitor::frameSummaries()
+{
+    Q_D(UMApplicationMonitor);
+
+    QList<UMEvent> list;
+    d->m_monitorsMutex.lock();
+    for (int i = 0; i < d->m_monitorCount; ++i) {
+        UMEvent event;
+        if (d->m_monitors[i]->frameSummary(&event)) {
+            list.append(event);
+        }
+    }
+    d->m_monitorsMutex.unlock();
+    return list;
+}
+
+void UMApplicationMonitor::setLongFrameBudget(int budget)
+{
+    Q_D(UMApplicationMonitor);
+
+    budget = qMax(budget, -1);
+    if (budget != d->m_longFrameBudget) {
+        d->m_longFrameBudget = budget;
+        d->m_monitorsMutex.lock();
+        for (int i = 0; i < d->m_monitorCount; ++i) {
+            DASSERT(d->m_monitors[i]);
+            d->m_monitors[i]->setLongFrameBudget(budget);
+        }
+        d->m_monitorsMutex.unlock();
+        Q_EMIT longFrameBudgetChanged();
+    }
+}
+
+int UMApplicationMonitor::longFrameBudget()
+{
+    return d_func()->m_longFrameBudget;
+}
+
+void UMApplicationMonitor::setFlightRecorder(int duration, int capacity)
+{
+    Q_D(UMApplicationMonitor);
+
+    duration = qMax(duration, -1);
+    capacity = duration >= 0 ? qMax(capacity, 1) : 0;
+    if (duration != d->m_flightRecorderDuration || capacity != d->m_flightRecorder->capacity()) {
+        d->m_flightRecorderDuration = duration;
+        d->m_flightRecorder->setCapacity(capacity);
+        if (duration >= 0) {
+            d->m_flags |= UMApplicationMonitorPrivate::FlightRecording;
+        } else {
+            d->m_flags &= ~UMApplicationMonitorPrivate::FlightRecording;
+        }
+        d->updateLogging();
+        Q_EMIT flightRecorderChanged();
+    }
+}
+
+int UMApplicationMonitor::flightRecorderDuration()
+{
+    return d_func()->m_flightRecorderDuration;
+}
+
+int UMApplicationMonitor::flightRecorderCapacity()
+{
+    return d_func()->m_flightRecorder->capacity();
+}
+
+void UMApplicationMonitor::setFlightRecorderFile(const QString& fileName)
+{
+    Q_D(UMApplicationMonitor);
+
+    if (fileName != d->m_flightRecorderFile) {
+        d->m_flightRecorderFile = fileName;
+        Q_EMIT flightRecorderChanged();
+    }
+}
+
+QString UMApplicationMonitor::flightRecorderFile()
+{
+    return d_func()->m_flightRecorderFile;
+}
+
+bool UMApplicationMonitor::setFlightRecorderSignal(int signal)
+{
+    Q_D(UMApplicationMonitor);
+
+    if (signal == d->m_flightRecorderSignal) {
+        return true;
+    }
+
+#if defined(Q_OS_UNIX)
+    if (d->m_flightRecorderSignal != 0) {
+        sigaction(d->m_flightRecorderSignal, &previousFlightRecorderAction, nullptr);
+        d->m_flightRecorderSignal = 0;
+    }
+
+    if (signal != 0) {
+        if (flightRecorderPipe[0] == -1) {
+            if (pipe(flightRecorderPipe) == -1) {
+                WARN("ApplicationMonitor: Can't create flight recorder pipe.");
+                Q_EMIT flightRecorderChanged();
+                return false;
+            }
+            for (int i = 0; i < 2; ++i) {
+                fcntl(flightRecorderPipe[i], F_SETFD, FD_CLOEXEC);
+                fcntl(flightRecorderPipe[i], F_SETFL, O_NONBLOCK);
+            }
+        }
+        if (!d->m_flightRecorderNotifier) {
+            d->m_flightRecorderNotifier =
+                new QSocketNotifier(flightRecorderPipe[0], QSocketNotifier::Read, this);
+            QObject::connect(d->m_flightRecorderNotifier, SIGNAL(activated(int)),
+                             this, SLOT(flightRecorderSignalReceived()));
+        }
+
+        struct sigaction action;
+        memset(&action, 0, sizeof(action));
+        action.sa_sigaction = flightRecorderSignalHandler;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART | SA_SIGINFO;
+        if (sigaction(signal, &action, &previousFlightRecorderAction) == -1) {
+            WARN("ApplicationMonitor: Can't install flight recorder handler for signal %d.",
+                 signal);
+            Q_EMIT flightRecorderChanged();
+            return false;
+        }
+        d->m_flightRecorderSignal = signal;
+    }
+
+    Q_EMIT flightRecorderChanged();
+    return true;
+#else
+    WARN("ApplicationMonitor: Flight recorder signal not supported on that platform.");
+    return false;
+#endif
+}
+
+int UMApplicationMonitor::flightRecorderSignal()
+{
+    return d_func()->m_flightRecorderSignal;
+}
+
+void UMApplicationMonitor::flightRecorderSignalReceived()
+{
+#if defined(Q_OS_UNIX)
+    char buffer[16];
+    while (read(flightRecorderPipe[0], buffer, sizeof(buffer)) > 0) {}
+#endif
+
+    requestFlightRecorderDump();
+}
+
+bool UMApplicationMonitor::dumpFlightRecorder()
+{
+    return dumpFlightRecorder(d_func()->m_flightRecorderFile);
+}
+
+bool UMApplicationMonitor::dumpFlightRecorder(const QString& fileName)
+{
+    Q_D(UMApplicationMonitor);
+
+    const int duration = d->m_flightRecorderDuration;
+    if (duration < 0 || fileName.isEmpty()) {
+        return false;
+    }
+    return d->m_flightRecorder->dump(fileName, duration * Q_UINT64_C(1000000));
+}
+
+bool UMApplicationMonitor::requestFlightRecorderDump()
+{
+    Q_D(UMApplicationMonitor);
+
+    const int duration = d->m_flightRecorderDuration;
+    if (duration < 0 || d->m_flightRecorderFile.isEmpty()
+        || !(d->m_flags & UMApplicationMonitorPrivate::Started)) {
+        return false;
+    }
+    if (d->m_flightRecorderDumpTimer.isValid()
+        && d->m_flightRecorderDumpTimer.elapsed() < dumpInterval) {
+        return false;
+    }
+    d->m_flightRecorderDumpTimer.start();
+    DASSERT(d->m_loggingThread);
+    d->m_loggingThread->requestDump(d->m_flightRecorderFile, duration * Q_UINT64_C(1000000));
+    return true;
+}
+
 void UMApplicationMonitor::closeDown()
 {
     Q_D(UMApplicationMonitor);
@@ -680,6 +1280,9 @@ bool UMApplicationMonitor::eventFilter(QObject* object, QEvent* event)
     return QObject::eventFilter(object, event);
 }
 
+// Set once the first frame of the process has been swapped.
+static QAtomicInt firstFrameSwapped(0);
+
 static const char* const defaultOverlayText =
     "%qtVersion (%qtPlatform) - %glVersion\n"
     "%cpuModel\n"  // FIXME(loicm) Should be included by default?
@@ -692,7 +1295,9 @@ static const char* const defaultOverlayText =
     "  SG sync. : %9syncTime ms\n"
     " SG render : %9renderTime ms\n"
     "       GPU : %9gpuTime ms\n"
-    "     Total : %9totalTime ms\r"
+    "     Total : %9totalTime ms\n"
+    "  LF count : %9longFrameCount   \n"
+    "  LF phase : %9longFramePhase   \r"
     "  VSZ mem. : %9vszMemory kB\n"
     "  RSS mem. : %9rssMemory kB\n"
     "   Threads : %9threadCount   \n"
@@ -705,9 +1310,19 @@ WindowMonitor::WindowMonitor(
     , m_loggingThread(loggingThread)
     , m_window(window)
     , m_overlay(defaultOverlayText, id)
+    , m_gapTime(0)
     , m_id(id)
     , m_flags(flags)
     , m_frameSize(window->width(), window->height())
+    , m_queue(loggingThread->createQueue())
+    , m_frameSummaryInterval(-1)
+    , m_missedFrameCount(0)
+    , m_wasAnimating(false)
+    , m_longFrameBudget(-1)
+    , m_animationCount(0)
+    , m_dirtyItemCount(0)
+    , m_pendingFirst(0)
+    , m_pendingCount(0)
 {
     DASSERT(applicationMonitor == UMApplicationMonitor::instance());
     DASSERT(m_applicationMonitor);
@@ -720,6 +1335,8 @@ WindowMonitor::WindowMonitor(
                      SLOT(windowSceneGraphInitialized()), Qt::DirectConnection);
     QObject::connect(window, SIGNAL(sceneGraphInvalidated()), this,
                      SLOT(windowSceneGraphInvalidated()), Qt::DirectConnection);
+    QObject::connect(window, SIGNAL(afterAnimating()), this, SLOT(windowAfterAnimating()),
+                     Qt::DirectConnection);
     QObject::connect(window, SIGNAL(beforeSynchronizing()), this,
                      SLOT(windowBeforeSynchronizing()), Qt::DirectConnection);
     QObject::connect(window, SIGNAL(afterSynchronizing()), this,
@@ -736,6 +1353,12 @@ WindowMonitor::WindowMonitor(
     memset(&m_frameEvent, 0, sizeof(m_frameEvent));
     m_frameEvent.type = UMEvent::Frame;
     m_frameEvent.frame.window = id;
+    memset(&m_frameSummaryEvent, 0, sizeof(m_frameSummaryEvent));
+
+    // Used to count missed frames, 60 Hz is assumed if the refresh rate is
+    // unknown.
+    const qreal refreshRate = window->screen() ? window->screen()->refreshRate() : 0.0;
+    m_refreshPeriod = static_cast<quint64>(1000000000.0 / (refreshRate > 0.0 ? refreshRate : 60.0));
 
     if ((flags & UMApplicationMonitorPrivate::Logging)
         && (flags & UMApplicationMonitor::WindowEvent)) {
@@ -766,6 +1389,7 @@ WindowMonitor::~WindowMonitor()
         m_loggingThread->push(&event);
     }
 
+    m_loggingThread->releaseQueue(m_queue);
     m_loggingThread->deref();
 }
 
@@ -780,7 +1404,14 @@ void WindowMonitor::initializeGpuResources()
     m_overlay.initialize();
     m_gpuTimer.initialize();
     m_frameEvent.frame.number = 0;
-    m_flags |= GpuResourcesInitialized | (!noGpuTimer ? GpuTimerAvailable : 0);
+    m_frameEvent.frame.gpuTime = 0;
+    m_flags |= GpuResourcesInitialized
+        | (!noGpuTimer && m_gpuTimer.isAvailable() ? GpuTimerAvailable : 0);
+
+    // The GUI thread is already accounted with the non-threaded render loops.
+    if (QThread::currentThread() != m_window->thread()) {
+        UMEventUtils::registerThread(UMProcessEvent::RenderThread);
+    }
 }
 
 void WindowMonitor::windowSceneGraphInitialized()
@@ -794,13 +1425,22 @@ void WindowMonitor::finalizeGpuResources()
 {
     DASSERT(m_flags & GpuResourcesInitialized);
 
+    // Get the GPU times already available and complete the frames still
+    // waiting without it.
     if (m_flags & GpuTimerAvailable) {
-        m_gpuTimer.finalize();
+        collectGpuTimes();
     }
+    completeFrames(true);
+
+    m_gpuTimer.finalize();
     m_overlay.finalize();
 
     m_frameEvent.frame.number = 0;
-    m_flags &= ~(GpuResourcesInitialized | GpuTimerAvailable);
+    m_flags &= ~(GpuResourcesInitialized | GpuTimerAvailable | GpuTimerStarted);
+
+    if (QThread::currentThread() != m_window->thread()) {
+        UMEventUtils::unregisterThread();
+    }
 }
 
 void WindowMonitor::windowSceneGraphInvalidated()
@@ -810,9 +1450,32 @@ void WindowMonitor::windowSceneGraphInvalidated()
     }
 }
 
+// Called on the GUI thread once the animations have been advanced, right before
+// the frame is requested to the render thread. Both frame summaries and long
+// frames need to know whether the frame has been rendered while animating.
+void WindowMonitor::windowAfterAnimating()
+{
+    if (m_frameSummaryInterval.load() >= 0 || m_longFrameBudget.load() >= 0) {
+        QUnifiedTimer* timer = QUnifiedTimer::instance(false);
+        m_animationCount.store(timer ? timer->runningAnimationCount() : 0);
+    }
+}
+
 void WindowMonitor::windowBeforeSynchronizing()
 {
     if (m_flags & GpuResourcesInitialized) {
+        m_gapTime = m_deltaTimer.isValid() ? m_deltaTimer.nsecsElapsed() : 0;
+        if (m_longFrameBudget.load() >= 0) {
+            // The GUI thread is blocked during the synchronization, the list
+            // of items whose nodes are about to be updated can be walked.
+            quint32 count = 0;
+            QQuickItem* item = QQuickWindowPrivate::get(m_window)->dirtyItemList;
+            while (item) {
+                item = QQuickItemPrivate::get(item)->nextDirtyItem;
+                count++;
+            }
+            m_dirtyItemCount = count;
+        }
         m_sceneGraphTimer.start();
     }
 }
@@ -838,14 +1501,14 @@ void WindowMonitor::windowBeforeRendering()
             event.window.width = frameSize.width();
             event.window.height = frameSize.height();
             event.window.state = UMWindowEvent::Resized;
-            m_loggingThread->push(&event);
+            m_loggingThread->push(m_queue, &event);
         }
     }
 
     if (m_flags & GpuResourcesInitialized) {
         m_sceneGraphTimer.start();
-        if (m_flags & GpuTimerAvailable) {
-            m_gpuTimer.start();
+        if ((m_flags & GpuTimerAvailable) && m_gpuTimer.start()) {
+            m_flags |= GpuTimerStarted;
         }
     }
 }
@@ -854,8 +1517,10 @@ void WindowMonitor::windowAfterRendering()
 {
     if (m_flags & GpuResourcesInitialized) {
         m_frameEvent.frame.renderTime = m_sceneGraphTimer.nsecsElapsed();
-        m_frameEvent.frame.gpuTime = (m_flags & GpuTimerAvailable) ? m_gpuTimer.stop() : 0;
         m_frameEvent.frame.number++;
+        if (m_flags & GpuTimerStarted) {
+            m_gpuTimer.stop(m_frameEvent.frame.number);
+        }
         if (m_flags & UMApplicationMonitorPrivate::Overlay) {
             m_mutex.lock();
             m_overlay.render(m_frameEvent, m_frameSize);
@@ -869,13 +1534,34 @@ void WindowMonitor::windowFrameSwapped()
 {
     if (m_flags & GpuResourcesInitialized) {
         m_frameEvent.frame.deltaTime = m_deltaTimer.isValid() ? m_deltaTimer.nsecsElapsed() : 0;
+        m_frameEvent.frame.swapTime = m_sceneGraphTimer.nsecsElapsed();
         m_deltaTimer.start();
-        if ((m_flags & UMApplicationMonitorPrivate::Logging) &&
-            (m_flags & UMApplicationMonitor::FrameEvent)) {
-            m_frameEvent.frame.swapTime = m_sceneGraphTimer.nsecsElapsed();
-            m_frameEvent.timeStamp = UMEventUtils::timeStamp();
-            m_loggingThread->push(&m_frameEvent);
+        m_frameEvent.timeStamp = UMEventUtils::timeStamp();
+        if (Q_UNLIKELY(!firstFrameSwapped.load()) && firstFrameSwapped.testAndSetRelaxed(0, 1)) {
+            m_applicationMonitor->logEvent(UMApplicationMonitor::FirstFrameSwapped);
+        }
+
+        // The frame is completed once its GPU time has been collected, a few
+        // frames later, so that measuring it doesn't stall the pipeline.
+        if (m_pendingCount == maxPendingFrames) {
+            completeFrame(m_pendingFrames[m_pendingFirst]);
+            m_pendingFirst = (m_pendingFirst + 1) % maxPendingFrames;
+            m_pendingCount--;
+        }
+        PendingFrame& frame =
+            m_pendingFrames[(m_pendingFirst + m_pendingCount) % maxPendingFrames];
+        memcpy(&frame.event, &m_frameEvent, sizeof(UMEvent));
+        frame.event.frame.gpuTime = 0;
+        frame.gapTime = m_gapTime;
+        frame.dirtyItemCount = m_dirtyItemCount;
+        frame.animationCount = m_animationCount.load();
+        frame.waitingGpuTime = !!(m_flags & GpuTimerStarted);
+        m_pendingCount++;
+        m_flags &= ~GpuTimerStarted;
+        if (m_flags & GpuTimerAvailable) {
+            collectGpuTimes();
         }
+        completeFrames(false);
     } else {
         initializeGpuResources();  // Get everything ready for the next frame.
         if (m_flags & UMApplicationMonitorPrivate::Overlay) {
@@ -884,6 +1570,177 @@ void WindowMonitor::windowFrameSwapped()
     }
 }
 
+// Retrieves the GPU times available and attaches them to the pending frames.
+void WindowMonitor::collectGpuTimes()
+{
+    quint32 number;
+    quint64 time;
+    while (m_gpuTimer.result(&number, &time)) {
+        m_frameEvent.frame.gpuTime = time;  // Latest GPU time for the overlay.
+        for (int i = 0; i < m_pendingCount; ++i) {
+            PendingFrame& frame = m_pendingFrames[(m_pendingFirst + i) % maxPendingFrames];
+            if (frame.event.frame.number == number) {
+                frame.event.frame.gpuTime = time;
+                frame.waitingGpuTime = false;
+                break;
+            }
+        }
+    }
+}
+
+// Completes the pending frames in order, stops at the first one still waiting
+// for its GPU time unless flush is true.
+void WindowMonitor::completeFrames(bool flush)
+{
+    while (m_pendingCount > 0) {
+        const PendingFrame& frame = m_pendingFrames[m_pendingFirst];
+        if (frame.waitingGpuTime && !flush) {
+            break;
+        }
+        completeFrame(frame);
+        m_pendingFirst = (m_pendingFirst + 1) % maxPendingFrames;
+        m_pendingCount--;
+    }
+}
+
+void WindowMonitor::completeFrame(const PendingFrame& frame)
+{
+    if ((m_flags & UMApplicationMonitorPrivate::Logging) &&
+        (m_flags & UMApplicationMonitor::FrameEvent)) {
+        m_loggingThread->push(m_queue, &frame.event);
+    }
+    const int frameSummaryInterval = m_frameSummaryInterval.load();
+    if (frameSummaryInterval >= 0) {
+        updateFrameSummary(frameSummaryInterval, frame);
+    } else if (m_frameSummaryTimer.isValid()) {
+        m_frameSummaryTimer.invalidate();
+    }
+    const int longFrameBudget = m_longFrameBudget.load();
+    if (longFrameBudget >= 0) {
+        updateLongFrame(longFrameBudget, frame);
+    }
+}
+
+quint32 WindowMonitor::missedFrameCount(
+    quint64 deltaTime, quint64 refreshPeriod, bool wasAnimating, bool isAnimating)
+{
+    if (!wasAnimating || !isAnimating || refreshPeriod == 0) {
+        return 0;
+    }
+    const quint64 refreshPeriods = (deltaTime + refreshPeriod / 2) / refreshPeriod;
+    return refreshPeriods > 1 ? static_cast<quint32>(refreshPeriods - 1) : 0;
+}
+
+void WindowMonitor::updateFrameSummary(int interval, const PendingFrame& pendingFrame)
+{
+    const UMFrameEvent& frame = pendingFrame.event.frame;
+    const bool isAnimating = pendingFrame.animationCount > 0;
+    const bool wasAnimating = m_wasAnimating;
+    m_wasAnimating = isAnimating;
+
+    if (!m_frameSummaryTimer.isValid()) {
+        for (int i = 0; i < UMFrameSummaryEvent::MetricCount; ++i) {
+            m_frameHistograms[i].reset();
+        }
+        m_missedFrameCount = 0;
+        m_frameSummaryTimer.start();
+    }
+
+    // Aggregate the frame times in microseconds. The first delta time is not
+    // available, the ones measuring an idle gap of the render loop (like the
+    // first frame of an animation) are ignored, same as for long frames.
+    const quint64 deltaTime = frame.deltaTime;
+    if (deltaTime > 0 && wasAnimating && isAnimating) {
+        m_frameHistograms[UMFrameSummaryEvent::DeltaTime].record(deltaTime / 1000);
+        m_missedFrameCount +=
+            missedFrameCount(deltaTime, m_refreshPeriod, wasAnimating, isAnimating);
+    }
+    m_frameHistograms[UMFrameSummaryEvent::SyncTime].record(frame.syncTime / 1000);
+    m_frameHistograms[UMFrameSummaryEvent::RenderTime].record(frame.renderTime / 1000);
+    m_frameHistograms[UMFrameSummaryEvent::GpuTime].record(frame.gpuTime / 1000);
+    m_frameHistograms[UMFrameSummaryEvent::SwapTime].record(frame.swapTime / 1000);
+
+    if (m_frameSummaryTimer.elapsed() >= interval) {
+        UMEvent event;
+        memset(&event, 0, sizeof(event));
+        event.type = UMEvent::FrameSummary;
+        event.timeStamp = UMEventUtils::timeStamp();
+        event.frameSummary.window = m_id;
+        event.frameSummary.frameCount =
+            m_frameHistograms[UMFrameSummaryEvent::RenderTime].count();
+        event.frameSummary.missedFrameCount = m_missedFrameCount;
+        for (int i = 0; i < UMFrameSummaryEvent::MetricCount; ++i) {
+            const Histogram& histogram = m_frameHistograms[i];
+            quint32* times = event.frameSummary.times[i];
+            times[UMFrameSummaryEvent::P50] = histogram.percentile(50.0f);
+            times[UMFrameSummaryEvent::P90] = histogram.percentile(90.0f);
+            times[UMFrameSummaryEvent::P99] = histogram.percentile(99.0f);
+            times[UMFrameSummaryEvent::Max] = histogram.max();
+            m_frameHistograms[i].reset();
+        }
+        m_missedFrameCount = 0;
+        m_frameSummaryTimer.start();
+
+        if ((m_flags & UMApplicationMonitorPrivate::Logging) &&
+            (m_flags & UMApplicationMonitor::FrameSummaryEvent)) {
+            m_loggingThread->push(m_queue, &event);
+        }
+        m_mutex.lock();
+        memcpy(&m_frameSummaryEvent, &event, sizeof(UMEvent));
+        m_mutex.unlock();
+    }
+}
+
+void WindowMonitor::updateLongFrame(int budget, const PendingFrame& frame)
+{
+    const quint64 budgetTime = budget > 0 ? budget * Q_UINT64_C(1000) : m_refreshPeriod * 3 / 2;
+    const quint32 animationCount = frame.animationCount;
+
+    // The render loop is idle when there's no running animations, in which
+    // case the gap only measures the time spent waiting for an update.
+    quint64 phaseTimes[UMLongFrameEvent::PhaseCount];
+    phaseTimes[UMLongFrameEvent::Gap] = animationCount > 0 ? frame.gapTime : 0;
+    phaseTimes[UMLongFrameEvent::Sync] = frame.event.frame.syncTime;
+    phaseTimes[UMLongFrameEvent::Render] = frame.event.frame.renderTime;
+    phaseTimes[UMLongFrameEvent::Gpu] = frame.event.frame.gpuTime;
+    phaseTimes[UMLongFrameEvent::Swap] = frame.event.frame.swapTime;
+    const quint64 frameTime =
+        phaseTimes[UMLongFrameEvent::Gap] + phaseTimes[UMLongFrameEvent::Sync]
+        + phaseTimes[UMLongFrameEvent::Render] + phaseTimes[UMLongFrameEvent::Swap];
+    if (frameTime <= budgetTime) {
+        return;
+    }
+
+    UMEvent event;
+    memset(&event, 0, sizeof(event));
+    event.type = UMEvent::LongFrame;
+    event.timeStamp = frame.event.timeStamp;
+    event.longFrame.window = m_id;
+    event.longFrame.number = frame.event.frame.number;
+    event.longFrame.budget = budgetTime;
+    event.longFrame.frameTime = frameTime;
+    int phase = UMLongFrameEvent::Gap;
+    for (int i = 0; i < UMLongFrameEvent::PhaseCount; ++i) {
+        event.longFrame.phaseTimes[i] = phaseTimes[i];
+        if (phaseTimes[i] > phaseTimes[phase]) {
+            phase = i;
+        }
+    }
+    event.longFrame.phase = static_cast<UMLongFrameEvent::Phase>(phase);
+    event.longFrame.dirtyItemCount = frame.dirtyItemCount;
+    event.longFrame.animationCount = animationCount;
+
+    if ((m_flags & UMApplicationMonitorPrivate::Logging) &&
+        (m_flags & UMApplicationMonitor::LongFrameEvent)) {
+        m_loggingThread->push(m_queue, &event);
+    }
+    if (m_flags & UMApplicationMonitorPrivate::Overlay) {
+        m_mutex.lock();
+        m_overlay.setLongFrameEvent(event);
+        m_mutex.unlock();
+    }
+}
+
 void WindowMonitor::windowSceneGraphAboutToStop()
 {
 #if !defined(QT_NO_DEBUG)
@@ -910,3 +1767,16 @@ void WindowMonitor::setProcessEvent(const UMEvent& event)
         m_window->update();
     }
 }
+
+bool WindowMonitor::frameSummary(UMEvent* event)
+{
+    DASSERT(event);
+
+    QMutexLocker locker(&m_mutex);
+    if (m_frameSummaryEvent.type == UMEvent::FrameSummary) {
+        memcpy(event, &m_frameSummaryEvent, sizeof(UMEvent));
+        return true;
+    } else {
+        return false;
+    }
+}
@@ -43,16 +43,36 @@ public:
         FrameEvent   = (1 << 2),
         // Allow generic events logging.
         GenericEvent = (1 << 3),
+        // Allow frame summary events logging.
+        FrameSummaryEvent = (1 << 4),
+        // Allow span events logging.
+        SpanEvent    = (1 << 5),
+        // Allow long frame events logging.
+        LongFrameEvent = (1 << 6),
         // Allow all events logging.
-        AllEvents    = (ProcessEvent | WindowEvent | FrameEvent | GenericEvent)
+        AllEvents    = (ProcessEvent | WindowEvent | FrameEvent | GenericEvent | FrameSummaryEvent
+                        | SpanEvent | LongFrameEvent)
     };
     Q_DECLARE_FLAGS(LoggingFilters, LoggingFilter)
 
+    enum QueuePolicy {
+        // Drop events pushed to a full logging queue. Dropped events are
+        // counted, see droppedEventCount().
+        DropWhenFull = 0,
+        // Block the thread pushing an event to a full logging queue until the
+        // logging thread makes room for it.
+        BlockWhenFull = 1
+    };
+
     enum Event {
         // Application defined event indicating that the initialisation is done
         // and the UI ready. It can be used by tools to measure the time needed
         // to start up an application.
-        UserInterfaceReady = 0
+        UserInterfaceReady = 0,
+        // Logged automatically the first time a monitored window swaps a
+        // frame, marking the end of the application start up as seen by the
+        // user.
+        FirstFrameSwapped = 1
     };
 
     // Get the unique UMApplicationMonitor instance. A QGuiApplication instance
@@ -77,6 +97,21 @@ public:
     bool removeLogger(UMLogger* logger, bool free = true);
     void clearLoggers(bool free = true);
 
+    // Set the capacity (in number of events) of the logging queues and the
+    // policy applied when a queue is full. Each monitored window has its own
+    // queue for frame events, process, window and generic events go through a
+    // queue shared by all threads. The capacity is rounded up to the next
+    // power-of-two. Default values are 128 and DropWhenFull, so that the
+    // render threads never wait for the loggers. Changes are taken into
+    // account the next time monitoring starts.
+    void setLoggingQueue(int capacity, QueuePolicy policy = DropWhenFull);
+    int loggingQueueCapacity();
+    QueuePolicy loggingQueuePolicy();
+
+    // Get the number of events dropped because of full logging queues since
+    // the creation of the application monitor.
+    quint32 droppedEventCount();
+
     // Generic event system allowing to log application specific
     // events. registerGenericEvent() returns a unique integer id to be used as
     // first argument to logGenericEvent(). logGenericEvent() logs a generic
@@ -88,27 +123,104 @@ public:
     quint32 registerGenericEvent();
     bool logGenericEvent(quint32 id, const char* string, quint32 size);
 
+    // Span system allowing to trace the duration of application specific
+    // operations so that they can be lined up with frame events. beginSpan()
+    // starts a span on the calling thread with a generic event id, a
+    // null-terminated string naming the span and the string size with the
+    // null-terminating character (truncated to UMSpanEvent::maxStringSize),
+    // endSpan() ends the innermost span of the calling thread. Spans can be
+    // nested up to UMSpanEvent::maxDepth levels per thread, deeper spans are
+    // ignored. Spans are tracked even if logging is disabled so that nesting
+    // stays consistent, but span events are logged only if logging is enabled
+    // and if the logging filter contains SpanEvent, returns false otherwise.
+    // Can be called from any thread. See also UMScopedTrace.
+    bool beginSpan(quint32 id, const char* string, quint32 size);
+    bool endSpan();
+
     // Log events predefined by the application monitor. Relies on the generic
     // event system.
     bool logEvent(Event event);
 
     // Set the time in milliseconds between two updates of events of a given
-    // type. -1 to disable updates. Only UMEvent::Process is accepted so far as
-    // event type, default value is 1000. Note that when the overlay is enabled,
-    // a process update triggers a frame update.
+    // type. -1 to disable updates. Only UMEvent::Process and
+    // UMEvent::FrameSummary are accepted so far as event types, default values
+    // are respectively 1000 and -1. Note that when the overlay is enabled, a
+    // process update triggers a frame update. Frame times are aggregated in
+    // per window histograms only when frame summary updates are enabled, a
+    // frame summary is emitted at the first frame swapped after the interval
+    // elapsed.
     void setUpdateInterval(UMEvent::Type type, int interval);
     int updateInterval(UMEvent::Type type);
 
+    // Get the latest frame summary event of each monitored window. Empty if
+    // frame summary updates are disabled or if no summary has been emitted
+    // yet.
+    QList<UMEvent> frameSummaries();
+
+    // Set the frame time budget in microseconds above which a long frame event
+    // is emitted, attributing the overrun to the phase of the frame that took
+    // the most time. 0 sets the budget to one and a half refresh period of the
+    // window's screen so that only frames missing a vertical blank are
+    // reported, -1 disables long frame detection (the default). Long frames
+    // are counted by the overlay (see the longFrame* metrics) even if logging
+    // is disabled.
+    void setLongFrameBudget(int budget);
+    int longFrameBudget();
+
+    // Flight recorder keeping the latest events in a fixed size in-memory ring,
+    // independently of the logging state and of the installed loggers, so that
+    // the events leading up to an issue can be dumped to a binary log file (see
+    // UMBinaryLogger) after the fact. setFlightRecorder() sets the period in
+    // milliseconds to keep events for (-1 to disable the flight recorder, the
+    // default) and the ring capacity in number of events, the oldest events are
+    // overwritten when the ring is full. The logging filter applies to the
+    // recorded events too.
+    void setFlightRecorder(int duration, int capacity = 4096);
+    int flightRecorderDuration();
+    int flightRecorderCapacity();
+
+    // Set the file written by dumpFlightRecorder() and when receiving the
+    // flight recorder signal. Empty by default.
+    void setFlightRecorderFile(const QString& fileName);
+    QString flightRecorderFile();
+
+    // Set a Unix signal (SIGUSR2 for instance) triggering a dump of the flight
+    // recorder to the flight recorder file (see requestFlightRecorderDump()).
+    // The handler previously installed for that signal is still called. 0 to
+    // remove the signal handler, the default. Returns false if the handler
+    // can't be installed.
+    bool setFlightRecorderSignal(int signal);
+    int flightRecorderSignal();
+
+    // Dump the events of the flight recorder period to the given binary log
+    // file, or to the flight recorder file if not specified. Returns false if
+    // the flight recorder is disabled, empty or if the file can't be written.
+    // The variant taking a file name can be called from any thread.
+    bool dumpFlightRecorder();
+    bool dumpFlightRecorder(const QString& fileName);
+
+    // Request a dump of the flight recorder to the flight recorder file without
+    // blocking. The file is written by the logging thread once the frame being
+    // rendered at the time of the request has been recorded. Requests made
+    // less than 5 seconds after the previous one are ignored. Returns false if
+    // the request is ignored, if the flight recorder is disabled or if the
+    // monitor isn't started. Must be called from the GUI thread.
+    bool requestFlightRecorderDump();
+
 Q_SIGNALS:
     void overlayChanged();
     void loggingChanged();
     void loggingFilterChanged();
     void loggersChanged();
+    void loggingQueueChanged();
     void updateIntervalChanged(UMEvent::Type type);
+    void longFrameBudgetChanged();
+    void flightRecorderChanged();
 
 private Q_SLOTS:
     void closeDown();
     void processTimeout();
+    void flightRecorderSignalReceived();
 
 private:
     static UMApplicationMonitor* self;
@@ -123,4 +235,38 @@ private:
     Q_DECLARE_PRIVATE(UMApplicationMonitor)
 };
 
+// Trace a span for the whole lifetime of the instance, typically a scope:
+//
+//   {
+//       UMScopedTrace trace(id, "Model loading");
+//       ...
+//   }
+//
+// The UMApplicationMonitor instance is retrieved at construction, so a
+// QGuiApplication instance must be running.
+class UBUNTU_METRICS_EXPORT UMScopedTrace
+{
+public:
+    // Same arguments as UMApplicationMonitor::beginSpan(). The id must be
+    // retrieved from UMApplicationMonitor::registerGenericEvent(), 0 is
+    // reserved for the application monitor.
+    UMScopedTrace(quint32 id, const char* string, quint32 size)
+        : m_applicationMonitor(UMApplicationMonitor::instance()) {
+        Q_ASSERT(id != 0);
+        m_applicationMonitor->beginSpan(id, string, size);
+    }
+    // Convenience constructor for string literals.
+    template <size_t N> UMScopedTrace(quint32 id, const char (&string)[N])
+        : m_applicationMonitor(UMApplicationMonitor::instance()) {
+        Q_ASSERT(id != 0);
+        m_applicationMonitor->beginSpan(id, string, N);
+    }
+    ~UMScopedTrace() { m_applicationMonitor->endSpan(); }
+
+private:
+    Q_DISABLE_COPY(UMScopedTrace)
+
+    UMApplicationMonitor* m_applicationMonitor;
+};
+
 #endif  // APPLICATIONMONITOR_H
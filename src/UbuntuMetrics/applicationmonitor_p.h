@@ -30,17 +30,22 @@
 
 #include <UbuntuMetrics/private/overlay_p.h>
 #include <UbuntuMetrics/private/gputimer_p.h>
+#include <UbuntuMetrics/private/eventqueue_p.h>
+#include <UbuntuMetrics/private/flightrecorder_p.h>
+#include <UbuntuMetrics/private/histogram_p.h>
 #include <UbuntuMetrics/private/ubuntumetricsglobal_p.h>
 
 class LoggingThread;
 class WindowMonitor;
 class QQuickWindow;
+class QSocketNotifier;
 
 class UBUNTU_METRICS_PRIVATE_EXPORT UMApplicationMonitorPrivate
 {
 public:
     static const int maxMonitors = 16;
     static const int maxLoggers = 8;
+    static const int defaultQueueCapacity = 128;
 
     static inline UMApplicationMonitorPrivate* get(UMApplicationMonitor* applicationMonitor) {
         return applicationMonitor->d_func();
@@ -49,9 +54,15 @@ public:
     enum {
         // Lower bit allowed is (1 << 8).
         Overlay     = (1 << 8),
+        // Events are pushed to the logging thread, set if LoggersEnabled or
+        // FlightRecording are set.
         Logging     = (1 << 9),
         Started     = (1 << 10),
         ClosingDown = (1 << 11),
+        // Events are logged with the installed loggers, see setLogging().
+        LoggersEnabled  = (1 << 12),
+        // Events are recorded by the flight recorder.
+        FlightRecording = (1 << 13),
         // Higher bit allowed is (1 << 15).
         FilterMask             = 0x000000ff,
         ApplicationMonitorMask = 0x0000ff00,
@@ -68,6 +79,8 @@ public:
     void stop();
     bool hasMonitor(WindowMonitor* monitor);
     void setMonitoringFlags(quint32 flags);
+    void updateLogging();
+    void updateLoggers();
     void processTimeout();
 
     UMApplicationMonitor* const q_ptr;
@@ -76,6 +89,8 @@ public:
     WindowMonitor* m_monitors[maxMonitors];
     UMLogger* m_loggers[maxLoggers];
     LoggingThread* m_loggingThread;
+    FlightRecorder* m_flightRecorder;
+    QSocketNotifier* m_flightRecorderNotifier;
 #if !defined(QT_NO_DEBUG)
     QGuiApplication* m_application;
 #endif
@@ -85,37 +100,95 @@ public:
     int m_monitorCount;
     int m_loggerCount;
     int m_updateInterval[UMEvent::TypeCount];
+    int m_longFrameBudget;
+    int m_queueCapacity;
+    UMApplicationMonitor::QueuePolicy m_queuePolicy;
+    QAtomicInteger<quint32> m_droppedEventCount;
+    QString m_flightRecorderFile;
+    QElapsedTimer m_flightRecorderDumpTimer;
+    int m_flightRecorderDuration;
+    int m_flightRecorderSignal;
     quint32 m_flags;
     alignas(64) UMEvent m_processEvent;
 };
 
+// LoggingThread drains the events pushed to its queues and logs them with the
+// installed loggers. The shared queue can be pushed to from any thread, the
+// queues created with createQueue() are meant to be pushed to from a single
+// thread (like a QtQuick render thread). Pushing events never takes a lock.
 class UBUNTU_METRICS_PRIVATE_EXPORT LoggingThread : public QThread
 {
 public:
-    LoggingThread();
+    LoggingThread(int queueCapacity, UMApplicationMonitor::QueuePolicy queuePolicy,
+                  QAtomicInteger<quint32>* droppedEventCount, FlightRecorder* flightRecorder);
 
     void run() override;
+
+    // Pushes an event to the shared queue. Can be called from any thread.
     void push(const UMEvent* event);
+
+    // Pushes an event to a queue created with createQueue(). Must always be
+    // called from the same thread for a given queue. Falls back to the shared
+    // queue if queue is null.
+    void push(EventQueue* queue, const UMEvent* event);
+
+    // Creates/Releases a single-producer queue. createQueue() returns null if
+    // there's already maxQueues queues. The events pushed before releasing a
+    // queue are still logged, the queue is deleted by the logging thread once
+    // drained.
+    EventQueue* createQueue();
+    void releaseQueue(EventQueue* queue);
+
+    // Sets the loggers. Waits for the batch being logged, the previous loggers
+    // aren't used anymore when it returns.
     void setLoggers(UMLogger** loggers, int count);
+
+    // Requests a dump of the flight recorder to fileName, done once a frame
+    // time stamped after the request has been recorded so that the frames
+    // waiting for their GPU time are part of it, or after a timeout if the
+    // render loop is idle.
+    void requestDump(const QString& fileName, quint64 duration);
+
     LoggingThread* ref();
     void deref();
 
 private:
+    // Released queues are deleted asynchronously, keep room for new queues
+    // created in the meantime.
+    static const int maxQueues = 2 * UMApplicationMonitorPrivate::maxMonitors;
+
     enum {
-        Waiting       = (1 << 0),
-        JoinRequested = (1 << 1)
+        JoinRequested = (1 << 0),
+        DumpRequested = (1 << 1)
     };
 
     ~LoggingThread();
 
-    UMEvent* m_queue;
+    void wakeUp();
+    bool hasPendingEvents();
+    void processDumpRequest(quint64 latestFrameTimeStamp);
+
+    SharedEventQueue m_sharedQueue;
+    EventQueue* m_queues[maxQueues];
     UMLogger* m_loggers[UMApplicationMonitorPrivate::maxLoggers];
+    UMEvent* m_batch;
+    FlightRecorder* m_flightRecorder;
+    QAtomicInteger<quint32>* m_droppedEventCount;
+    int m_queueCapacity;
+    int m_queueCount;
     int m_loggerCount;
+    UMApplicationMonitor::QueuePolicy m_queuePolicy;
     QMutex m_mutex;
+    // Held while logging, setLoggers() returns once the previous loggers
+    // aren't used anymore so that they can be freed.
+    QMutex m_loggersMutex;
     QWaitCondition m_condition;
     QAtomicInteger<quint32> m_refCount;
-    qint8 m_queueIndex;
-    qint8 m_queueSize;
+    QAtomicInteger<quint32> m_waiting;
+    quint32 m_releasedQueues;  // Bit mask of released queue indices.
+    QString m_dumpFileName;
+    quint64 m_dumpDuration;
+    quint64 m_dumpTimeStamp;
     quint8 m_flags;
 };
 
@@ -171,9 +244,29 @@ public:
     QQuickWindow* window() const { return m_window; }
     void setProcessEvent(const UMEvent& event);
 
+    // Sets the frame summary update interval in milliseconds, -1 to disable
+    // frame time aggregation. Can be called from any thread.
+    void setFrameSummaryInterval(int interval) { m_frameSummaryInterval.store(interval); }
+
+    // Copies the latest frame summary event to event. Returns false if there's
+    // none. Can be called from any thread.
+    bool frameSummary(UMEvent* event);
+
+    // Sets the long frame budget in microseconds, 0 for the automatic budget
+    // and -1 to disable long frame detection. Can be called from any thread.
+    void setLongFrameBudget(int budget) { m_longFrameBudget.store(budget); }
+
+    // Gets the number of refresh periods missed between two frames separated
+    // by deltaTime nanoseconds. The render loop only renders on demand when no
+    // animations are running, so frames can only be missed between two frames
+    // rendered while animating, an idle gap doesn't count.
+    static quint32 missedFrameCount(
+        quint64 deltaTime, quint64 refreshPeriod, bool wasAnimating, bool isAnimating);
+
 private Q_SLOTS:
     void windowSceneGraphInitialized();
     void windowSceneGraphInvalidated();
+    void windowAfterAnimating();
     void windowBeforeSynchronizing();
     void windowAfterSynchronizing();
     void windowBeforeRendering();
@@ -186,7 +279,8 @@ private:
         // Lower bit allowed is (1 << 16).
         GpuResourcesInitialized = (1 << 16),
         GpuTimerAvailable       = (1 << 17),
-        SizeChanged             = (1 << 18)
+        SizeChanged             = (1 << 18),
+        GpuTimerStarted         = (1 << 19)
         // Higher bit allowed is (1 << 31).
     };
 
@@ -196,6 +290,22 @@ private:
     }
     void initializeGpuResources();
     void finalizeGpuResources();
+    // Frame waiting for its GPU time to be collected before being completed,
+    // along with the data needed to attribute a long frame.
+    struct PendingFrame {
+        UMEvent event;
+        quint64 gapTime;
+        quint32 dirtyItemCount;
+        quint32 animationCount;
+        bool waitingGpuTime;
+    };
+    static const int maxPendingFrames = 2 * GPUTimer::maxPendingQueries;
+
+    void collectGpuTimes();
+    void completeFrames(bool flush);
+    void completeFrame(const PendingFrame& frame);
+    void updateFrameSummary(int interval, const PendingFrame& frame);
+    void updateLongFrame(int budget, const PendingFrame& frame);
 
     UMApplicationMonitor* m_applicationMonitor;
     LoggingThread* m_loggingThread;
@@ -205,10 +315,25 @@ private:
     QMutex m_mutex;
     QElapsedTimer m_sceneGraphTimer;
     QElapsedTimer m_deltaTimer;
+    quint64 m_gapTime;
     quint32 m_id;
     quint32 m_flags;
     QSize m_frameSize;
+    EventQueue* m_queue;
+    QElapsedTimer m_frameSummaryTimer;
+    QAtomicInt m_frameSummaryInterval;
+    quint64 m_refreshPeriod;
+    quint32 m_missedFrameCount;
+    bool m_wasAnimating;  // Whether animations were running at the last completed frame.
+    QAtomicInt m_longFrameBudget;
+    QAtomicInt m_animationCount;  // Written by the GUI thread.
+    quint32 m_dirtyItemCount;
+    Histogram m_frameHistograms[UMFrameSummaryEvent::MetricCount];
     UMEvent m_frameEvent;
+    PendingFrame m_pendingFrames[maxPendingFrames];  // Ring, oldest at m_pendingFirst.
+    quint8 m_pendingFirst;
+    quint8 m_pendingCount;
+    UMEvent m_frameSummaryEvent;  // Accessed from different threads (needs locking).
 
     friend class WindowMonitorDeleter;
     friend class WindowMonitorFlagSetter;
@@ -0,0 +1,114 @@
+// Copyright © 2016 Canonical Ltd.
+// Author: Loïc Molinari <loic.molinari@canonical.com>
+//
+// This file is part of Ubuntu UI Toolkit.
+//
+// Ubuntu UI Toolkit is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation; version 3.
+//
+// Ubuntu UI Toolkit is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Ubuntu UI Toolkit. If not, see <http://www.gnu.org/licenses/>.
+
+#include "binarylog_p.h"
+
+#include <string.h>
+
+#include <QtCore/QDir>
+
+const char binaryLogMagic[8] = { 'U', 'M', 'B', 'I', 'N', 'L', 'O', 'G' };
+
+UMBinaryLogReader::UMBinaryLogReader(const QString& fileName)
+    : d_ptr(new UMBinaryLogReaderPrivate(fileName))
+{
+}
+
+UMBinaryLogReaderPrivate::UMBinaryLogReaderPrivate(const QString& fileName)
+    : m_header(nullptr)
+    , m_events(nullptr)
+    , m_eventCount(0)
+{
+    if (QDir::isRelativePath(fileName)) {
+        m_file.setFileName(QString(QDir::currentPath() + QDir::separator() + fileName));
+    } else {
+        m_file.setFileName(fileName);
+    }
+
+    if (!m_file.open(QIODevice::ReadOnly)) {
+        WARN("BinaryLogReader: Can't open file %s '%s'.", fileName.toLatin1().constData(),
+             m_file.errorString().toLatin1().constData());
+        return;
+    }
+    const qint64 size = m_file.size();
+    if (size < static_cast<qint64>(sizeof(UMBinaryLogHeader))) {
+        WARN("BinaryLogReader: File %s is too small.", fileName.toLatin1().constData());
+        m_file.close();
+        return;
+    }
+    uchar* data = m_file.map(0, size);
+    if (!data) {
+        WARN("BinaryLogReader: Can't map file %s '%s'.", fileName.toLatin1().constData(),
+             m_file.errorString().toLatin1().constData());
+        m_file.close();
+        return;
+    }
+
+    const UMBinaryLogHeader* header = reinterpret_cast<const UMBinaryLogHeader*>(data);
+    if (memcmp(header->magic, binaryLogMagic, sizeof(binaryLogMagic))) {
+        WARN("BinaryLogReader: File %s is not a binary log.", fileName.toLatin1().constData());
+    } else if (header->version != UMBinaryLogHeader::currentVersion
+               || header->headerSize != sizeof(UMBinaryLogHeader)
+               || header->eventSize != sizeof(UMEvent)) {
+        WARN("BinaryLogReader: Unsupported binary log version %d in file %s.", header->version,
+             fileName.toLatin1().constData());
+    } else {
+        // Don't trust the event count if the file has been truncated.
+        const quint64 storedEventCount = (size - header->headerSize) / header->eventSize;
+        m_header = header;
+        m_events = reinterpret_cast<const UMEvent*>(&data[header->headerSize]);
+        m_eventCount = qMin(header->eventCount, storedEventCount);
+        return;
+    }
+    m_file.unmap(data);
+    m_file.close();
+}
+
+UMBinaryLogReader::~UMBinaryLogReader()
+{
+    delete d_ptr;
+}
+
+UMBinaryLogReaderPrivate::~UMBinaryLogReaderPrivate()
+{
+    if (m_header) {
+        m_file.unmap(reinterpret_cast<uchar*>(const_cast<UMBinaryLogHeader*>(m_header)));
+    }
+}
+
+bool UMBinaryLogReader::isOpen()
+{
+    return !!d_func()->m_header;
+}
+
+quint32 UMBinaryLogReader::version()
+{
+    Q_D(UMBinaryLogReader);
+    return d->m_header ? d->m_header->version : 0;
+}
+
+quint64 UMBinaryLogReader::eventCount()
+{
+    return d_func()->m_eventCount;
+}
+
+const UMEvent* UMBinaryLogReader::event(quint64 index)
+{
+    Q_D(UMBinaryLogReader);
+    DASSERT(index < d->m_eventCount);
+    return &d->m_events[index];
+}
@@ -0,0 +1,88 @@
+// Copyright © 2016 Canonical Ltd.
+// Author: Loïc Molinari <loic.molinari@canonical.com>
+//
+// This file is part of Ubuntu UI Toolkit.
+//
+// Ubuntu UI Toolkit is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation; version 3.
+//
+// Ubuntu UI Toolkit is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Ubuntu UI Toolkit. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BINARYLOG_H
+#define BINARYLOG_H
+
+#include <QtCore/QString>
+
+#include <UbuntuMetrics/events.h>
+#include <UbuntuMetrics/ubuntumetricsglobal.h>
+
+class UMBinaryLogReaderPrivate;
+
+// Header of the binary log files written by UMBinaryLogger. It is directly
+// followed by eventCount raw UMEvent records. Data is stored in the byte order
+// of the host that wrote the file.
+struct UBUNTU_METRICS_EXPORT UMBinaryLogHeader
+{
+    static const quint32 currentVersion = 1;
+
+    // Identifies the file format, must be "UMBINLOG" (no null-terminating
+    // char).
+    char magic[8];
+
+    // Version of the file format. Must be incremented whenever the header or
+    // the events layout change.
+    quint32 version;
+
+    // Size of the header in bytes.
+    quint32 headerSize;
+
+    // Size of an event record in bytes.
+    quint32 eventSize;
+
+    quint32 __padding;
+
+    // Number of events stored after the header. It is updated after each
+    // event write so that the file stays readable if the process crashes.
+    quint64 eventCount;
+
+    // The whole struct must take 128 bytes so that events are aligned in the
+    // file the same way they are in memory.
+    quint8 __reserved[/*32 bytes taken,*/ 96 /*bytes free*/];
+};
+Q_STATIC_ASSERT(sizeof(UMBinaryLogHeader) == 128);
+
+// Read binary log files written by UMBinaryLogger. The file is memory mapped,
+// events are accessed without copies.
+class UBUNTU_METRICS_EXPORT UMBinaryLogReader
+{
+public:
+    UMBinaryLogReader(const QString& fileName);
+    ~UMBinaryLogReader();
+
+    // Get whether the file has been opened and validated successfully or not.
+    bool isOpen();
+
+    // Get the version of the file format.
+    quint32 version();
+
+    // Get the number of events stored in the file.
+    quint64 eventCount();
+
+    // Get the event at the given index, index must be lower than
+    // eventCount(). The returned pointer stays valid as long as the reader
+    // instance is alive.
+    const UMEvent* event(quint64 index);
+
+private:
+    UMBinaryLogReaderPrivate* const d_ptr;
+    Q_DECLARE_PRIVATE(UMBinaryLogReader)
+};
+
+#endif  // BINARYLOG_H
@@ -0,0 +1,42 @@
+// Copyright © 2016 Canonical Ltd.
+// Author: Loïc Molinari <loic.molinari@canonical.com>
+//
+// This file is part of Ubuntu UI Toolkit.
+//
+// Ubuntu UI Toolkit is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation; version 3.
+//
+// Ubuntu UI Toolkit is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Ubuntu UI Toolkit. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef BINARYLOG_P_H
+#define BINARYLOG_P_H
+
+#include <UbuntuMetrics/binarylog.h>
+
+#include <QtCore/QFile>
+
+#include <UbuntuMetrics/private/ubuntumetricsglobal_p.h>
+
+// Magic identifier stored at the beginning of binary log files.
+extern const char binaryLogMagic[8];
+
+class UBUNTU_METRICS_PRIVATE_EXPORT UMBinaryLogReaderPrivate
+{
+public:
+    UMBinaryLogReaderPrivate(const QString& fileName);
+    ~UMBinaryLogReaderPrivate();
+
+    QFile m_file;
+    const UMBinaryLogHeader* m_header;
+    const UMEvent* m_events;
+    quint64 m_eventCount;
+};
+
+#endif  // BINARYLOG_P_H
@@ -0,0 +1,133 @@
+// Copyright © 2016 Canonical Ltd.
+// Author: Loïc Molinari <loic.molinari@canonical.com>
+//
+// This file is part of Ubuntu UI Toolkit.
+//
+// Ubuntu UI Toolkit is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation; version 3.
+//
+// Ubuntu UI Toolkit is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Ubuntu UI Toolkit. If not, see <http://www.gnu.org/licenses/>.
+
+#include "eventqueue_p.h"
+
+#include <string.h>
+
+const int queueAlignment = 64;
+
+static quint32 roundUpToPowerOfTwo(int value)
+{
+    DASSERT(value > 0);
+    quint32 powerOfTwo = 1;
+    while (powerOfTwo < static_cast<quint32>(value)) {
+        powerOfTwo <<= 1;
+    }
+    return powerOfTwo;
+}
+
+EventQueue::EventQueue(int capacity)
+    : m_mask(roundUpToPowerOfTwo(capacity) - 1)
+    , m_head(0)
+    , m_tail(0)
+{
+    m_events = static_cast<UMEvent*>(
+        alignedAlloc(queueAlignment, (m_mask + 1) * sizeof(UMEvent)));
+}
+
+EventQueue::~EventQueue()
+{
+    free(m_events);
+}
+
+bool EventQueue::push(const UMEvent& event)
+{
+    // The consumer only ever moves the head forward, so reading an outdated
+    // head value can at worst report a full queue spuriously.
+    const quint32 tail = m_tail.load();
+    if (Q_UNLIKELY(tail - m_head.loadAcquire() > m_mask)) {
+        return false;
+    }
+    memcpy(&m_events[tail & m_mask], &event, sizeof(UMEvent));
+    m_tail.storeRelease(tail + 1);
+    return true;
+}
+
+int EventQueue::pop(UMEvent* events, int maxCount)
+{
+    DASSERT(events);
+    DASSERT(maxCount >= 0);
+
+    const quint32 head = m_head.load();
+    const int count = qMin(static_cast<int>(m_tail.loadAcquire() - head), maxCount);
+    for (int i = 0; i < count; ++i) {
+        memcpy(&events[i], &m_events[(head + i) & m_mask], sizeof(UMEvent));
+    }
+    m_head.storeRelease(head + count);
+    return count;
+}
+
+SharedEventQueue::SharedEventQueue(int capacity)
+    : m_mask(roundUpToPowerOfTwo(capacity) - 1)
+    , m_head(0)
+    , m_tail(0)
+{
+    m_events = static_cast<UMEvent*>(
+        alignedAlloc(queueAlignment, (m_mask + 1) * sizeof(UMEvent)));
+    m_sequences = new QAtomicInteger<quint32>[m_mask + 1];
+    for (quint32 i = 0; i <= m_mask; ++i) {
+        m_sequences[i].store(i);
+    }
+}
+
+SharedEventQueue::~SharedEventQueue()
+{
+    delete [] m_sequences;
+    free(m_events);
+}
+
+bool SharedEventQueue::push(const UMEvent& event)
+{
+    // Producers reserve a slot by moving the tail forward, the event is then
+    // published to the consumer by updating the slot sequence number.
+    quint32 tail = m_tail.load();
+    while (true) {
+        const qint32 difference =
+            static_cast<qint32>(m_sequences[tail & m_mask].loadAcquire() - tail);
+        if (difference == 0) {
+            if (m_tail.testAndSetRelaxed(tail, tail + 1, tail)) {
+                break;
+            }
+        } else if (difference < 0) {
+            return false;
+        } else {
+            tail = m_tail.load();
+        }
+    }
+    memcpy(&m_events[tail & m_mask], &event, sizeof(UMEvent));
+    m_sequences[tail & m_mask].storeRelease(tail + 1);
+    return true;
+}
+
+int SharedEventQueue::pop(UMEvent* events, int maxCount)
+{
+    DASSERT(events);
+    DASSERT(maxCount >= 0);
+
+    int count = 0;
+    while (count < maxCount) {
+        const quint32 index = m_head & m_mask;
+        if (m_sequences[index].loadAcquire() != m_head + 1) {
+            break;
+        }
+        memcpy(&events[count++], &m_events[index], sizeof(UMEvent));
+        m_sequences[index].storeRelease(m_head + m_mask + 1);
+        m_head++;
+    }
+    return count;
+}
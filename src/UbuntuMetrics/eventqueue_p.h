@@ -0,0 +1,93 @@
+// Copyright © 2016 Canonical Ltd.
+// Author: Loïc Molinari <loic.molinari@canonical.com>
+//
+// This file is part of Ubuntu UI Toolkit.
+//
+// Ubuntu UI Toolkit is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation; version 3.
+//
+// Ubuntu UI Toolkit is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Ubuntu UI Toolkit. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef EVENTQUEUE_P_H
+#define EVENTQUEUE_P_H
+
+#include <QtCore/QAtomicInteger>
+
+#include <UbuntuMetrics/events.h>
+#include <UbuntuMetrics/private/ubuntumetricsglobal_p.h>
+
+// EventQueue is a bounded wait-free single-producer/single-consumer ring of
+// events. push() must always be called from the same thread and pop() from
+// another (but always the same) thread. The capacity is rounded up to the next
+// power-of-two.
+class UBUNTU_METRICS_PRIVATE_EXPORT EventQueue
+{
+public:
+    EventQueue(int capacity);
+    ~EventQueue();
+
+    int capacity() const { return m_mask + 1; }
+
+    // Pushes an event. Returns false if the queue is full.
+    bool push(const UMEvent& event);
+
+    // Pops at most maxCount of the oldest events into events. Returns the
+    // number of events popped.
+    int pop(UMEvent* events, int maxCount);
+
+    // Gets whether the queue is empty or not. Must be called from the consumer
+    // thread.
+    bool isEmpty() const { return m_tail.loadAcquire() == m_head.load(); }
+
+private:
+    UMEvent* m_events;
+    quint32 m_mask;
+    // Indices are kept on separate cache lines to avoid false sharing between
+    // the producer and the consumer.
+    alignas(64) QAtomicInteger<quint32> m_head;  // Written by the consumer.
+    alignas(64) QAtomicInteger<quint32> m_tail;  // Written by the producer.
+};
+
+// SharedEventQueue is a bounded lock-free multi-producer/single-consumer ring
+// of events. push() can be called concurrently from any thread and pop() from
+// another (but always the same) thread. The capacity is rounded up to the next
+// power-of-two.
+class UBUNTU_METRICS_PRIVATE_EXPORT SharedEventQueue
+{
+public:
+    SharedEventQueue(int capacity);
+    ~SharedEventQueue();
+
+    int capacity() const { return m_mask + 1; }
+
+    // Pushes an event. Returns false if the queue is full.
+    bool push(const UMEvent& event);
+
+    // Pops at most maxCount of the oldest events into events. Returns the
+    // number of events popped.
+    int pop(UMEvent* events, int maxCount);
+
+    // Gets whether the queue is empty or not. Must be called from the consumer
+    // thread.
+    bool isEmpty() const {
+        return m_sequences[m_head & m_mask].loadAcquire() != m_head + 1;
+    }
+
+private:
+    UMEvent* m_events;
+    // Each slot has a sequence number telling whether it's ready to be written
+    // (sequence == index) or read (sequence == index + 1).
+    QAtomicInteger<quint32>* m_sequences;
+    quint32 m_mask;
+    quint32 m_head;  // Only accessed by the consumer.
+    alignas(64) QAtomicInteger<quint32> m_tail;  // Shared by the producers.
+};
+
+#endif  // EVENTQUEUE_P_H
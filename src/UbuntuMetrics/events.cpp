@@ -20,15 +20,44 @@
 #include <string.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <pthread.h>
+#include <sys/resource.h>
 #include <cstdio>
+#include <cstdlib>
 
 #include <QtCore/QElapsedTimer>
+#include <QtCore/QMutex>
 
 #include "ubuntumetricsglobal_p.h"
 
-const int bufferSize = 128;
+// Big enough to store the content of /proc/self/smaps_rollup.
+const int bufferSize = 1024;
 const int bufferAlignment = 64;
 
+// Process wide registry of the threads whose CPU usage is reported. Each
+// registration gets a new serial (0 marks free slots) so that the
+// EventUtilsPrivate instances sampling the CPU clocks can detect reused slots.
+static struct {
+    QMutex mutex;
+    clockid_t clocks[EventUtilsPrivate::maxThreads];
+    quint32 serials[EventUtilsPrivate::maxThreads];
+    UMProcessEvent::ThreadType types[EventUtilsPrivate::maxThreads];
+    quint32 lastSerial;
+} threadRegistry;
+
+// Gets the time in nanoseconds of a CPU-time clock. Returns false if the clock
+// is invalid, like for the clock of a terminated thread.
+static bool cpuTime(clockid_t clock, quint64* time)
+{
+    struct timespec timeSpec;
+    if (clock_gettime(clock, &timeSpec) == 0) {
+        *time = timeSpec.tv_sec * Q_UINT64_C(1000000000) + timeSpec.tv_nsec;
+        return true;
+    } else {
+        return false;
+    }
+}
+
 UMEventUtils::UMEventUtils()
     : d_ptr(new EventUtilsPrivate)
 {
@@ -42,9 +71,32 @@ EventUtilsPrivate::EventUtilsPrivate()
     m_buffer = static_cast<char*>(alignedAlloc(bufferAlignment, bufferSize));
 #endif
     m_cpuTimer.start();
-    m_cpuTicks = times(&m_cpuTimes);
+    if (!cpuTime(CLOCK_PROCESS_CPUTIME_ID, &m_processCpuTime)) {
+        m_processCpuTime = 0;
+    }
+    memset(m_threadSerials, 0, sizeof(m_threadSerials));
     m_cpuOnlineCores = sysconf(_SC_NPROCESSORS_ONLN);
     m_pageSize = sysconf(_SC_PAGESIZE);
+
+    // The proc files are kept open and read from the beginning at each update
+    // to save the open and close syscalls.
+    if ((m_statFd = open("/proc/self/stat", O_RDONLY | O_CLOEXEC)) == -1) {
+        DWARN("EventUtils: can't open '/proc/self/stat'");
+    }
+    if ((m_smapsRollupFd = open("/proc/self/smaps_rollup", O_RDONLY | O_CLOEXEC)) == -1) {
+        DLOG("EventUtils: can't open '/proc/self/smaps_rollup'");
+    }
+    if ((m_ioFd = open("/proc/self/io", O_RDONLY | O_CLOEXEC)) == -1) {
+        DLOG("EventUtils: can't open '/proc/self/io'");
+    }
+
+    // Initialise the counters reported as differences between updates.
+    UMEvent event;
+    m_minorFaultCount = m_majorFaultCount = 0;
+    m_voluntaryContextSwitchCount = m_involuntaryContextSwitchCount = 0;
+    m_readBytes = m_writeBytes = 0;
+    updateResourceUsage(&event);
+    updateIoMetrics(&event);
 }
 
 UMEventUtils::~UMEventUtils()
@@ -54,6 +106,15 @@ UMEventUtils::~UMEventUtils()
 
 EventUtilsPrivate::~EventUtilsPrivate()
 {
+    if (m_statFd != -1) {
+        close(m_statFd);
+    }
+    if (m_smapsRollupFd != -1) {
+        close(m_smapsRollupFd);
+    }
+    if (m_ioFd != -1) {
+        close(m_ioFd);
+    }
     free(m_buffer);
 }
 
@@ -66,39 +127,92 @@ void UMEventUtils::updateProcessEvent(UMEvent* event)
     event->timeStamp = UMEventUtils::timeStamp();
     d->updateCpuUsage(event);
     d->updateProcStatMetrics(event);
+    d->updateResourceUsage(event);
+    d->updateSmapsRollupMetrics(event);
+    d->updateIoMetrics(event);
 }
 
-void EventUtilsPrivate::updateCpuUsage(UMEvent* event)
+// Reads a proc file from the beginning into the buffer with a single syscall,
+// the content is null-terminated. Returns the size read or -1 on error.
+int EventUtilsPrivate::readFile(int fd, const char* fileName)
 {
-    // times() is a Linux syscall giving CPU times used by the process. The
-    // granularity of the unit returned by the (some?) kernel (clock ticks)
-    // prevents us from getting precise timings at a high frequency, so we have
-    // to throttle to 200 ms (5 Hz).
-    const qint64 throttlingFrequency = 200;
-    if (m_cpuTimer.elapsed() > throttlingFrequency) {
-        struct tms newCpuTimes;
-        const clock_t newTicks = times(&newCpuTimes);
-        const clock_t ticks = newTicks - m_cpuTicks;
-        const clock_t userTime = newCpuTimes.tms_utime - m_cpuTimes.tms_utime;
-        const clock_t systemTime = newCpuTimes.tms_stime - m_cpuTimes.tms_stime;
-        event->process.cpuUsage = ((userTime + systemTime) * 100) / (ticks * m_cpuOnlineCores);
-        m_cpuTimer.start();
-        memcpy(&m_cpuTimes, &newCpuTimes, sizeof(struct tms));
-        m_cpuTicks = newTicks;
+    if (fd == -1) {
+        return -1;
+    }
+    const int readSize = pread(fd, m_buffer, bufferSize - 1, 0);
+    if (readSize <= 0) {
+        DWARN("EventUtils: can't read '%s'", fileName);
+        return -1;
     }
+    m_buffer[readSize] = '\0';
+    return readSize;
 }
 
-void EventUtilsPrivate::updateProcStatMetrics(UMEvent* event)
+// Gets the value of a "<key> <value>" line in the buffer. Returns 0 if not
+// found.
+static quint64 keyValue(const char* buffer, const char* key, int keySize)
 {
-    int fd = open("/proc/self/stat", O_RDONLY);
-    if (fd == -1) {
-        DWARN("EventUtils: can't open '/proc/self/stat'");
+    for (const char* line = buffer; line; line = strchr(line, '\n')) {
+        if (*line == '\n') {
+            line++;
+        }
+        if (!strncmp(line, key, keySize)) {
+            return strtoull(&line[keySize], nullptr, 10);
+        }
+    }
+    return 0;
+}
+
+void EventUtilsPrivate::updateCpuUsage(UMEvent* event)
+{
+    // CPU-time clocks have a nanosecond resolution (as opposed to the clock
+    // ticks returned by times()), usages can be computed at any frequency.
+    const quint64 elapsedTime = m_cpuTimer.nsecsElapsed();
+    if (elapsedTime == 0) {
         return;
     }
+    m_cpuTimer.start();
+
+    quint64 processCpuTime;
+    if (cpuTime(CLOCK_PROCESS_CPUTIME_ID, &processCpuTime)) {
+        event->process.cpuUsage = static_cast<quint16>(qMin<quint64>(
+            ((processCpuTime - m_processCpuTime) * 100) / (elapsedTime * m_cpuOnlineCores),
+            0xffff));
+        m_processCpuTime = processCpuTime;
+    }
+
+    quint64 threadCpuTimes[UMProcessEvent::ThreadTypeCount] = {};
+    threadRegistry.mutex.lock();
+    for (int i = 0; i < maxThreads; ++i) {
+        const quint32 serial = threadRegistry.serials[i];
+        quint64 time;
+        if (serial == 0) {
+            m_threadSerials[i] = 0;
+        } else if (!cpuTime(threadRegistry.clocks[i], &time)) {
+            // The thread terminated without being unregistered.
+            threadRegistry.serials[i] = 0;
+            m_threadSerials[i] = 0;
+        } else {
+            // A thread only starts to be accounted at its second sample.
+            if (m_threadSerials[i] == serial) {
+                threadCpuTimes[threadRegistry.types[i]] += time - m_threadCpuTimes[i];
+            }
+            m_threadSerials[i] = serial;
+            m_threadCpuTimes[i] = time;
+        }
+    }
+    threadRegistry.mutex.unlock();
+
+    for (int i = 0; i < UMProcessEvent::ThreadTypeCount; ++i) {
+        event->process.threadCpuUsage[i] = static_cast<quint16>(
+            qMin<quint64>((threadCpuTimes[i] * 100) / elapsedTime, 0xffff));
+    }
+}
+
+void EventUtilsPrivate::updateProcStatMetrics(UMEvent* event)
+{
     int readSize;
-    if ((readSize = read(fd, m_buffer, bufferSize)) == 0) {
-        DWARN("EventUtils: can't read '/proc/self/stat'");
-        close(fd);
+    if ((readSize = readFile(m_statFd, "/proc/self/stat")) == -1) {
         return;
     }
 
@@ -119,9 +233,8 @@ void EventUtilsPrivate::updateProcStatMetrics(UMEvent* event)
                 entryIndices[++spaceCount] = sourceIndex;
             }
         } else {
-            DASSERT(readSize == bufferSize); // Missing entries in /proc/self/stat.
+            DASSERT(readSize == bufferSize - 1); // Missing entries in /proc/self/stat.
             DNOT_REACHED();  // Consider increasing bufferSize.
-            close(fd);
             return;
         }
     }
@@ -141,8 +254,111 @@ void EventUtilsPrivate::updateProcStatMetrics(UMEvent* event)
     event->process.vszMemory = vsize >> 10;
     event->process.rssMemory = (rss * m_pageSize) >> 10;
     event->process.threadCount = threadCount;
+}
+
+void EventUtilsPrivate::updateResourceUsage(UMEvent* event)
+{
+    // getrusage() accounts the context switches of all the threads, as opposed
+    // to /proc/self/status which only accounts the main thread.
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) == -1) {
+        DWARN("EventUtils: can't get resource usage");
+        return;
+    }
+
+    event->process.minorFaultCount = usage.ru_minflt - m_minorFaultCount;
+    event->process.majorFaultCount = usage.ru_majflt - m_majorFaultCount;
+    event->process.voluntaryContextSwitchCount = usage.ru_nvcsw - m_voluntaryContextSwitchCount;
+    event->process.involuntaryContextSwitchCount =
+        usage.ru_nivcsw - m_involuntaryContextSwitchCount;
+    m_minorFaultCount = usage.ru_minflt;
+    m_majorFaultCount = usage.ru_majflt;
+    m_voluntaryContextSwitchCount = usage.ru_nvcsw;
+    m_involuntaryContextSwitchCount = usage.ru_nivcsw;
+}
+
+void EventUtilsPrivate::updateSmapsRollupMetrics(UMEvent* event)
+{
+    if (readFile(m_smapsRollupFd, "/proc/self/smaps_rollup") == -1) {
+        event->process.pssMemory = 0;
+        event->process.ussMemory = 0;
+        return;
+    }
+
+    // Values are in kilobytes.
+    event->process.pssMemory = keyValue(m_buffer, "Pss:", sizeof("Pss:") - 1);
+    event->process.ussMemory =
+        keyValue(m_buffer, "Private_Clean:", sizeof("Private_Clean:") - 1)
+        + keyValue(m_buffer, "Private_Dirty:", sizeof("Private_Dirty:") - 1);
+}
+
+void EventUtilsPrivate::updateIoMetrics(UMEvent* event)
+{
+    if (readFile(m_ioFd, "/proc/self/io") == -1) {
+        event->process.readBytes = 0;
+        event->process.writeBytes = 0;
+        return;
+    }
+
+    const quint64 readBytes = keyValue(m_buffer, "read_bytes:", sizeof("read_bytes:") - 1);
+    const quint64 writeBytes = keyValue(m_buffer, "write_bytes:", sizeof("write_bytes:") - 1);
+    event->process.readBytes = readBytes - m_readBytes;
+    event->process.writeBytes = writeBytes - m_writeBytes;
+    m_readBytes = readBytes;
+    m_writeBytes = writeBytes;
+}
 
-    close(fd);
+// static.
+bool UMEventUtils::registerThread(UMProcessEvent::ThreadType type)
+{
+    DASSERT(type < UMProcessEvent::ThreadTypeCount);
+
+    clockid_t clock;
+    if (pthread_getcpuclockid(pthread_self(), &clock) != 0) {
+        DWARN("EventUtils: can't get the thread CPU-time clock");
+        return false;
+    }
+
+    QMutexLocker locker(&threadRegistry.mutex);
+    int freeSlot = -1;
+    for (int i = 0; i < EventUtilsPrivate::maxThreads; ++i) {
+        if (threadRegistry.serials[i] == 0) {
+            if (freeSlot == -1) {
+                freeSlot = i;
+            }
+        } else if (threadRegistry.clocks[i] == clock) {
+            threadRegistry.types[i] = type;
+            return true;
+        }
+    }
+    if (freeSlot == -1) {
+        DWARN("EventUtils: too many registered threads");
+        return false;
+    }
+    if (++threadRegistry.lastSerial == 0) {
+        threadRegistry.lastSerial = 1;
+    }
+    threadRegistry.clocks[freeSlot] = clock;
+    threadRegistry.types[freeSlot] = type;
+    threadRegistry.serials[freeSlot] = threadRegistry.lastSerial;
+    return true;
+}
+
+// static.
+void UMEventUtils::unregisterThread()
+{
+    clockid_t clock;
+    if (pthread_getcpuclockid(pthread_self(), &clock) != 0) {
+        return;
+    }
+
+    QMutexLocker locker(&threadRegistry.mutex);
+    for (int i = 0; i < EventUtilsPrivate::maxThreads; ++i) {
+        if (threadRegistry.serials[i] != 0 && threadRegistry.clocks[i] == clock) {
+            threadRegistry.serials[i] = 0;
+            return;
+        }
+    }
 }
 
 // static.
@@ -26,6 +26,10 @@
 
 struct UBUNTU_METRICS_EXPORT UMProcessEvent
 {
+    // Threads whose CPU usage is reported individually. See
+    // UMEventUtils::registerThread().
+    enum ThreadType { GuiThread = 0, RenderThread = 1, LoggingThread = 2, ThreadTypeCount = 3 };
+
     // Virtual size of the process in kilobytes.
     quint32 vszMemory;
 
@@ -39,9 +43,41 @@ struct UBUNTU_METRICS_EXPORT UMProcessEvent
     // Number of threads at buffer swap.
     quint16 threadCount;
 
+    // CPU usage of the GUI, render and logging threads as a percentage of a
+    // single core, indexed by thread type. The usage of all the threads of a
+    // type is summed up (the render threads of different windows for
+    // instance), 0 if no thread of that type is registered.
+    quint16 threadCpuUsage[ThreadTypeCount];
+
+    quint16 __padding;
+
+    // Proportional set size (PSS) of the process in kilobytes, shared pages
+    // are accounted proportionally to the number of processes mapping them.
+    // 0 if not supported by the kernel (Linux >= 4.14 is required).
+    quint32 pssMemory;
+
+    // Unique set size (USS) of the process in kilobytes, the memory that would
+    // be freed if the process was terminated. 0 if not supported by the kernel.
+    quint32 ussMemory;
+
+    // Number of minor (not requiring I/O) and major (requiring I/O) page
+    // faults since the previous process event.
+    quint32 minorFaultCount;
+    quint32 majorFaultCount;
+
+    // Number of voluntary (blocking on a resource) and involuntary (preempted)
+    // context switches of all the threads since the previous process event.
+    quint32 voluntaryContextSwitchCount;
+    quint32 involuntaryContextSwitchCount;
+
+    // Number of bytes read from and written to the storage layer since the
+    // previous process event.
+    quint32 readBytes;
+    quint32 writeBytes;
+
     // The whole struct must take 112 bytes to allow future additions and best
     // memory alignment, don't forget to update when adding new metrics.
-    quint8 __reserved[/*12 bytes taken,*/ 100 /*bytes free*/];
+    quint8 __reserved[/*52 bytes taken,*/ 60 /*bytes free*/];
 };
 Q_STATIC_ASSERT(sizeof(UMProcessEvent) == 112);
 
@@ -87,7 +123,9 @@ struct UBUNTU_METRICS_EXPORT UMFrameEvent
     quint64 renderTime;
 
     // Time in nanoseconds taken by the GPU to execute the graphics commands
-    // pushed during the QtQuick scene graph render pass.
+    // pushed during the QtQuick scene graph render pass, 0 if it couldn't be
+    // measured. GPU times are collected a few frames later so that measuring
+    // doesn't stall the rendering, frame events are delayed accordingly.
     quint64 gpuTime;
 
     // Time in nanoseconds taken by the graphics subsystem's buffer swap call.
@@ -118,9 +156,126 @@ struct UBUNTU_METRICS_EXPORT UMGenericEvent
 };
 Q_STATIC_ASSERT(sizeof(UMGenericEvent) == 112);
 
+struct UBUNTU_METRICS_EXPORT UMFrameSummaryEvent
+{
+    enum Metric {
+        DeltaTime = 0, SyncTime = 1, RenderTime = 2, GpuTime = 3, SwapTime = 4, MetricCount = 5
+    };
+    enum Statistic { P50 = 0, P90 = 1, P99 = 2, Max = 3, StatisticCount = 4 };
+
+    // The id of the window on which the frames have been rendered.
+    quint32 window;
+
+    // Number of frames rendered during the summary period.
+    quint32 frameCount;
+
+    // Number of refresh periods missed during the summary period. A frame
+    // swapped n refresh periods after the previous one counts as n-1 missed
+    // frames.
+    quint32 missedFrameCount;
+
+    // Frame time statistics in microseconds over the summary period, indexed by
+    // metric and statistic (the 50th, 90th and 99th percentiles have a
+    // relative precision of about 6%). Metrics correspond to the UMFrameEvent
+    // times of the same name.
+    quint32 times[MetricCount][StatisticCount];
+
+    // The whole struct must take 112 bytes to allow future additions and best
+    // memory alignment, don't forget to update when adding new metrics.
+    quint8 __reserved[/*92 bytes taken,*/ 20 /*bytes free*/];
+};
+Q_STATIC_ASSERT(sizeof(UMFrameSummaryEvent) == 112);
+
+struct UBUNTU_METRICS_EXPORT UMSpanEvent
+{
+    static const quint32 maxStringSize = 64;
+    static const quint16 maxDepth = 32;
+
+    enum Phase { Begin = 0, End = 1, PhaseCount = 2 };
+
+    // Id retrieved from UMApplicationMonitor::registerGenericEvent(), 0 is
+    // reserved for spans defined by the application monitor.
+    quint32 id;
+
+    // Id of the thread (kernel thread id on Linux) on which the span has been
+    // traced.
+    quint32 threadId;
+
+    // Time in nanoseconds elapsed since the beginning of the span. Always 0 for
+    // the Begin phase.
+    quint64 duration;
+
+    // Nesting depth of the span in its thread, starting from 0.
+    quint16 depth;
+
+    // Phase of the span.
+    Phase phase : 8;
+
+    // Size of the string (including the null-terminating char).
+    quint8 stringSize;
+
+    // Null-terminated string naming the span.
+    char string[maxStringSize];
+
+    // The whole struct must take 112 bytes to allow future additions and best
+    // memory alignment, don't forget to update when adding new metrics.
+    quint8 __reserved[/*84 bytes taken,*/ 28 /*bytes free*/];
+};
+Q_STATIC_ASSERT(sizeof(UMSpanEvent) == 112);
+
+struct UBUNTU_METRICS_EXPORT UMLongFrameEvent
+{
+    // Phases of a frame, Gap is the time between the previous frame swap and
+    // the synchronization pass, spent by the GUI thread in event handling,
+    // animations and polishing.
+    enum Phase { Gap = 0, Sync = 1, Render = 2, Gpu = 3, Swap = 4, PhaseCount = 5 };
+
+    // The id of the window on which the frame has been rendered.
+    quint32 window;
+
+    // The frame number, see UMFrameEvent::number.
+    quint32 number;
+
+    // Frame time budget in nanoseconds that has been exceeded.
+    quint64 budget;
+
+    // Time in nanoseconds taken by the frame. Sum of the gap (only accounted
+    // when animations are running, the render loop being idle otherwise),
+    // sync, render and swap times. The GPU time isn't included since it
+    // overlaps the render and swap times.
+    quint64 frameTime;
+
+    // Time in nanoseconds taken by each phase, indexed by phase. 0 if not
+    // available (the gap when there's no running animations, the GPU time
+    // when there's no GPU timer).
+    quint64 phaseTimes[PhaseCount];
+
+    // Number of items whose scene graph nodes have been updated during the
+    // synchronization pass.
+    quint32 dirtyItemCount;
+
+    // Number of animations running in the GUI thread when the frame was
+    // requested.
+    quint32 animationCount;
+
+    quint32 __padding;
+
+    // The phase that took the most time, considered as responsible for the
+    // budget overrun.
+    Phase phase : 8;
+
+    // The whole struct must take 112 bytes to allow future additions and best
+    // memory alignment, don't forget to update when adding new metrics.
+    quint8 __reserved[/*77 bytes taken,*/ 35 /*bytes free*/];
+};
+Q_STATIC_ASSERT(sizeof(UMLongFrameEvent) == 112);
+
 struct UBUNTU_METRICS_EXPORT UMEvent
 {
-    enum Type { Process = 0, Window = 1, Frame = 2, Generic = 3, TypeCount = 4 };
+    enum Type {
+        Process = 0, Window = 1, Frame = 2, Generic = 3, FrameSummary = 4, Span = 5,
+        LongFrame = 6, TypeCount = 7
+    };
 
     // Event type.
     Type type;
@@ -133,6 +288,9 @@ struct UBUNTU_METRICS_EXPORT UMEvent
         UMWindowEvent window;
         UMFrameEvent frame;
         UMGenericEvent generic;
+        UMFrameSummaryEvent frameSummary;
+        UMSpanEvent span;
+        UMLongFrameEvent longFrame;
     };
 };
 Q_STATIC_ASSERT(sizeof(UMEvent) == 128);
@@ -146,9 +304,17 @@ public:
     UMEventUtils();
     ~UMEventUtils();
 
-    // Fill the given event with updated process metrics.
+    // Fill the given event with updated process metrics. CPU usages are
+    // computed over the time elapsed since the previous call.
     void updateProcessEvent(UMEvent* event);
 
+    // Register the calling thread so that its CPU usage is reported in the
+    // process events with the given type, registering an already registered
+    // thread updates its type. Threads should be unregistered before
+    // exiting. Returns false if too many threads are registered. Thread-safe.
+    static bool registerThread(UMProcessEvent::ThreadType type);
+    static void unregisterThread();
+
     // Get a time stamp in nanoseconds. The timer is started at the first call,
     // returning 0.
     static quint64 timeStamp();
@@ -20,7 +20,7 @@
 
 #include <UbuntuMetrics/events.h>
 
-#include <sys/times.h>
+#include <time.h>
 
 #include <QtCore/QElapsedTimer>
 
@@ -29,16 +29,33 @@
 class UBUNTU_METRICS_PRIVATE_EXPORT EventUtilsPrivate
 {
 public:
+    // Maximum number of threads registered with UMEventUtils::registerThread().
+    static const int maxThreads = 32;
+
     EventUtilsPrivate();
     ~EventUtilsPrivate();
 
     void updateCpuUsage(UMEvent* event);
     void updateProcStatMetrics(UMEvent* event);
+    void updateResourceUsage(UMEvent* event);
+    void updateSmapsRollupMetrics(UMEvent* event);
+    void updateIoMetrics(UMEvent* event);
+    int readFile(int fd, const char* fileName);
 
     char* m_buffer;
+    int m_statFd;
+    int m_smapsRollupFd;
+    int m_ioFd;
     QElapsedTimer m_cpuTimer;
-    struct tms m_cpuTimes;
-    clock_t m_cpuTicks;
+    quint64 m_processCpuTime;
+    quint64 m_threadCpuTimes[maxThreads];
+    quint32 m_threadSerials[maxThreads];
+    quint64 m_minorFaultCount;
+    quint64 m_majorFaultCount;
+    quint64 m_voluntaryContextSwitchCount;
+    quint64 m_involuntaryContextSwitchCount;
+    quint64 m_readBytes;
+    quint64 m_writeBytes;
     quint16 m_cpuOnlineCores;
     quint16 m_pageSize;
 };
@@ -0,0 +1,141 @@
+// Copyright © 2016 Canonical Ltd.
+// Author: Loïc Molinari <loic.molinari@canonical.com>
+//
+// This file is part of Ubuntu UI Toolkit.
+//
+// Ubuntu UI Toolkit is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation; version 3.
+//
+// Ubuntu UI Toolkit is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Ubuntu UI Toolkit. If not, see <http://www.gnu.org/licenses/>.
+
+#include "flightrecorder_p.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <UbuntuMetrics/logger.h>
+
+FlightRecorder::FlightRecorder()
+    : m_events(nullptr)
+    , m_count(0)
+    , m_capacity(0)
+    , m_refCount(1)
+{
+}
+
+FlightRecorder::~FlightRecorder()
+{
+    free(m_events);
+}
+
+void FlightRecorder::setCapacity(int capacity)
+{
+    DASSERT(capacity >= 0);
+
+    QMutexLocker locker(&m_mutex);
+    if (capacity != m_capacity) {
+        free(m_events);
+        m_events = capacity > 0
+            ? static_cast<UMEvent*>(alignedAlloc(64, capacity * sizeof(UMEvent))) : nullptr;
+        m_capacity = m_events ? capacity : 0;
+    }
+    m_count = 0;
+}
+
+int FlightRecorder::capacity()
+{
+    QMutexLocker locker(&m_mutex);
+    return m_capacity;
+}
+
+void FlightRecorder::record(const UMEvent* events, int count)
+{
+    DASSERT(events);
+    DASSERT(count >= 0);
+
+    QMutexLocker locker(&m_mutex);
+    if (m_capacity == 0) {
+        return;
+    }
+
+    // Only the last capacity events of the batch can be kept.
+    if (count > m_capacity) {
+        m_count += count - m_capacity;
+        events = &events[count - m_capacity];
+        count = m_capacity;
+    }
+    const int index = static_cast<int>(m_count % m_capacity);
+    const int firstCount = qMin(count, m_capacity - index);
+    memcpy(&m_events[index], events, firstCount * sizeof(UMEvent));
+    if (firstCount < count) {
+        memcpy(m_events, &events[firstCount], (count - firstCount) * sizeof(UMEvent));
+    }
+    m_count += count;
+}
+
+bool FlightRecorder::dump(const QString& fileName, quint64 duration)
+{
+    // Copy the ring in chronological order so that the logging thread isn't
+    // blocked while writing the file.
+    m_mutex.lock();
+    const int count = static_cast<int>(qMin<quint64>(m_count, m_capacity));
+    if (count == 0) {
+        m_mutex.unlock();
+        return false;
+    }
+    UMEvent* events = static_cast<UMEvent*>(malloc(count * sizeof(UMEvent)));
+    if (!events) {
+        m_mutex.unlock();
+        return false;
+    }
+    const int oldest = static_cast<int>((m_count - count) % m_capacity);
+    const int firstCount = qMin(count, m_capacity - oldest);
+    memcpy(events, &m_events[oldest], firstCount * sizeof(UMEvent));
+    memcpy(&events[firstCount], m_events, (count - firstCount) * sizeof(UMEvent));
+    m_mutex.unlock();
+
+    // Events of different queues are interleaved by batches, so the time
+    // stamps are not strictly increasing. Filter them individually.
+    quint64 latestTimeStamp = 0;
+    for (int i = 0; i < count; ++i) {
+        latestTimeStamp = qMax(latestTimeStamp, events[i].timeStamp);
+    }
+    const quint64 oldestTimeStamp = latestTimeStamp > duration ? latestTimeStamp - duration : 0;
+    int keptCount = 0;
+    for (int i = 0; i < count; ++i) {
+        if (events[i].timeStamp >= oldestTimeStamp) {
+            if (keptCount != i) {
+                memcpy(&events[keptCount], &events[i], sizeof(UMEvent));
+            }
+            keptCount++;
+        }
+    }
+
+    UMBinaryLogger logger(fileName, keptCount);
+    const bool open = logger.isOpen();
+    if (open) {
+        logger.log(events, keptCount);
+    }
+    free(events);
+    return open && logger.isOpen();
+}
+
+FlightRecorder* FlightRecorder::ref()
+{
+    m_refCount.ref();
+    return this;
+}
+
+void FlightRecorder::deref()
+{
+    if (m_refCount.deref() == 0) {
+        delete this;
+    }
+}
@@ -0,0 +1,63 @@
+// Copyright © 2016 Canonical Ltd.
+// Author: Loïc Molinari <loic.molinari@canonical.com>
+//
+// This file is part of Ubuntu UI Toolkit.
+//
+// Ubuntu UI Toolkit is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation; version 3.
+//
+// Ubuntu UI Toolkit is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Ubuntu UI Toolkit. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef FLIGHTRECORDER_P_H
+#define FLIGHTRECORDER_P_H
+
+#include <QtCore/QAtomicInteger>
+#include <QtCore/QMutex>
+#include <QtCore/QString>
+
+#include <UbuntuMetrics/events.h>
+#include <UbuntuMetrics/private/ubuntumetricsglobal_p.h>
+
+// FlightRecorder keeps the latest events in a fixed size ring, the oldest
+// events being overwritten when full. Events are recorded by the logging thread
+// and can be dumped from any thread. It's reference counted since the logging
+// thread can outlive the application monitor.
+class UBUNTU_METRICS_PRIVATE_EXPORT FlightRecorder
+{
+public:
+    FlightRecorder();
+
+    // Sets the ring capacity in number of events, 0 frees the ring. Recorded
+    // events are discarded.
+    void setCapacity(int capacity);
+    int capacity();
+
+    // Records count events.
+    void record(const UMEvent* events, int count);
+
+    // Writes the recorded events time stamped at most duration nanoseconds
+    // before the latest one to a binary log file (see UMBinaryLogger). Returns
+    // false if there's no events or if the file can't be written.
+    bool dump(const QString& fileName, quint64 duration);
+
+    FlightRecorder* ref();
+    void deref();
+
+private:
+    ~FlightRecorder();
+
+    QMutex m_mutex;
+    UMEvent* m_events;
+    quint64 m_count;  // Number of events recorded since the last reset.
+    int m_capacity;
+    QAtomicInteger<quint32> m_refCount;
+};
+
+#endif  // FLIGHTRECORDER_P_H
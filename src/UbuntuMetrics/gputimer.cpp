@@ -21,11 +21,23 @@
 
 #include "ubuntumetricsglobal_p.h"
 
-#if !defined(QT_OPENGL_ES) && !defined(GL_TIME_ELAPSED)
+#if !defined(GL_TIME_ELAPSED)
 #define GL_TIME_ELAPSED 0x88BF  // For GL_EXT_timer_query.
 #endif
+#if !defined(GL_TIMESTAMP)
+#define GL_TIMESTAMP 0x8E28  // GL_TIMESTAMP_EXT for GL_EXT_disjoint_timer_query.
+#endif
+#if !defined(GL_QUERY_RESULT)
+#define GL_QUERY_RESULT 0x8866
+#endif
+#if !defined(GL_QUERY_RESULT_AVAILABLE)
+#define GL_QUERY_RESULT_AVAILABLE 0x8867
+#endif
+#if !defined(GL_GPU_DISJOINT_EXT)
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
 
-void GPUTimer::initialize()
+void GPUTimer::initialize(bool forceFinish)
 {
     DASSERT(QOpenGLContext::currentContext());
     DASSERT(m_type == Unset);
@@ -33,6 +45,16 @@ void GPUTimer::initialize()
 #if !defined QT_NO_DEBUG
     m_context = QOpenGLContext::currentContext();
 #endif
+    m_first = 0;
+    m_count = 0;
+
+    if (forceFinish) {
+        m_type = Finish;
+        DLOG("GPUTimer is based on glFinish (forced)");
+        return;
+    }
+
+    QOpenGLContext* context = QOpenGLContext::currentContext();
 
 #if defined(QT_OPENGL_ES)
     QList<QByteArray> eglExtensions = QByteArray(
@@ -41,8 +63,27 @@ void GPUTimer::initialize()
     QList<QByteArray> glExtensions = QByteArray(
         reinterpret_cast<const char*>(glGetString(GL_EXTENSIONS))).split(' ');
 
+    // EXTDisjointTimerQuery.
+    if (glExtensions.contains("GL_EXT_disjoint_timer_query")) {
+        m_timerQuery.genQueries = reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLsizei, GLuint*)>(
+            context->getProcAddress("glGenQueriesEXT"));
+        m_timerQuery.deleteQueries =
+            reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLsizei, const GLuint*)>(
+                context->getProcAddress("glDeleteQueriesEXT"));
+        m_timerQuery.getQueryObjectuiv =
+            reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLuint, GLenum, GLuint*)>(
+                context->getProcAddress("glGetQueryObjectuivEXT"));
+        m_timerQuery.getQueryObjectui64v =
+            reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLuint, GLenum, quint64*)>(
+                context->getProcAddress("glGetQueryObjectui64vEXT"));
+        m_timerQuery.queryCounter = reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLuint, GLenum)>(
+            context->getProcAddress("glQueryCounterEXT"));
+        m_timerQuery.genQueries(2 * maxPendingQueries, m_timer);
+        m_type = EXTDisjointTimerQuery;
+        DLOG("GPUTimer is based on GL_EXT_disjoint_timer_query");
+
     // KHRFence.
-    if (eglExtensions.contains("EGL_KHR_fence_sync")
+    } else if (eglExtensions.contains("EGL_KHR_fence_sync")
         && (glExtensions.contains("GL_OES_EGL_sync")
             || glExtensions.contains("GL_OES_egl_sync") /*PowerVR fix*/)) {
         m_fenceSyncKHR.createSyncKHR = reinterpret_cast<
@@ -54,6 +95,7 @@ void GPUTimer::initialize()
         m_fenceSyncKHR.clientWaitSyncKHR = reinterpret_cast<
             EGLint (QOPENGLF_APIENTRYP)(EGLDisplay, EGLSyncKHR, EGLint, EGLTimeKHR)>(
                 eglGetProcAddress("eglClientWaitSyncKHR"));
+        m_beforeSync = EGL_NO_SYNC_KHR;
         m_type = KHRFence;
         DLOG("GPUTimer is based on GL_OES_EGL_sync");
 
@@ -78,7 +120,6 @@ void GPUTimer::initialize()
     // inspect OpenGL version and extensions, which is basically as annoying as
     // doing the whole thing here.
     // TODO(loicm) Add an hasQuerycounter() method to QOpenGLTimerQuery.
-    QOpenGLContext* context = QOpenGLContext::currentContext();
     QSurfaceFormat format = context->format();
 
     // ARBTimerQuery.
@@ -89,12 +130,15 @@ void GPUTimer::initialize()
         m_timerQuery.deleteQueries =
             reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLsizei, const GLuint*)>(
                 context->getProcAddress("glDeleteQueries"));
+        m_timerQuery.getQueryObjectuiv =
+            reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLuint, GLenum, GLuint*)>(
+                context->getProcAddress("glGetQueryObjectuiv"));
         m_timerQuery.getQueryObjectui64v =
-            reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLuint, GLenum, GLuint64*)>(
+            reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLuint, GLenum, quint64*)>(
                 context->getProcAddress("glGetQueryObjectui64v"));
         m_timerQuery.queryCounter = reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLuint, GLenum)>(
             context->getProcAddress("glQueryCounter"));
-        m_timerQuery.genQueries(2, m_timer);
+        m_timerQuery.genQueries(2 * maxPendingQueries, m_timer);
         m_type = ARBTimerQuery;
         DLOG("GPUTimer is based on GL_ARB_timer_query");
 
@@ -109,15 +153,20 @@ void GPUTimer::initialize()
             context->getProcAddress("glBeginQuery"));
         m_timerQuery.endQuery = reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLenum)>(
             context->getProcAddress("glEndQuery"));
-        m_timerQuery.getQueryObjectui64vExt =
-            reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLuint, GLenum, GLuint64EXT*)>(
+        m_timerQuery.getQueryObjectuiv =
+            reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLuint, GLenum, GLuint*)>(
+                context->getProcAddress("glGetQueryObjectuiv"));
+        m_timerQuery.getQueryObjectui64v =
+            reinterpret_cast<void (QOPENGLF_APIENTRYP)(GLuint, GLenum, quint64*)>(
                 context->getProcAddress("glGetQueryObjectui64vEXT"));
-        m_timerQuery.genQueries(1, m_timer);
+        m_timerQuery.genQueries(maxPendingQueries, m_timer);
         m_type = EXTTimerQuery;
         DLOG("GPUTimer is based on GL_EXT_timer_query");
     }
 #endif
 
+    // glFinish() stalls the CPU until the GPU is done with all the commands,
+    // it's the fallback for contexts without timer queries or fences.
     else {
         m_type = Finish;
         DLOG("GPUTimer is based on glFinish");
@@ -128,83 +177,117 @@ void GPUTimer::finalize()
 {
     DASSERT(m_context == QOpenGLContext::currentContext());
     DASSERT(m_type != Unset);
+    DASSERT(!m_started);
 
 #if !defined QT_NO_DEBUG
     m_context = nullptr;
 #endif
 
+    switch (m_type) {
 #if defined(QT_OPENGL_ES)
-    // KHRFence.
-    if (m_type == KHRFence) {
+    case EXTDisjointTimerQuery:
+        m_timerQuery.deleteQueries(2 * maxPendingQueries, m_timer);
+        break;
+    case KHRFence:
         if (m_beforeSync != EGL_NO_SYNC_KHR) {
             m_fenceSyncKHR.destroySyncKHR(eglGetCurrentDisplay(), m_beforeSync);
         }
-        m_type = Unset;
-
-    // NVFence.
-    } else if (m_type == NVFence) {
+        break;
+    case NVFence:
         m_fenceNV.deleteFencesNV(2, m_fence);
-        m_type = Unset;
-    }
+        break;
 #else
-    // ARBTimerQuery.
-    if (m_type == ARBTimerQuery) {
-        m_timerQuery.deleteQueries(2, m_timer);
-        m_type = Unset;
-
-    // EXTTimerQuery.
-    } else if (m_type == EXTTimerQuery) {
-        m_timerQuery.deleteQueries(1, m_timer);
-        m_type = Unset;
+    case ARBTimerQuery:
+        m_timerQuery.deleteQueries(2 * maxPendingQueries, m_timer);
+        break;
+    case EXTTimerQuery:
+        m_timerQuery.deleteQueries(maxPendingQueries, m_timer);
+        break;
+#endif
+    default:
+        break;
     }
+
+    m_type = Unset;
+    m_count = 0;
+}
+
+bool GPUTimer::isPipelined() const
+{
+#if defined(QT_OPENGL_ES)
+    return m_type == EXTDisjointTimerQuery;
+#else
+    return m_type == ARBTimerQuery || m_type == EXTTimerQuery;
 #endif
 }
 
-void GPUTimer::start()
+bool GPUTimer::start()
 {
     DASSERT(m_context == QOpenGLContext::currentContext());
     DASSERT(m_type != Unset);
     DASSERT(!m_started);
 
+    // Not waiting for the oldest measure to complete when all the queries are
+    // in flight, the GPU is several frames late anyway.
+    if (m_count == maxPendingQueries) {
+        return false;
+    }
+
 #if !defined QT_NO_DEBUG
     m_started = true;
 #endif
 
+    const int index = (m_first + m_count) % maxPendingQueries;
+    switch (m_type) {
 #if defined(QT_OPENGL_ES)
-    // KHRFence.
-    if (m_type == KHRFence) {
+    case EXTDisjointTimerQuery:
+        m_timerQuery.queryCounter(m_timer[index * 2], GL_TIMESTAMP);
+        break;
+    case KHRFence:
         m_beforeSync = m_fenceSyncKHR.createSyncKHR(
             eglGetCurrentDisplay(), EGL_SYNC_FENCE_KHR, NULL);
-
-    // NVFence.
-    } else if (m_type == NVFence) {
+        break;
+    case NVFence:
         m_fenceNV.setFenceNV(m_fence[0], GL_ALL_COMPLETED_NV);
-    }
+        break;
 #else
-    // ARBTimerQuery.
-    if (m_type == ARBTimerQuery) {
-        m_timerQuery.queryCounter(m_timer[0], GL_TIMESTAMP);
-
-    // EXTTimerQuery.
-    } else if (m_type == EXTTimerQuery) {
-        m_timerQuery.beginQuery(GL_TIME_ELAPSED, m_timer[0]);
-    }
+    case ARBTimerQuery:
+        m_timerQuery.queryCounter(m_timer[index * 2], GL_TIMESTAMP);
+        break;
+    case EXTTimerQuery:
+        m_timerQuery.beginQuery(GL_TIME_ELAPSED, m_timer[index]);
+        break;
 #endif
+    default:
+        break;
+    }
+
+    return true;
 }
 
-quint64 GPUTimer::stop()
+void GPUTimer::stop(quint32 tag)
 {
     DASSERT(m_context == QOpenGLContext::currentContext());
     DASSERT(m_type != Unset);
     DASSERT(m_started);
+    DASSERT(m_count < maxPendingQueries);
 
 #if !defined QT_NO_DEBUG
     m_started = false;
 #endif
 
+    const int index = (m_first + m_count) % maxPendingQueries;
+    m_tags[index] = tag;
+    m_times[index] = 0;
+    m_count++;
+
+    switch (m_type) {
 #if defined(QT_OPENGL_ES)
-    // KHRFence.
-    if (m_type == KHRFence) {
+    case EXTDisjointTimerQuery:
+        m_timerQuery.queryCounter(m_timer[index * 2 + 1], GL_TIMESTAMP);
+        break;
+
+    case KHRFence: {
         QElapsedTimer timer;
         EGLDisplay dpy = eglGetCurrentDisplay();
         EGLSyncKHR afterSync = m_fenceSyncKHR.createSyncKHR(dpy, EGL_SYNC_FENCE_KHR, NULL);
@@ -220,51 +303,107 @@ quint64 GPUTimer::stop()
         m_beforeSync = EGL_NO_SYNC_KHR;
         if (beforeSyncValue == EGL_CONDITION_SATISFIED_KHR
             && afterSyncValue == EGL_CONDITION_SATISFIED_KHR) {
-            return afterTime - beforeTime;
-        } else {
-            return 0;
+            m_times[index] = afterTime - beforeTime;
         }
+        break;
+    }
 
-    // NVFence.
-    } else if (m_type == NVFence) {
+    case NVFence: {
         QElapsedTimer timer;
         m_fenceNV.setFenceNV(m_fence[1], GL_ALL_COMPLETED_NV);
         m_fenceNV.finishFenceNV(m_fence[0]);
         quint64 beforeTime = timer.nsecsElapsed();
         m_fenceNV.finishFenceNV(m_fence[1]);
         quint64 afterTime = timer.nsecsElapsed();
-        return afterTime - beforeTime;
+        m_times[index] = afterTime - beforeTime;
+        break;
     }
 #else
-    // ARBTimerQuery.
-    if (m_type == ARBTimerQuery) {
-        GLuint64 time[2] = { 0, 0 };
-        m_timerQuery.queryCounter(m_timer[1], GL_TIMESTAMP);
-        m_timerQuery.getQueryObjectui64v(m_timer[0], GL_QUERY_RESULT, &time[0]);
-        m_timerQuery.getQueryObjectui64v(m_timer[1], GL_QUERY_RESULT, &time[1]);
-        if (time[0] != 0 && time[1] != 0) {
-            return time[1] - time[0];
-        } else {
-            return -1;
-        }
+    case ARBTimerQuery:
+        m_timerQuery.queryCounter(m_timer[index * 2 + 1], GL_TIMESTAMP);
+        break;
 
-    // EXTTimerQuery.
-    } else if (m_type == EXTTimerQuery) {
-        GLuint64EXT time;
+    case EXTTimerQuery:
         m_timerQuery.endQuery(GL_TIME_ELAPSED);
-        m_timerQuery.getQueryObjectui64vExt(m_timer[0], GL_QUERY_RESULT, &time);
-        return time;
-    }
+        break;
 #endif
-    // Finish.
-    else {
+
+    case Finish: {
         QOpenGLFunctions* functions = QOpenGLContext::currentContext()->functions();
         QElapsedTimer timer;
         timer.start();
         functions->glFinish();
-        return static_cast<quint64>(timer.nsecsElapsed());
+        m_times[index] = static_cast<quint64>(timer.nsecsElapsed());
+        break;
+    }
+
+    default:
+        DNOT_REACHED();
+        break;
+    }
+}
+
+bool GPUTimer::isResultAvailable(int index)
+{
+    if (!isPipelined()) {
+        return true;
+    }
+
+    // The second time stamp query is written after the first one.
+#if defined(QT_OPENGL_ES)
+    const GLuint query = m_timer[index * 2 + 1];
+#else
+    const GLuint query = m_type == EXTTimerQuery ? m_timer[index] : m_timer[index * 2 + 1];
+#endif
+    GLuint available = GL_FALSE;
+    m_timerQuery.getQueryObjectuiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+    return available != GL_FALSE;
+}
+
+quint64 GPUTimer::queryResult(int index)
+{
+#if !defined(QT_OPENGL_ES)
+    if (m_type == EXTTimerQuery) {
+        quint64 time = 0;
+        m_timerQuery.getQueryObjectui64v(m_timer[index], GL_QUERY_RESULT, &time);
+        return time;
+    }
+#endif
+
+    quint64 time[2] = { 0, 0 };
+    m_timerQuery.getQueryObjectui64v(m_timer[index * 2], GL_QUERY_RESULT, &time[0]);
+    m_timerQuery.getQueryObjectui64v(m_timer[index * 2 + 1], GL_QUERY_RESULT, &time[1]);
+    return (time[0] != 0 && time[1] >= time[0]) ? time[1] - time[0] : 0;
+}
+
+bool GPUTimer::result(quint32* tag, quint64* time)
+{
+    DASSERT(m_context == QOpenGLContext::currentContext());
+    DASSERT(tag);
+    DASSERT(time);
+
+    if (m_count == 0 || !isResultAvailable(m_first)) {
+        return false;
+    }
+
+    *tag = m_tags[m_first];
+    if (isPipelined()) {
+        *time = queryResult(m_first);
+#if defined(QT_OPENGL_ES)
+        // Results are undefined if the GPU has been reset or its frequency
+        // changed in the meantime.
+        GLint disjoint = 0;
+        QOpenGLContext::currentContext()->functions()->glGetIntegerv(
+            GL_GPU_DISJOINT_EXT, &disjoint);
+        if (disjoint) {
+            *time = 0;
+        }
+#endif
+    } else {
+        *time = m_times[m_first];
     }
+    m_first = (m_first + 1) % maxPendingQueries;
+    m_count--;
 
-    DNOT_REACHED();
-    return 0;
+    return true;
 }
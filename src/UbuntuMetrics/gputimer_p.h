@@ -33,35 +33,61 @@
 // in the command buffer from the CPU, this timer pushes dedicated
 // synchronization commands to the command buffer, which the GPU signals
 // whenever completed. That allows to get accurate GPU timings.
+//
+// Timer queries are pipelined, up to maxPendingQueries of them can be in flight
+// and their results are collected a few frames later with result(), so that
+// measuring doesn't stall the CPU waiting for the GPU. Fence based timers
+// (OpenGL ES without GL_EXT_disjoint_timer_query) can't be pipelined since
+// they only provide the time at which the CPU sees the completion, their
+// result is available right after stop(). The glFinish() based timer, used as a
+// fallback when neither timer queries nor fences are supported, serializes the
+// whole pipeline.
 class UBUNTU_METRICS_PRIVATE_EXPORT GPUTimer
 {
 public:
+    static const int maxPendingQueries = 4;
+
     GPUTimer() :
 #if !defined QT_NO_DEBUG
         m_context(nullptr), m_started(false),
 #endif
-        m_type(Unset) {}
+        m_type(Unset), m_first(0), m_count(0) {}
 
     // Allocates/Deletes the OpenGL resources. finalize() is not called at
     // destruction, it must be explicitly called to free the resources at the
     // right time in a thread with the same OpenGL context bound than at
-    // initialize().
-    void initialize();
+    // initialize(). Pending queries are discarded at finalization. forceFinish
+    // selects the glFinish() based timer even if timer queries or fences are
+    // supported, mostly useful for testing.
+    void initialize(bool forceFinish = false);
     void finalize();
 
-    // Starts/Stops the timer. stop() returns the time elapsed in nanoseconds
-    // since the call to start(). Calling start()/stop() two times in a row
-    // triggers an assertion in debug builds and leads to undefined results in
-    // non-debug builds. Must be called in a thread with the same OpenGL context
-    // bound than at initialize().
-    void start();
-    quint64 stop();
+    // Get whether the timer has been initialized, start() always fails otherwise.
+    bool isAvailable() const { return m_type != Unset; }
+
+    // Starts/Stops the timer. start() returns false, in which case stop()
+    // must not be called, if the timer isn't available or if there's already
+    // maxPendingQueries results not collected. stop() associates the given
+    // tag to the measure, it's returned along with the result. Calling
+    // start()/stop() two times in a row triggers an assertion in debug builds
+    // and leads to undefined results in non-debug builds. Must be called in a
+    // thread with the same OpenGL context bound than at initialize().
+    bool start();
+    void stop(quint32 tag);
+
+    // Retrieves the result of the oldest pending measure without waiting for
+    // the GPU, in the order they've been stopped. Returns false if there's no
+    // pending measure or if the oldest one isn't complete yet. time is set to
+    // the time in nanoseconds elapsed between start() and stop() on the GPU, or
+    // to 0 if the measure is invalid (GPU disjoint operation for instance).
+    bool result(quint32* tag, quint64* time);
 
 private:
     enum Type {
         Unset,
         Finish,
 #if defined(QT_OPENGL_ES)
+        EXTDisjointTimerQuery,
         KHRFence,
         NVFence,
 #else
@@ -70,12 +96,35 @@ private:
 #endif
     };
 
+    bool isPipelined() const;
+    bool isResultAvailable(int index);
+    quint64 queryResult(int index);
+
 #if !defined QT_NO_DEBUG
     QOpenGLContext* m_context;
     bool m_started;
 #endif
     Type m_type;
 
+    // Ring of pending measures, m_first is the index of the oldest one.
+    quint32 m_tags[maxPendingQueries];
+    quint64 m_times[maxPendingQueries];  // Results of the non-pipelined timers.
+    quint8 m_first;
+    quint8 m_count;
+
+    // Two timer queries (start and stop time stamps) per pending measure, or a
+    // single one with GL_EXT_timer_query.
+    struct {
+        void (QOPENGLF_APIENTRYP genQueries)(GLsizei n, GLuint* ids);
+        void (QOPENGLF_APIENTRYP deleteQueries)(GLsizei n, const GLuint* ids);
+        void (QOPENGLF_APIENTRYP beginQuery)(GLenum target, GLuint id);
+        void (QOPENGLF_APIENTRYP endQuery)(GLenum target);
+        void (QOPENGLF_APIENTRYP getQueryObjectuiv)(GLuint id, GLenum pname, GLuint* params);
+        void (QOPENGLF_APIENTRYP getQueryObjectui64v)(GLuint id, GLenum pname, quint64* params);
+        void (QOPENGLF_APIENTRYP queryCounter)(GLuint id, GLenum target);
+    } m_timerQuery;
+    GLuint m_timer[2 * maxPendingQueries];
+
 #if defined(QT_OPENGL_ES)
     struct {
         void (QOPENGLF_APIENTRYP genFencesNV)(GLsizei n, GLuint* fences);
@@ -93,19 +142,6 @@ private:
                                                       EGLTimeKHR timeout);
     } m_fenceSyncKHR;
     EGLSyncKHR m_beforeSync;
-
-#else
-    struct {
-        void (QOPENGLF_APIENTRYP genQueries)(GLsizei n, GLuint* ids);
-        void (QOPENGLF_APIENTRYP deleteQueries)(GLsizei n, const GLuint* ids);
-        void (QOPENGLF_APIENTRYP beginQuery)(GLenum target, GLuint id);
-        void (QOPENGLF_APIENTRYP endQuery)(GLenum target);
-        void (QOPENGLF_APIENTRYP getQueryObjectui64v)(GLuint id, GLenum pname, GLuint64* params);
-        void (QOPENGLF_APIENTRYP getQueryObjectui64vExt)(GLuint id, GLenum pname,
-                                                         GLuint64EXT* params);
-        void (QOPENGLF_APIENTRYP queryCounter)(GLuint id, GLenum target);
-    } m_timerQuery;
-    GLuint m_timer[2];
 #endif
 };
 
@@ -0,0 +1,101 @@
+// Copyright © 2016 Canonical Ltd.
+// Author: Loïc Molinari <loic.molinari@canonical.com>
+//
+// This file is part of Ubuntu UI Toolkit.
+//
+// Ubuntu UI Toolkit is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation; version 3.
+//
+// Ubuntu UI Toolkit is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Ubuntu UI Toolkit. If not, see <http://www.gnu.org/licenses/>.
+
+#include "histogram_p.h"
+
+#include <string.h>
+#include <math.h>
+
+// Slots are laid out as follows, with s = subBucketCount, h = s / 2 and k the
+// bucket index: slots [0, s) store values [0, s) exactly, then each bucket
+// k >= 1 stores values [h * 2^k, s * 2^k) in h slots of width 2^k.
+
+static int mostSignificantBit(quint64 value)
+{
+    DASSERT(value != 0);
+#if defined(__GNUC__)
+    return 63 - __builtin_clzll(value);
+#else
+    int bit = 0;
+    while (value >>= 1) {
+        bit++;
+    }
+    return bit;
+#endif
+}
+
+// static.
+int Histogram::slotIndex(quint64 value)
+{
+    if (value < static_cast<quint64>(subBucketCount)) {
+        return static_cast<int>(value);
+    } else if (value < maxValue) {
+        const int bucket = mostSignificantBit(value) - (subBucketBits - 1);
+        return subBucketCount + (bucket - 1) * (subBucketCount / 2)
+            + static_cast<int>((value >> bucket) - (subBucketCount / 2));
+    } else {
+        return slotCount - 1;
+    }
+}
+
+// static.
+quint64 Histogram::slotHighestValue(int index)
+{
+    DASSERT(index >= 0 && index < slotCount);
+
+    if (index < subBucketCount) {
+        return index;
+    } else {
+        const int bucket = (index - subBucketCount) / (subBucketCount / 2) + 1;
+        const quint64 subBucket =
+            (index - subBucketCount) % (subBucketCount / 2) + (subBucketCount / 2);
+        return ((subBucket + 1) << bucket) - 1;
+    }
+}
+
+void Histogram::record(quint64 value)
+{
+    m_counts[slotIndex(value)]++;
+    m_count++;
+    m_max = qMax(m_max, value);
+}
+
+quint64 Histogram::percentile(float percentile) const
+{
+    if (m_count == 0) {
+        return 0;
+    }
+
+    const quint32 rank = qMax(static_cast<quint32>(ceilf(
+        qBound(0.0f, percentile, 100.0f) * 0.01f * m_count)), 1u);
+    quint32 count = 0;
+    for (int i = 0; i < slotCount; ++i) {
+        count += m_counts[i];
+        if (count >= rank) {
+            return qMin(slotHighestValue(i), m_max);
+        }
+    }
+    DNOT_REACHED();
+    return m_max;
+}
+
+void Histogram::reset()
+{
+    memset(m_counts, 0, sizeof(m_counts));
+    m_count = 0;
+    m_max = 0;
+}
@@ -0,0 +1,62 @@
+// Copyright © 2016 Canonical Ltd.
+// Author: Loïc Molinari <loic.molinari@canonical.com>
+//
+// This file is part of Ubuntu UI Toolkit.
+//
+// Ubuntu UI Toolkit is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation; version 3.
+//
+// Ubuntu UI Toolkit is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Ubuntu UI Toolkit. If not, see <http://www.gnu.org/licenses/>.
+
+#ifndef HISTOGRAM_P_H
+#define HISTOGRAM_P_H
+
+#include <UbuntuMetrics/private/ubuntumetricsglobal_p.h>
+
+// Histogram records values in a fixed amount of memory using log-linear
+// buckets (like HdrHistogram). Values lower than subBucketCount are recorded
+// exactly, higher values are recorded with a relative precision of
+// 1 / (subBucketCount / 2), about 6%. Values equal or higher than maxValue are
+// clamped, the maximum value recorded is tracked exactly though.
+class UBUNTU_METRICS_PRIVATE_EXPORT Histogram
+{
+public:
+    static const int subBucketBits = 5;
+    static const int subBucketCount = 1 << subBucketBits;
+    static const int bucketCount = 22;
+    static const int slotCount = subBucketCount + (bucketCount - 1) * (subBucketCount / 2);
+    static const quint64 maxValue = Q_UINT64_C(1) << (subBucketBits + bucketCount - 1);
+
+    Histogram() { reset(); }
+
+    // Records a value.
+    void record(quint64 value);
+
+    // Gets the value at the given percentile (in the range [0, 100]). Returns
+    // the highest value equivalent to the slot containing it, capped to the
+    // maximum value recorded. Returns 0 if no values have been recorded.
+    quint64 percentile(float percentile) const;
+
+    quint32 count() const { return m_count; }
+    quint64 max() const { return m_max; }
+
+    // Removes all the recorded values.
+    void reset();
+
+private:
+    static int slotIndex(quint64 value);
+    static quint64 slotHighestValue(int index);
+
+    quint32 m_counts[slotCount];
+    quint32 m_count;
+    quint64 m_max;
+};
+
+#endif  // HISTOGRAM_P_H
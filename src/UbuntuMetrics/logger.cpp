@@ -18,11 +18,20 @@
 #include "logger_p.h"
 
 #include <dlfcn.h>
+#include <errno.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
 
+#include <QtCore/QCoreApplication>
 #include <QtCore/QDir>
+#include <QtCore/QStandardPaths>
 #include <QtCore/QTime>
 
 #include "events.h"
+#include "binarylog_p.h"
 #include "ubuntumetricsglobal_p.h"
 #if defined(Q_OS_LINUX)
 #define TRACEPOINT_DEFINE
@@ -30,6 +39,15 @@
 #include "lttng/lttng_p.h"
 #endif  // defined(Q_OS_LINUX)
 
+void UMLogger::log(const UMEvent* events, int count)
+{
+    DASSERT(events);
+
+    for (int i = 0; i < count; ++i) {
+        log(events[i]);
+    }
+}
+
 UMFileLogger::UMFileLogger(const QString& fileName, bool parsable)
     : d_ptr(new UMFileLoggerPrivate(fileName, parsable))
 {
@@ -102,10 +120,30 @@ bool UMFileLogger::isOpen()
 
 void UMFileLogger::log(const UMEvent& event)
 {
-    d_func()->log(event);
+    Q_D(UMFileLogger);
+
+    if (d->m_flags & UMFileLoggerPrivate::Open) {
+        d->write(event);
+        d->m_textStream.flush();
+    }
+}
+
+void UMFileLogger::log(const UMEvent* events, int count)
+{
+    DASSERT(events);
+    Q_D(UMFileLogger);
+
+    // Flushing once per batch allows to write all the events with a single
+    // syscall.
+    if (d->m_flags & UMFileLoggerPrivate::Open) {
+        for (int i = 0; i < count; ++i) {
+            d->write(events[i]);
+        }
+        d->m_textStream.flush();
+    }
 }
 
-void UMFileLoggerPrivate::log(const UMEvent& event)
+void UMFileLoggerPrivate::write(const UMEvent& event)
 {
     if (m_flags & Open) {
         // ANSI/VT100 terminal codes.
@@ -127,7 +165,18 @@ void UMFileLoggerPrivate::log(const UMEvent& event)
                     << event.process.cpuUsage << ' '
                     << event.process.vszMemory << ' '
                     << event.process.rssMemory << ' '
-                    << event.process.threadCount << '\n' << flush;
+                    << event.process.threadCount << ' '
+                    << event.process.threadCpuUsage[UMProcessEvent::GuiThread] << ' '
+                    << event.process.threadCpuUsage[UMProcessEvent::RenderThread] << ' '
+                    << event.process.threadCpuUsage[UMProcessEvent::LoggingThread] << ' '
+                    << event.process.pssMemory << ' '
+                    << event.process.ussMemory << ' '
+                    << event.process.minorFaultCount << ' '
+                    << event.process.majorFaultCount << ' '
+                    << event.process.voluntaryContextSwitchCount << ' '
+                    << event.process.involuntaryContextSwitchCount << ' '
+                    << event.process.readBytes << ' '
+                    << event.process.writeBytes << '\n';
             } else {
                 m_textStream
                     << (m_flags & Colored ? "\033[33mP\033[00m " : "P ")
@@ -135,8 +184,21 @@ void UMFileLoggerPrivate::log(const UMEvent& event)
                     << "CPU" << dimColon << event.process.cpuUsage << "% "
                     << "VSZ" << dimColon << event.process.vszMemory << "kB "
                     << "RSS" << dimColon << event.process.rssMemory << "kB "
-                    << "Threads" << dimColon << event.process.threadCount
-                    << '\n' << flush;
+                    << "PSS" << dimColon << event.process.pssMemory << "kB "
+                    << "USS" << dimColon << event.process.ussMemory << "kB "
+                    << "Threads" << dimColon << event.process.threadCount << ' '
+                    << "GUI" << dimColon
+                    << event.process.threadCpuUsage[UMProcessEvent::GuiThread] << "% "
+                    << "Render" << dimColon
+                    << event.process.threadCpuUsage[UMProcessEvent::RenderThread] << "% "
+                    << "Logging" << dimColon
+                    << event.process.threadCpuUsage[UMProcessEvent::LoggingThread] << "% "
+                    << "Faults" << dimColon << event.process.minorFaultCount << '/'
+                    << event.process.majorFaultCount << ' '
+                    << "CtxSwitches" << dimColon << event.process.voluntaryContextSwitchCount
+                    << '/' << event.process.involuntaryContextSwitchCount << ' '
+                    << "IO" << dimColon << event.process.readBytes << '/'
+                    << event.process.writeBytes << "B\n";
             }
             break;
         }
@@ -152,7 +214,7 @@ void UMFileLoggerPrivate::log(const UMEvent& event)
                     << event.frame.syncTime << ' '
                     << event.frame.renderTime << ' '
                     << event.frame.gpuTime << ' '
-                    << event.frame.swapTime << '\n' << flush;
+                    << event.frame.swapTime << '\n';
             } else {
                 m_textStream
                     << (m_flags & Colored ? "\033[36mF\033[00m " : "F ")
@@ -163,7 +225,7 @@ void UMFileLoggerPrivate::log(const UMEvent& event)
                     << "Sync" << dimColon << event.frame.syncTime / 1000000.0f << "ms "
                     << "Render" << dimColon << event.frame.renderTime / 1000000.0f << "ms "
                     << "GPU" << dimColon << event.frame.gpuTime / 1000000.0f << "ms "
-                    << "Swap" << dimColon << event.frame.swapTime / 1000000.0f << "ms\n" << flush;
+                    << "Swap" << dimColon << event.frame.swapTime / 1000000.0f << "ms\n";
             }
             break;
 
@@ -175,7 +237,7 @@ void UMFileLoggerPrivate::log(const UMEvent& event)
                     << event.window.id << ' '
                     << event.window.state << ' '
                     << event.window.width << ' '
-                    << event.window.height << '\n' << flush;
+                    << event.window.height << '\n';
             } else {
                 const char* const stateString[] = { "Hidden", "Shown", "Resized" };
                 Q_STATIC_ASSERT(ARRAY_SIZE(stateString) == UMWindowEvent::StateCount);
@@ -185,7 +247,7 @@ void UMFileLoggerPrivate::log(const UMEvent& event)
                     << "Id" << dimColon << event.window.id << ' '
                     << "State" << dimColon << stateString[event.window.state] << ' '
                     << "Size" << dimColon << event.window.width << 'x' << event.window.height
-                    << '\n' << flush;
+                    << '\n';
             }
             break;
         }
@@ -196,14 +258,123 @@ void UMFileLoggerPrivate::log(const UMEvent& event)
                     << "G "
                     << event.timeStamp << ' '
                     << event.generic.id << ' '
-                    << event.generic.string << '\n' << flush;
+                    << event.generic.string << '\n';
             } else {
                 m_textStream
                     << (m_flags & Colored ? "\033[32mG\033[00m " : "G ")
                     << dim << timeString << reset << ' '
                     << "Id" << dimColon << event.generic.id << ' '
                     << "String" << dimColon << '"' << event.generic.string << '"'
-                    << '\n' << flush;
+                    << '\n';
+            }
+            break;
+        }
+
+        case UMEvent::FrameSummary: {
+            const UMFrameSummaryEvent& summary = event.frameSummary;
+            if (m_flags & Parsable) {
+                m_textStream
+                    << "S "
+                    << event.timeStamp << ' '
+                    << summary.window << ' '
+                    << summary.frameCount << ' '
+                    << summary.missedFrameCount;
+                for (int i = 0; i < UMFrameSummaryEvent::MetricCount; ++i) {
+                    for (int j = 0; j < UMFrameSummaryEvent::StatisticCount; ++j) {
+                        m_textStream << ' ' << summary.times[i][j];
+                    }
+                }
+                m_textStream << '\n';
+            } else {
+                const char* const metricString[] = { "Delta", "Sync", "Render", "GPU", "Swap" };
+                Q_STATIC_ASSERT(ARRAY_SIZE(metricString) == UMFrameSummaryEvent::MetricCount);
+                m_textStream
+                    << (m_flags & Colored ? "\033[34mS\033[00m " : "S ")
+                    << dim << timeString << reset << ' '
+                    << "Win" << dimColon << summary.window << ' '
+                    << "Frames" << dimColon << summary.frameCount << ' '
+                    << "Missed" << dimColon << summary.missedFrameCount;
+                // Times are written as p50/p90/p99/max.
+                for (int i = 0; i < UMFrameSummaryEvent::MetricCount; ++i) {
+                    m_textStream
+                        << ' ' << metricString[i] << dimColon
+                        << summary.times[i][UMFrameSummaryEvent::P50] / 1000.0f << '/'
+                        << summary.times[i][UMFrameSummaryEvent::P90] / 1000.0f << '/'
+                        << summary.times[i][UMFrameSummaryEvent::P99] / 1000.0f << '/'
+                        << summary.times[i][UMFrameSummaryEvent::Max] / 1000.0f << "ms";
+                }
+                m_textStream << '\n';
+            }
+            break;
+        }
+
+        case UMEvent::Span: {
+            if (m_flags & Parsable) {
+                m_textStream
+                    << "T "
+                    << event.timeStamp << ' '
+                    << event.span.phase << ' '
+                    << event.span.threadId << ' '
+                    << event.span.depth << ' '
+                    << event.span.id << ' '
+                    << event.span.duration << ' '
+                    << event.span.string << '\n';
+            } else {
+                const char* const phaseString[] = { "Begin", "End" };
+                Q_STATIC_ASSERT(ARRAY_SIZE(phaseString) == UMSpanEvent::PhaseCount);
+                m_textStream
+                    << (m_flags & Colored ? "\033[31mT\033[00m " : "T ")
+                    << dim << timeString << reset << ' '
+                    << "Phase" << dimColon << phaseString[event.span.phase] << ' '
+                    << "Thread" << dimColon << event.span.threadId << ' '
+                    << "Depth" << dimColon << event.span.depth << ' '
+                    << "Id" << dimColon << event.span.id << ' ';
+                if (event.span.phase == UMSpanEvent::End) {
+                    m_textStream
+                        << "Duration" << dimColon << event.span.duration / 1000000.0f << "ms ";
+                }
+                m_textStream
+                    << "String" << dimColon << '"' << event.span.string << '"' << '\n';
+            }
+            break;
+        }
+
+        case UMEvent::LongFrame: {
+            const UMLongFrameEvent& longFrame = event.longFrame;
+            if (m_flags & Parsable) {
+                m_textStream
+                    << "L "
+                    << event.timeStamp << ' '
+                    << longFrame.window << ' '
+                    << longFrame.number << ' '
+                    << longFrame.phase << ' '
+                    << longFrame.budget << ' '
+                    << longFrame.frameTime;
+                for (int i = 0; i < UMLongFrameEvent::PhaseCount; ++i) {
+                    m_textStream << ' ' << longFrame.phaseTimes[i];
+                }
+                m_textStream
+                    << ' ' << longFrame.dirtyItemCount
+                    << ' ' << longFrame.animationCount << '\n';
+            } else {
+                const char* const phaseString[] = { "Gap", "Sync", "Render", "GPU", "Swap" };
+                Q_STATIC_ASSERT(ARRAY_SIZE(phaseString) == UMLongFrameEvent::PhaseCount);
+                m_textStream
+                    << (m_flags & Colored ? "\033[01;31mL\033[00m " : "L ")
+                    << dim << timeString << reset << ' '
+                    << "Win" << dimColon << longFrame.window << ' '
+                    << "N" << dimColon << longFrame.number << ' '
+                    << "Phase" << dimColon << phaseString[longFrame.phase] << ' '
+                    << "Time" << dimColon << longFrame.frameTime / 1000000.0f << '/'
+                    << longFrame.budget / 1000000.0f << "ms";
+                for (int i = 0; i < UMLongFrameEvent::PhaseCount; ++i) {
+                    m_textStream
+                        << ' ' << phaseString[i] << dimColon
+                        << longFrame.phaseTimes[i] / 1000000.0f << "ms";
+                }
+                m_textStream
+                    << ' ' << "Items" << dimColon << longFrame.dirtyItemCount
+                    << ' ' << "Animations" << dimColon << longFrame.animationCount << '\n';
             }
             break;
         }
@@ -231,6 +402,562 @@ bool UMFileLogger::parsable()
     return !!(d_func()->m_flags & UMFileLoggerPrivate::Parsable);
 }
 
+UMBinaryLogger::UMBinaryLogger(const QString& fileName, quint32 preallocatedEventCount)
+    : d_ptr(new UMBinaryLoggerPrivate(fileName, preallocatedEventCount))
+{
+}
+
+UMBinaryLoggerPrivate::UMBinaryLoggerPrivate(
+    const QString& fileName, quint32 preallocatedEventCount)
+    : m_header(nullptr)
+    , m_events(nullptr)
+    , m_capacity(0)
+    , m_preallocatedEventCount(qMax(preallocatedEventCount, 1u))
+    , m_flags(0)
+{
+    if (QDir::isRelativePath(fileName)) {
+        m_file.setFileName(QString(QDir::currentPath() + QDir::separator() + fileName));
+    } else {
+        m_file.setFileName(fileName);
+    }
+
+    if (m_file.open(QIODevice::ReadWrite | QIODevice::Truncate)) {
+        if (map(m_preallocatedEventCount)) {
+            memcpy(m_header->magic, binaryLogMagic, sizeof(binaryLogMagic));
+            m_header->version = UMBinaryLogHeader::currentVersion;
+            m_header->headerSize = sizeof(UMBinaryLogHeader);
+            m_header->eventSize = sizeof(UMEvent);
+            m_header->eventCount = 0;
+            m_flags = Open;
+        } else {
+            m_file.close();
+        }
+    } else {
+        WARN("BinaryLogger: Can't open file %s '%s'.", fileName.toLatin1().constData(),
+             m_file.errorString().toLatin1().constData());
+    }
+}
+
+UMBinaryLogger::~UMBinaryLogger()
+{
+    delete d_ptr;
+}
+
+UMBinaryLoggerPrivate::~UMBinaryLoggerPrivate()
+{
+    if (m_flags & Open) {
+        // Get rid of the preallocated space not filled with events.
+        const quint64 size = sizeof(UMBinaryLogHeader) + m_header->eventCount * sizeof(UMEvent);
+        m_file.unmap(reinterpret_cast<uchar*>(m_header));
+        m_file.resize(size);
+        m_file.close();
+    }
+}
+
+// Resizes the file and maps it so that it can store capacity events.
+bool UMBinaryLoggerPrivate::map(quint64 capacity)
+{
+    if (m_header) {
+        m_file.unmap(reinterpret_cast<uchar*>(m_header));
+        m_header = nullptr;
+        m_events = nullptr;
+    }
+
+    const qint64 size = sizeof(UMBinaryLogHeader) + capacity * sizeof(UMEvent);
+    uchar* data;
+    if (!m_file.resize(size) || !(data = m_file.map(0, size))) {
+        WARN("BinaryLogger: Can't map file '%s'.", m_file.errorString().toLatin1().constData());
+        return false;
+    }
+    m_header = reinterpret_cast<UMBinaryLogHeader*>(data);
+    m_events = reinterpret_cast<UMEvent*>(&data[sizeof(UMBinaryLogHeader)]);
+    m_capacity = capacity;
+    return true;
+}
+
+void UMBinaryLogger::log(const UMEvent& event)
+{
+    d_func()->log(&event, 1);
+}
+
+void UMBinaryLogger::log(const UMEvent* events, int count)
+{
+    DASSERT(events);
+    d_func()->log(events, count);
+}
+
+void UMBinaryLoggerPrivate::log(const UMEvent* events, int count)
+{
+    if (m_flags & Open) {
+        const quint64 eventCount = m_header->eventCount;
+        if (Q_UNLIKELY(eventCount + count > m_capacity)) {
+            const quint64 growth = qMax<quint64>(m_preallocatedEventCount, count);
+            if (!map(m_capacity + growth)) {
+                // The file is left as is with all the events logged so far.
+                m_flags &= ~Open;
+                m_file.close();
+                return;
+            }
+        }
+        memcpy(&m_events[eventCount], events, count * sizeof(UMEvent));
+        m_header->eventCount = eventCount + count;
+    }
+}
+
+bool UMBinaryLogger::isOpen()
+{
+    return !!(d_func()->m_flags & UMBinaryLoggerPrivate::Open);
+}
+
+UMTraceEventLogger::UMTraceEventLogger(const QString& fileName)
+    : d_ptr(new UMTraceEventLoggerPrivate(fileName))
+{
+}
+
+UMTraceEventLoggerPrivate::UMTraceEventLoggerPrivate(const QString& fileName)
+    : m_pid(QCoreApplication::applicationPid())
+    , m_bufferUsed(0)
+    , m_flags(0)
+{
+    if (QDir::isRelativePath(fileName)) {
+        m_file.setFileName(QString(QDir::currentPath() + QDir::separator() + fileName));
+    } else {
+        m_file.setFileName(fileName);
+    }
+
+    if (m_file.open(QIODevice::WriteOnly | QIODevice::Truncate | QIODevice::Unbuffered)) {
+        initialize();
+    } else {
+        WARN("TraceEventLogger: Can't open file %s '%s'.", fileName.toLatin1().constData(),
+             m_file.errorString().toLatin1().constData());
+    }
+}
+
+UMTraceEventLogger::UMTraceEventLogger(FILE* fileHandle)
+    : d_ptr(new UMTraceEventLoggerPrivate(fileHandle))
+{
+}
+
+UMTraceEventLoggerPrivate::UMTraceEventLoggerPrivate(FILE* fileHandle)
+    : m_pid(QCoreApplication::applicationPid())
+    , m_bufferUsed(0)
+    , m_flags(0)
+{
+    if (m_file.open(fileHandle, QIODevice::WriteOnly | QIODevice::Unbuffered)) {
+        initialize();
+    } else {
+        WARN("TraceEventLogger: Can't open file handle '%s'.",
+             m_file.errorString().toLatin1().constData());
+    }
+}
+
+UMTraceEventLogger::~UMTraceEventLogger()
+{
+    delete d_ptr;
+}
+
+UMTraceEventLoggerPrivate::~UMTraceEventLoggerPrivate()
+{
+    if (m_flags & Open) {
+        DASSERT(m_bufferUsed + 3 <= bufferSize);
+        memcpy(&m_buffer[m_bufferUsed], "\n]\n", 3);
+        m_bufferUsed += 3;
+        flush();
+    }
+}
+
+void UMTraceEventLoggerPrivate::initialize()
+{
+    m_flags = Open | FirstRecord;
+    m_buffer[0] = '[';
+    m_bufferUsed = 1;
+    const QByteArray name = QCoreApplication::applicationName().toUtf8();
+    if (!name.isEmpty() && name.size() < maxRecordSize / 2 && !name.contains('"')
+        && !name.contains('\\')) {
+        writeRecord("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%lld,"
+                    "\"args\":{\"name\":\"%s\"}}", m_pid, name.constData());
+    }
+    flush();
+}
+
+bool UMTraceEventLogger::isOpen()
+{
+    return !!(d_func()->m_flags & UMTraceEventLoggerPrivate::Open);
+}
+
+void UMTraceEventLogger::log(const UMEvent& event)
+{
+    Q_D(UMTraceEventLogger);
+
+    if (d->m_flags & UMTraceEventLoggerPrivate::Open) {
+        d->write(event);
+        d->flush();
+    }
+}
+
+void UMTraceEventLogger::log(const UMEvent* events, int count)
+{
+    DASSERT(events);
+    Q_D(UMTraceEventLogger);
+
+    if (d->m_flags & UMTraceEventLoggerPrivate::Open) {
+        for (int i = 0; i < count; ++i) {
+            d->write(events[i]);
+        }
+        d->flush();
+    }
+}
+
+void UMTraceEventLogger::setProcessId(qint64 pid)
+{
+    d_func()->m_pid = pid;
+}
+
+qint64 UMTraceEventLogger::processId()
+{
+    return d_func()->m_pid;
+}
+
+void UMTraceEventLoggerPrivate::flush()
+{
+    if (m_bufferUsed > 0) {
+        if (m_file.write(m_buffer, m_bufferUsed) != m_bufferUsed) {
+            WARN("TraceEventLogger: Can't write to file '%s'.",
+                 m_file.errorString().toLatin1().constData());
+            m_flags &= ~Open;
+            m_file.close();
+        }
+        m_bufferUsed = 0;
+    }
+}
+
+// Appends a record to the buffer, records are separated by a comma.
+void UMTraceEventLoggerPrivate::writeRecord(const char* format, ...)
+{
+    if (bufferSize - m_bufferUsed < maxRecordSize) {
+        flush();
+    }
+    if (!(m_flags & FirstRecord)) {
+        m_buffer[m_bufferUsed++] = ',';
+    }
+    m_flags &= ~FirstRecord;
+    m_buffer[m_bufferUsed++] = '\n';
+
+    va_list arguments;
+    va_start(arguments, format);
+    const int size = vsnprintf(&m_buffer[m_bufferUsed], maxRecordSize - 2, format, arguments);
+    va_end(arguments);
+    DASSERT(size >= 0 && size < maxRecordSize - 2);
+    m_bufferUsed += qBound(0, size, maxRecordSize - 3);
+}
+
+// Names the tracks of a window the first time it's seen.
+void UMTraceEventLoggerPrivate::writeWindowTracks(quint32 window)
+{
+    const quint64 key = (static_cast<quint64>(m_pid) << 32) | window;
+    if (!m_windows.contains(key)) {
+        m_windows.insert(key);
+        const quint32 track = windowTrackBase + window * 2;
+        writeRecord("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%lld,\"tid\":%u,"
+                    "\"args\":{\"name\":\"Window %u\"}}", m_pid, track, window);
+        writeRecord("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%lld,\"tid\":%u,"
+                    "\"args\":{\"name\":\"Window %u GPU\"}}", m_pid, track + 1, window);
+    }
+}
+
+// Escapes a string to be written in a JSON string. The escaped string can be 6
+// times bigger than the source in the worst case.
+static void escapeJsonString(char* escaped, const char* string, quint32 maxSize)
+{
+    static const char hexDigits[] = "0123456789abcdef";
+    for (quint32 i = 0; i < maxSize && string[i] != '\0'; ++i) {
+        const uchar c = static_cast<uchar>(string[i]);
+        if (c == '"' || c == '\\') {
+            *escaped++ = '\\';
+            *escaped++ = c;
+        } else if (c < 0x20) {
+            *escaped++ = '\\';
+            *escaped++ = 'u';
+            *escaped++ = '0';
+            *escaped++ = '0';
+            *escaped++ = hexDigits[c >> 4];
+            *escaped++ = hexDigits[c & 0xf];
+        } else {
+            *escaped++ = c;
+        }
+    }
+    *escaped = '\0';
+}
+
+void UMTraceEventLoggerPrivate::write(const UMEvent& event)
+{
+    // Time stamps and durations are expressed in microseconds.
+    const double timeStamp = event.timeStamp / 1000.0;
+
+    switch (event.type) {
+    case UMEvent::Process: {
+        writeRecord("{\"name\":\"CPU usage\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":%lld,"
+                    "\"args\":{\"%%\":%u}}", timeStamp, m_pid, event.process.cpuUsage);
+        writeRecord("{\"name\":\"Memory\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":%lld,"
+                    "\"args\":{\"VSZ (kB)\":%u,\"RSS (kB)\":%u,\"PSS (kB)\":%u,"
+                    "\"USS (kB)\":%u}}", timeStamp, m_pid, event.process.vszMemory,
+                    event.process.rssMemory, event.process.pssMemory, event.process.ussMemory);
+        writeRecord("{\"name\":\"Page faults\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":%lld,"
+                    "\"args\":{\"minor\":%u,\"major\":%u}}", timeStamp, m_pid,
+                    event.process.minorFaultCount, event.process.majorFaultCount);
+        writeRecord("{\"name\":\"Context switches\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":%lld,"
+                    "\"args\":{\"voluntary\":%u,\"involuntary\":%u}}", timeStamp, m_pid,
+                    event.process.voluntaryContextSwitchCount,
+                    event.process.involuntaryContextSwitchCount);
+        writeRecord("{\"name\":\"I/O (bytes)\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":%lld,"
+                    "\"args\":{\"read\":%u,\"write\":%u}}", timeStamp, m_pid,
+                    event.process.readBytes, event.process.writeBytes);
+        writeRecord("{\"name\":\"Threads\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":%lld,"
+                    "\"args\":{\"count\":%u}}", timeStamp, m_pid, event.process.threadCount);
+        writeRecord("{\"name\":\"Thread CPU usage\",\"ph\":\"C\",\"ts\":%.3f,\"pid\":%lld,"
+                    "\"args\":{\"GUI %%\":%u,\"Render %%\":%u,\"Logging %%\":%u}}", timeStamp,
+                    m_pid, event.process.threadCpuUsage[UMProcessEvent::GuiThread],
+                    event.process.threadCpuUsage[UMProcessEvent::RenderThread],
+                    event.process.threadCpuUsage[UMProcessEvent::LoggingThread]);
+        break;
+    }
+
+    case UMEvent::Frame: {
+        // The frame time stamp is taken right after the swap, phases are laid
+        // out backwards from it. The GPU phase is approximated to start with
+        // the render phase, it's written on a dedicated track since it runs
+        // asynchronously.
+        const UMFrameEvent& frame = event.frame;
+        const quint32 track = windowTrackBase + frame.window * 2;
+        const double swapStart = timeStamp - frame.swapTime / 1000.0;
+        const double renderStart = swapStart - frame.renderTime / 1000.0;
+        const double syncStart = renderStart - frame.syncTime / 1000.0;
+        writeWindowTracks(frame.window);
+        writeRecord("{\"name\":\"Frame\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%lld,"
+                    "\"tid\":%u,\"args\":{\"number\":%u,\"delta (ms)\":%.3f}}", syncStart,
+                    timeStamp - syncStart, m_pid, track, frame.number,
+                    frame.deltaTime / 1000000.0);
+        writeRecord("{\"name\":\"Sync\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%lld,"
+                    "\"tid\":%u}", syncStart, frame.syncTime / 1000.0, m_pid, track);
+        writeRecord("{\"name\":\"Render\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%lld,"
+                    "\"tid\":%u}", renderStart, frame.renderTime / 1000.0, m_pid, track);
+        writeRecord("{\"name\":\"Swap\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%lld,"
+                    "\"tid\":%u}", swapStart, frame.swapTime / 1000.0, m_pid, track);
+        if (frame.gpuTime > 0) {
+            writeRecord("{\"name\":\"GPU\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%lld,"
+                        "\"tid\":%u,\"args\":{\"number\":%u}}", renderStart,
+                        frame.gpuTime / 1000.0, m_pid, track + 1, frame.number);
+        }
+        break;
+    }
+
+    case UMEvent::Window: {
+        const char* const stateString[] = { "Hidden", "Shown", "Resized" };
+        Q_STATIC_ASSERT(ARRAY_SIZE(stateString) == UMWindowEvent::StateCount);
+        writeWindowTracks(event.window.id);
+        writeRecord("{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":%lld,"
+                    "\"tid\":%u,\"args\":{\"width\":%u,\"height\":%u}}",
+                    stateString[event.window.state], timeStamp, m_pid,
+                    windowTrackBase + event.window.id * 2, event.window.width,
+                    event.window.height);
+        break;
+    }
+
+    case UMEvent::Generic: {
+        char string[UMGenericEvent::maxStringSize * 6 + 1];
+        escapeJsonString(string, event.generic.string, UMGenericEvent::maxStringSize);
+        writeRecord("{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"p\",\"ts\":%.3f,\"pid\":%lld,"
+                    "\"tid\":%lld,\"args\":{\"id\":%u}}", string, timeStamp, m_pid, m_pid,
+                    event.generic.id);
+        break;
+    }
+
+    case UMEvent::FrameSummary: {
+        const UMFrameSummaryEvent& summary = event.frameSummary;
+        const quint32 (&delta)[UMFrameSummaryEvent::StatisticCount] =
+            summary.times[UMFrameSummaryEvent::DeltaTime];
+        writeWindowTracks(summary.window);
+        writeRecord("{\"name\":\"Window %u frame delta (ms)\",\"ph\":\"C\",\"ts\":%.3f,"
+                    "\"pid\":%lld,\"args\":{\"p50\":%.3f,\"p90\":%.3f,\"p99\":%.3f,"
+                    "\"max\":%.3f}}", summary.window, timeStamp, m_pid,
+                    delta[UMFrameSummaryEvent::P50] / 1000.0,
+                    delta[UMFrameSummaryEvent::P90] / 1000.0,
+                    delta[UMFrameSummaryEvent::P99] / 1000.0,
+                    delta[UMFrameSummaryEvent::Max] / 1000.0);
+        writeRecord("{\"name\":\"Window %u missed frames\",\"ph\":\"C\",\"ts\":%.3f,"
+                    "\"pid\":%lld,\"args\":{\"count\":%u}}", summary.window, timeStamp, m_pid,
+                    summary.missedFrameCount);
+        break;
+    }
+
+    case UMEvent::Span: {
+        char string[UMSpanEvent::maxStringSize * 6 + 1];
+        escapeJsonString(string, event.span.string, UMSpanEvent::maxStringSize);
+        writeRecord("{\"name\":\"%s\",\"cat\":\"span\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%lld,"
+                    "\"tid\":%u,\"args\":{\"id\":%u}}", string,
+                    event.span.phase == UMSpanEvent::Begin ? 'B' : 'E', timeStamp, m_pid,
+                    event.span.threadId, event.span.id);
+        break;
+    }
+
+    case UMEvent::LongFrame: {
+        const char* const phaseString[] = { "Gap", "Sync", "Render", "GPU", "Swap" };
+        Q_STATIC_ASSERT(ARRAY_SIZE(phaseString) == UMLongFrameEvent::PhaseCount);
+        const UMLongFrameEvent& longFrame = event.longFrame;
+        writeWindowTracks(longFrame.window);
+        writeRecord("{\"name\":\"Long frame (%s)\",\"cat\":\"long_frame\",\"ph\":\"i\","
+                    "\"s\":\"t\",\"ts\":%.3f,\"pid\":%lld,\"tid\":%u,\"args\":{\"number\":%u,"
+                    "\"budget (ms)\":%.3f,\"time (ms)\":%.3f,\"gap (ms)\":%.3f,\"sync (ms)\":%.3f,"
+                    "\"render (ms)\":%.3f,\"gpu (ms)\":%.3f,\"swap (ms)\":%.3f,"
+                    "\"dirty items\":%u,\"animations\":%u}}",
+                    phaseString[longFrame.phase], timeStamp, m_pid,
+                    windowTrackBase + longFrame.window * 2, longFrame.number,
+                    longFrame.budget / 1000000.0, longFrame.frameTime / 1000000.0,
+                    longFrame.phaseTimes[UMLongFrameEvent::Gap] / 1000000.0,
+                    longFrame.phaseTimes[UMLongFrameEvent::Sync] / 1000000.0,
+                    longFrame.phaseTimes[UMLongFrameEvent::Render] / 1000000.0,
+                    longFrame.phaseTimes[UMLongFrameEvent::Gpu] / 1000000.0,
+                    longFrame.phaseTimes[UMLongFrameEvent::Swap] / 1000000.0,
+                    longFrame.dirtyItemCount, longFrame.animationCount);
+        break;
+    }
+
+    default:
+        DNOT_REACHED();
+        break;
+    }
+}
+
+static const char socketLogMagic[8] = { 'U', 'M', 'S', 'O', 'C', 'K', 'E', 'T' };
+
+UMSocketLogger::UMSocketLogger(const QString& socketPath)
+    : d_ptr(new UMSocketLoggerPrivate(socketPath))
+{
+}
+
+UMSocketLoggerPrivate::UMSocketLoggerPrivate(const QString& socketPath)
+    : m_droppedEventCount(0)
+    , m_socket(-1)
+{
+    const QByteArray path = QFile::encodeName(
+        socketPath.isEmpty() ? UMSocketLogger::defaultSocketPath() : socketPath);
+    if (path.isEmpty() || path.size() >= static_cast<int>(sizeof(m_address.sun_path))) {
+        WARN("SocketLogger: Invalid socket path '%s'.", path.constData());
+        return;
+    }
+    memset(&m_address, 0, sizeof(m_address));
+    m_address.sun_family = AF_UNIX;
+    memcpy(m_address.sun_path, path.constData(), path.size());
+
+    // The socket isn't connected so that the collector can be (re)started at
+    // any time, the destination address is passed at each send.
+    m_socket = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (m_socket == -1) {
+        WARN("SocketLogger: Can't create socket '%s'.", strerror(errno));
+        return;
+    }
+
+    // Store the monotonic time corresponding to the event time stamp 0 so that
+    // the receiver can align the time stamps of different processes.
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    const quint64 now = time.tv_sec * Q_UINT64_C(1000000000) + time.tv_nsec;
+    const quint64 timeStamp = UMEventUtils::timeStamp();
+
+    memset(&m_header, 0, sizeof(m_header));
+    memcpy(m_header.magic, socketLogMagic, sizeof(socketLogMagic));
+    m_header.version = UMSocketLogHeader::currentVersion;
+    m_header.eventSize = sizeof(UMEvent);
+    m_header.pid = QCoreApplication::applicationPid();
+    m_header.timeStampOrigin = now > timeStamp ? now - timeStamp : 0;
+}
+
+UMSocketLogger::~UMSocketLogger()
+{
+    delete d_ptr;
+}
+
+UMSocketLoggerPrivate::~UMSocketLoggerPrivate()
+{
+    if (m_socket != -1) {
+        close(m_socket);
+    }
+}
+
+bool UMSocketLogger::isOpen()
+{
+    return d_func()->m_socket != -1;
+}
+
+void UMSocketLogger::log(const UMEvent& event)
+{
+    d_func()->send(&event, 1);
+}
+
+void UMSocketLogger::log(const UMEvent* events, int count)
+{
+    DASSERT(events);
+    Q_D(UMSocketLogger);
+
+    while (count > 0) {
+        const int batchCount = qMin(count, static_cast<int>(UMSocketLogHeader::maxEventCount));
+        d->send(events, batchCount);
+        events += batchCount;
+        count -= batchCount;
+    }
+}
+
+// Sends a datagram without blocking. Events are dropped if the receiver's
+// queue is full or if there's no receiver bound to the socket path.
+void UMSocketLoggerPrivate::send(const UMEvent* events, int count)
+{
+    DASSERT(count <= static_cast<int>(UMSocketLogHeader::maxEventCount));
+
+    if (m_socket == -1) {
+        return;
+    }
+
+    m_header.eventCount = count;
+    struct iovec vectors[2];
+    vectors[0].iov_base = &m_header;
+    vectors[0].iov_len = sizeof(m_header);
+    vectors[1].iov_base = const_cast<UMEvent*>(events);
+    vectors[1].iov_len = count * sizeof(UMEvent);
+    struct msghdr message;
+    memset(&message, 0, sizeof(message));
+    message.msg_name = &m_address;
+    message.msg_namelen = sizeof(m_address);
+    message.msg_iov = vectors;
+    message.msg_iovlen = 2;
+
+    ssize_t result;
+    do {
+        result = sendmsg(m_socket, &message, MSG_DONTWAIT | MSG_NOSIGNAL);
+    } while (result == -1 && errno == EINTR);
+    if (result == -1) {
+        m_droppedEventCount.fetchAndAddRelaxed(count);
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != ENOBUFS
+            && errno != ECONNREFUSED && errno != ENOENT) {
+            DWARN("SocketLogger: Can't send events '%s'.", strerror(errno));
+        }
+    }
+}
+
+quint32 UMSocketLogger::droppedEventCount()
+{
+    return d_func()->m_droppedEventCount.load();
+}
+
+// static.
+QString UMSocketLogger::defaultSocketPath()
+{
+    QString directory = QStandardPaths::writableLocation(QStandardPaths::RuntimeLocation);
+    if (directory.isEmpty()) {
+        directory = QDir::tempPath();
+    }
+    return directory + QStringLiteral("/ubuntu-metrics");
+}
+
 #if defined(Q_OS_LINUX)
 
 UMLTTNGPlugin* UMLTTNGLogger::m_plugin = nullptr;
@@ -264,61 +991,147 @@ UMLTTNGLogger::UMLTTNGLogger()
     }
 }
 
-void UMLTTNGLogger::log(const UMEvent& event)
+static void logLttngEvent(UMLTTNGPlugin* plugin, const UMEvent& event)
 {
-    if (Q_LIKELY(m_plugin)) {
-        switch (event.type) {
+    switch (event.type) {
 
-        case UMEvent::Process: {
-            UMLTTNGProcessEvent processEvent = {
-                .vszMemory = event.process.vszMemory,
-                .rssMemory = event.process.rssMemory,
-                .cpuUsage = event.process.cpuUsage,
-                .threadCount = event.process.threadCount
-            };
-            m_plugin->logProcessEvent(&processEvent);
-            break;
-        }
+    case UMEvent::Process: {
+        UMLTTNGProcessEvent processEvent = {
+            .vszMemory = event.process.vszMemory,
+            .rssMemory = event.process.rssMemory,
+            .cpuUsage = event.process.cpuUsage,
+            .threadCount = event.process.threadCount,
+            .guiCpuUsage = event.process.threadCpuUsage[UMProcessEvent::GuiThread],
+            .renderCpuUsage = event.process.threadCpuUsage[UMProcessEvent::RenderThread],
+            .loggingCpuUsage = event.process.threadCpuUsage[UMProcessEvent::LoggingThread],
+            .pssMemory = event.process.pssMemory,
+            .ussMemory = event.process.ussMemory,
+            .minorFaultCount = event.process.minorFaultCount,
+            .majorFaultCount = event.process.majorFaultCount,
+            .voluntaryContextSwitchCount = event.process.voluntaryContextSwitchCount,
+            .involuntaryContextSwitchCount = event.process.involuntaryContextSwitchCount,
+            .readBytes = event.process.readBytes,
+            .writeBytes = event.process.writeBytes
+        };
+        plugin->logProcessEvent(&processEvent);
+        break;
+    }
 
-        case UMEvent::Frame: {
-            UMLTTNGFrameEvent frameEvent = {
-                .window = event.frame.window,
-                .number = event.frame.number,
-                .deltaTime = event.frame.deltaTime * 0.000001f,
-                .syncTime = event.frame.syncTime * 0.000001f,
-                .renderTime = event.frame.renderTime * 0.000001f,
-                .gpuTime = event.frame.gpuTime * 0.000001f,
-                .swapTime = event.frame.swapTime * 0.000001f
-            };
-            m_plugin->logFrameEvent(&frameEvent);
-            break;
-        }
+    case UMEvent::Frame: {
+        UMLTTNGFrameEvent frameEvent = {
+            .window = event.frame.window,
+            .number = event.frame.number,
+            .deltaTime = event.frame.deltaTime * 0.000001f,
+            .syncTime = event.frame.syncTime * 0.000001f,
+            .renderTime = event.frame.renderTime * 0.000001f,
+            .gpuTime = event.frame.gpuTime * 0.000001f,
+            .swapTime = event.frame.swapTime * 0.000001f
+        };
+        plugin->logFrameEvent(&frameEvent);
+        break;
+    }
 
-        case UMEvent::Window: {
-            const char* stateString[] = { "Hidden", "Shown", "Resized" };
-            Q_STATIC_ASSERT(ARRAY_SIZE(stateString) == UMWindowEvent::StateCount);
-            UMLTTNGWindowEvent windowEvent = {
-                .state = stateString[event.window.state],
-                .id = event.window.id,
-                .width = event.window.width,
-                .height = event.window.height
-            };
-            m_plugin->logWindowEvent(&windowEvent);
-            break;
-        }
+    case UMEvent::Window: {
+        const char* stateString[] = { "Hidden", "Shown", "Resized" };
+        Q_STATIC_ASSERT(ARRAY_SIZE(stateString) == UMWindowEvent::StateCount);
+        UMLTTNGWindowEvent windowEvent = {
+            .state = stateString[event.window.state],
+            .id = event.window.id,
+            .width = event.window.width,
+            .height = event.window.height
+        };
+        plugin->logWindowEvent(&windowEvent);
+        break;
+    }
 
-        case UMEvent::Generic: {
-            UMLTTNGGenericEvent genericEvent;
-            genericEvent.id = event.generic.id;
-            DASSERT(event.generic.stringSize < UMGenericEvent::maxStringSize);
-            memcpy(genericEvent.string, event.generic.string, event.generic.stringSize);
-            m_plugin->logGenericEvent(&genericEvent);
-            break;
+    case UMEvent::Generic: {
+        UMLTTNGGenericEvent genericEvent;
+        genericEvent.id = event.generic.id;
+        DASSERT(event.generic.stringSize < UMGenericEvent::maxStringSize);
+        memcpy(genericEvent.string, event.generic.string, event.generic.stringSize);
+        plugin->logGenericEvent(&genericEvent);
+        break;
+    }
+
+    case UMEvent::FrameSummary: {
+        UMLTTNGFrameSummaryEvent frameSummaryEvent;
+        frameSummaryEvent.window = event.frameSummary.window;
+        frameSummaryEvent.frameCount = event.frameSummary.frameCount;
+        frameSummaryEvent.missedFrameCount = event.frameSummary.missedFrameCount;
+        Q_STATIC_ASSERT(sizeof(frameSummaryEvent.times) == sizeof(event.frameSummary.times));
+        memcpy(frameSummaryEvent.times, event.frameSummary.times, sizeof(frameSummaryEvent.times));
+        plugin->logFrameSummaryEvent(&frameSummaryEvent);
+        break;
+    }
+
+    case UMEvent::Span: {
+        const char* phaseString[] = { "Begin", "End" };
+        Q_STATIC_ASSERT(ARRAY_SIZE(phaseString) == UMSpanEvent::PhaseCount);
+        UMLTTNGSpanEvent spanEvent;
+        spanEvent.phase = phaseString[event.span.phase];
+        spanEvent.id = event.span.id;
+        spanEvent.threadId = event.span.threadId;
+        spanEvent.depth = event.span.depth;
+        spanEvent.duration = event.span.duration * 0.000001f;
+        DASSERT(event.span.stringSize <= UMSpanEvent::maxStringSize);
+        memcpy(spanEvent.string, event.span.string, event.span.stringSize);
+        plugin->logSpanEvent(&spanEvent);
+        break;
+    }
+
+    case UMEvent::LongFrame: {
+        const char* phaseString[] = { "Gap", "Sync", "Render", "GPU", "Swap" };
+        Q_STATIC_ASSERT(ARRAY_SIZE(phaseString) == UMLongFrameEvent::PhaseCount);
+        UMLTTNGLongFrameEvent longFrameEvent;
+        longFrameEvent.phase = phaseString[event.longFrame.phase];
+        longFrameEvent.window = event.longFrame.window;
+        longFrameEvent.number = event.longFrame.number;
+        longFrameEvent.budget = event.longFrame.budget * 0.000001f;
+        longFrameEvent.frameTime = event.longFrame.frameTime * 0.000001f;
+        for (int i = 0; i < UMLongFrameEvent::PhaseCount; ++i) {
+            longFrameEvent.phaseTimes[i] = event.longFrame.phaseTimes[i] * 0.000001f;
         }
+        longFrameEvent.dirtyItemCount = event.longFrame.dirtyItemCount;
+        longFrameEvent.animationCount = event.longFrame.animationCount;
+        plugin->logLongFrameEvent(&longFrameEvent);
+        break;
+    }
 
-        default:
-            DNOT_REACHED();
-            break;
+    default:
+        DNOT_REACHED();
+        break;
+    }
+}
+
+void UMLTTNGLogger::log(const UMEvent& event)
+{
+    if (Q_LIKELY(m_plugin)) {
+        logLttngEvent(m_plugin, event);
+    }
+}
+
+void UMLTTNGLogger::log(const UMEvent* events, int count)
+{
+    DASSERT(events);
+
+    // Tracepoint states are only checked once per batch, events of disabled
+    // tracepoints (all of them when no session is tracing) aren't converted.
+    static const quint32 eventMask[] = {
+        UM_LTTNG_PROCESS_EVENT, UM_LTTNG_WINDOW_EVENT, UM_LTTNG_FRAME_EVENT,
+        UM_LTTNG_GENERIC_EVENT, UM_LTTNG_FRAME_SUMMARY_EVENT, UM_LTTNG_SPAN_EVENT,
+        UM_LTTNG_LONG_FRAME_EVENT
+    };
+    Q_STATIC_ASSERT(ARRAY_SIZE(eventMask) == UMEvent::TypeCount);
+
+    if (Q_LIKELY(m_plugin)) {
+        UMLTTNGPlugin* plugin = m_plugin;
+        const quint32 enabledEvents = plugin->enabledEvents();
+        if (enabledEvents) {
+            for (int i = 0; i < count; ++i) {
+                if (enabledEvents & eventMask[events[i].type]) {
+                    logLttngEvent(plugin, events[i]);
+                }
+            }
         }
     }
 }
@@ -23,6 +23,9 @@
 #include <UbuntuMetrics/ubuntumetricsglobal.h>
 
 class UMFileLoggerPrivate;
+class UMBinaryLoggerPrivate;
+class UMTraceEventLoggerPrivate;
+class UMSocketLoggerPrivate;
 struct UMLTTNGPlugin;
 struct UMEvent;
 
@@ -37,6 +40,12 @@ public:
 
     // Get whether the target device has been opened successfully or not.
     virtual bool isOpen() = 0;
+
+    // Log a batch of count events stored contiguously. The default
+    // implementation calls log() for each event, loggers can reimplement it to
+    // amortise their per event costs. The built-in loggers do, so subclasses
+    // reimplementing their log(const UMEvent&) must reimplement it too.
+    virtual void log(const UMEvent* events, int count);
 };
 
 // Log events to a file.
@@ -48,6 +57,7 @@ public:
     ~UMFileLogger();
 
     void log(const UMEvent& event) Q_DECL_OVERRIDE;
+    void log(const UMEvent* events, int count) Q_DECL_OVERRIDE;
     bool isOpen() Q_DECL_OVERRIDE;
 
     void setParsable(bool parsable);
@@ -58,6 +68,121 @@ private:
     Q_DECLARE_PRIVATE(UMFileLogger)
 };
 
+// Log raw events to a memory mapped binary file. The file is pre-sized to
+// store preallocatedEventCount events and grows by the same amount whenever
+// full, it is truncated to the logged events at destruction. That's the
+// cheapest way to log events to a file, UMBinaryLogReader and the
+// ubuntu-metrics-convert tool allow to read the file back.
+class UBUNTU_METRICS_EXPORT UMBinaryLogger : public UMLogger
+{
+public:
+    UMBinaryLogger(const QString& fileName, quint32 preallocatedEventCount = 8192);
+    ~UMBinaryLogger();
+
+    void log(const UMEvent& event) Q_DECL_OVERRIDE;
+    void log(const UMEvent* events, int count) Q_DECL_OVERRIDE;
+    bool isOpen() Q_DECL_OVERRIDE;
+
+private:
+    UMBinaryLoggerPrivate* const d_ptr;
+    Q_DECLARE_PRIVATE(UMBinaryLogger)
+};
+
+// Log events to a file in the Trace Event JSON format, which can be loaded in
+// chrome://tracing or Perfetto. Frames are written as slices split into their
+// sync, render, swap and GPU phases, process metrics as counters, window and
+// generic events as instant events and spans as nested slices on the thread
+// they've been traced on. Events are streamed through a fixed size buffer
+// flushed at each log call. The file is written with the JSON array format
+// which stays loadable if the process crashes before the logger is destroyed.
+class UBUNTU_METRICS_EXPORT UMTraceEventLogger : public UMLogger
+{
+public:
+    UMTraceEventLogger(const QString& fileName);
+    UMTraceEventLogger(FILE* fileHandle);
+    ~UMTraceEventLogger();
+
+    void log(const UMEvent& event) Q_DECL_OVERRIDE;
+    void log(const UMEvent* events, int count) Q_DECL_OVERRIDE;
+    bool isOpen() Q_DECL_OVERRIDE;
+
+    // Set the id of the process the events are attributed to. Default is the
+    // current process, tools aggregating the events of other processes (like
+    // ubuntu-metrics-collector) can change it between log calls.
+    void setProcessId(qint64 pid);
+    qint64 processId();
+
+private:
+    UMTraceEventLoggerPrivate* const d_ptr;
+    Q_DECLARE_PRIVATE(UMTraceEventLogger)
+};
+
+// Header of the datagrams sent by UMSocketLogger. It is directly followed by
+// eventCount raw UMEvent records. Data is stored in the byte order of the host.
+struct UBUNTU_METRICS_EXPORT UMSocketLogHeader
+{
+    static const quint32 currentVersion = 1;
+
+    // Maximum number of events per datagram.
+    static const quint32 maxEventCount = 64;
+
+    // Identifies the datagram format, must be "UMSOCKET" (no null-terminating
+    // char).
+    char magic[8];
+
+    // Version of the datagram format. Must be incremented whenever the header
+    // or the events layout change.
+    quint32 version;
+
+    // Size of an event record in bytes.
+    quint32 eventSize;
+
+    // Number of events following the header.
+    quint32 eventCount;
+
+    quint32 __padding;
+
+    // Id of the process which logged the events.
+    quint64 pid;
+
+    // Time in nanoseconds of the monotonic clock (CLOCK_MONOTONIC on Linux)
+    // corresponding to the event time stamp 0 of the process, allows to put
+    // the events of different processes on the same timeline.
+    quint64 timeStampOrigin;
+
+    // The whole struct must take 64 bytes to allow future additions.
+    quint8 __reserved[/*40 bytes taken,*/ 24 /*bytes free*/];
+};
+Q_STATIC_ASSERT(sizeof(UMSocketLogHeader) == 64);
+
+// Stream raw events to a local (AF_UNIX) datagram socket, typically the one
+// bound by the ubuntu-metrics-collector tool which aggregates the events of
+// several processes. Events are sent by batches of at most
+// UMSocketLogHeader::maxEventCount without ever blocking, they're dropped if
+// the receiver is too slow or not running. If the socket path is empty,
+// defaultSocketPath() is used.
+class UBUNTU_METRICS_EXPORT UMSocketLogger : public UMLogger
+{
+public:
+    UMSocketLogger(const QString& socketPath = QString());
+    ~UMSocketLogger();
+
+    void log(const UMEvent& event) Q_DECL_OVERRIDE;
+    void log(const UMEvent* events, int count) Q_DECL_OVERRIDE;
+    bool isOpen() Q_DECL_OVERRIDE;
+
+    // Get the number of events dropped since the creation of the logger.
+    quint32 droppedEventCount();
+
+    // Get the default socket path, "ubuntu-metrics" in the user runtime
+    // directory.
+    static QString defaultSocketPath();
+
+private:
+    UMSocketLoggerPrivate* const d_ptr;
+    Q_DECLARE_PRIVATE(UMSocketLogger)
+};
+
 #if defined(Q_OS_LINUX)
 
 // Log events to LTTng.
@@ -66,6 +191,7 @@ class UBUNTU_METRICS_EXPORT UMLTTNGLogger : public UMLogger
 public:
     UMLTTNGLogger();
     void log(const UMEvent& event) Q_DECL_OVERRIDE;
+    void log(const UMEvent* events, int count) Q_DECL_OVERRIDE;
     bool isOpen() Q_DECL_OVERRIDE { return true; }
 
 private:
@@ -20,10 +20,16 @@
 
 #include <UbuntuMetrics/logger.h>
 
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <QtCore/QAtomicInteger>
 #include <QtCore/QFile>
+#include <QtCore/QSet>
 #include <QtCore/QTextStream>
 
 #include <UbuntuMetrics/events.h>
+#include <UbuntuMetrics/binarylog.h>
 #include <UbuntuMetrics/private/ubuntumetricsglobal_p.h>
 
 class UBUNTU_METRICS_PRIVATE_EXPORT UMFileLoggerPrivate
@@ -38,11 +44,82 @@ public:
     UMFileLoggerPrivate(const QString& fileName, bool parsable);
     UMFileLoggerPrivate(FILE* fileHandle, bool parsable);
 
-    void log(const UMEvent& event);
+    // Writes an event to the text stream, flushing is left to the caller.
+    void write(const UMEvent& event);
 
     QFile m_file;
     QTextStream m_textStream;
     quint8 m_flags;
 };
 
+class UBUNTU_METRICS_PRIVATE_EXPORT UMBinaryLoggerPrivate
+{
+public:
+    enum {
+        Open = (1 << 0)
+    };
+
+    UMBinaryLoggerPrivate(const QString& fileName, quint32 preallocatedEventCount);
+    ~UMBinaryLoggerPrivate();
+
+    bool map(quint64 capacity);
+    void log(const UMEvent* events, int count);
+
+    QFile m_file;
+    UMBinaryLogHeader* m_header;
+    UMEvent* m_events;
+    quint64 m_capacity;
+    quint32 m_preallocatedEventCount;
+    quint8 m_flags;
+};
+
+class UBUNTU_METRICS_PRIVATE_EXPORT UMTraceEventLoggerPrivate
+{
+public:
+    enum {
+        Open        = (1 << 0),
+        FirstRecord = (1 << 1)
+    };
+
+    // Records are formatted in a fixed size buffer, flushed whenever there's
+    // not enough room left for the biggest record.
+    static const int bufferSize = 16384;
+    static const int maxRecordSize = 1024;
+
+    // Window tracks are identified by thread ids above the kernel's maximum
+    // (2^22 on Linux) so that they don't collide with the span threads.
+    static const quint32 windowTrackBase = 1u << 30;
+
+    UMTraceEventLoggerPrivate(const QString& fileName);
+    UMTraceEventLoggerPrivate(FILE* fileHandle);
+    ~UMTraceEventLoggerPrivate();
+
+    void initialize();
+    void write(const UMEvent& event);
+    void writeRecord(const char* format, ...) Q_ATTRIBUTE_FORMAT_PRINTF(2, 3);
+    void writeWindowTracks(quint32 window);
+    void flush();
+
+    QFile m_file;
+    QSet<quint64> m_windows;  // Keys are made of the process id and the window id.
+    qint64 m_pid;
+    int m_bufferUsed;
+    quint8 m_flags;
+    char m_buffer[bufferSize];
+};
+
+class UBUNTU_METRICS_PRIVATE_EXPORT UMSocketLoggerPrivate
+{
+public:
+    UMSocketLoggerPrivate(const QString& socketPath);
+    ~UMSocketLoggerPrivate();
+
+    void send(const UMEvent* events, int count);
+
+    UMSocketLogHeader m_header;
+    struct sockaddr_un m_address;
+    QAtomicInteger<quint32> m_droppedEventCount;
+    int m_socket;
+};
+
 #endif  // LOGGER_P_H
@@ -38,9 +38,39 @@ static void logGenericEvent(UMLTTNGGenericEvent* event)
     tracepoint(UbuntuMetrics, generic, event);
 }
 
+static void logFrameSummaryEvent(UMLTTNGFrameSummaryEvent* event)
+{
+    tracepoint(UbuntuMetrics, frame_summary, event);
+}
+
+static void logSpanEvent(UMLTTNGSpanEvent* event)
+{
+    tracepoint(UbuntuMetrics, span, event);
+}
+
+static void logLongFrameEvent(UMLTTNGLongFrameEvent* event)
+{
+    tracepoint(UbuntuMetrics, long_frame, event);
+}
+
+static uint32_t enabledEvents(void)
+{
+    return (tracepoint_enabled(UbuntuMetrics, process) ? UM_LTTNG_PROCESS_EVENT : 0)
+        | (tracepoint_enabled(UbuntuMetrics, frame) ? UM_LTTNG_FRAME_EVENT : 0)
+        | (tracepoint_enabled(UbuntuMetrics, window) ? UM_LTTNG_WINDOW_EVENT : 0)
+        | (tracepoint_enabled(UbuntuMetrics, generic) ? UM_LTTNG_GENERIC_EVENT : 0)
+        | (tracepoint_enabled(UbuntuMetrics, frame_summary) ? UM_LTTNG_FRAME_SUMMARY_EVENT : 0)
+        | (tracepoint_enabled(UbuntuMetrics, span) ? UM_LTTNG_SPAN_EVENT : 0)
+        | (tracepoint_enabled(UbuntuMetrics, long_frame) ? UM_LTTNG_LONG_FRAME_EVENT : 0);
+}
+
 const struct UMLTTNGPlugin umLttngPlugin = {
     &logProcessEvent,
     &logFrameEvent,
     &logWindowEvent,
     &logGenericEvent,
+    &logFrameSummaryEvent,
+    &logSpanEvent,
+    &logLongFrameEvent,
+    &enabledEvents,
 };
@@ -25,12 +25,31 @@ typedef struct _UMLTTNGProcessEvent UMLTTNGProcessEvent;
 typedef struct _UMLTTNGFrameEvent UMLTTNGFrameEvent;
 typedef struct _UMLTTNGWindowEvent UMLTTNGWindowEvent;
 typedef struct _UMLTTNGGenericEvent UMLTTNGGenericEvent;
+typedef struct _UMLTTNGFrameSummaryEvent UMLTTNGFrameSummaryEvent;
+typedef struct _UMLTTNGSpanEvent UMLTTNGSpanEvent;
+typedef struct _UMLTTNGLongFrameEvent UMLTTNGLongFrameEvent;
+
+// Bits returned by UMLTTNGPlugin::enabledEvents().
+enum {
+    UM_LTTNG_PROCESS_EVENT = 1 << 0,
+    UM_LTTNG_FRAME_EVENT = 1 << 1,
+    UM_LTTNG_WINDOW_EVENT = 1 << 2,
+    UM_LTTNG_GENERIC_EVENT = 1 << 3,
+    UM_LTTNG_FRAME_SUMMARY_EVENT = 1 << 4,
+    UM_LTTNG_SPAN_EVENT = 1 << 5,
+    UM_LTTNG_LONG_FRAME_EVENT = 1 << 6
+};
 
 struct UMLTTNGPlugin {
     void (*logProcessEvent)(UMLTTNGProcessEvent*);
     void (*logFrameEvent)(UMLTTNGFrameEvent*);
     void (*logWindowEvent)(UMLTTNGWindowEvent*);
     void (*logGenericEvent)(UMLTTNGGenericEvent*);
+    void (*logFrameSummaryEvent)(UMLTTNGFrameSummaryEvent*);
+    void (*logSpanEvent)(UMLTTNGSpanEvent*);
+    void (*logLongFrameEvent)(UMLTTNGLongFrameEvent*);
+    // Gets the mask of the tracepoints enabled by the tracing sessions.
+    uint32_t (*enabledEvents)(void);
 };
 
 struct _UMLTTNGProcessEvent {
@@ -38,6 +57,17 @@ struct _UMLTTNGProcessEvent {
     uint32_t rssMemory;
     uint16_t cpuUsage;
     uint16_t threadCount;
+    uint16_t guiCpuUsage;
+    uint16_t renderCpuUsage;
+    uint16_t loggingCpuUsage;
+    uint32_t pssMemory;
+    uint32_t ussMemory;
+    uint32_t minorFaultCount;
+    uint32_t majorFaultCount;
+    uint32_t voluntaryContextSwitchCount;
+    uint32_t involuntaryContextSwitchCount;
+    uint32_t readBytes;
+    uint32_t writeBytes;
 };
 
 struct _UMLTTNGFrameEvent {
@@ -65,4 +95,36 @@ struct _UMLTTNGGenericEvent {
     char string[64];
 };
 
+struct _UMLTTNGFrameSummaryEvent {
+    uint32_t window;
+    uint32_t frameCount;
+    uint32_t missedFrameCount;
+    // Keep the layout in sync with UMFrameSummaryEvent::times, p50, p90, p99
+    // and max in microseconds for the delta, sync, render, GPU and swap times.
+    uint32_t times[5][4];
+};
+
+struct _UMLTTNGSpanEvent {
+    const char* phase;
+    uint32_t id;
+    uint32_t threadId;
+    uint16_t depth;
+    float duration;
+    // Keep the size in sync with UMSpanEvent::maxStringSize.
+    char string[64];
+};
+
+struct _UMLTTNGLongFrameEvent {
+    const char* phase;
+    uint32_t window;
+    uint32_t number;
+    float budget;
+    float frameTime;
+    // Keep the layout in sync with UMLongFrameEvent::phaseTimes, gap, sync,
+    // render, GPU and swap times in milliseconds.
+    float phaseTimes[5];
+    uint32_t dirtyItemCount;
+    uint32_t animationCount;
+};
+
 #endif  // LTTNG_P_H
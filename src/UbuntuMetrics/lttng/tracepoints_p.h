@@ -36,6 +36,19 @@ TRACEPOINT_EVENT(
         ctf_integer(uint32_t, vsz_memory, processEvent->vszMemory)
         ctf_integer(uint32_t, rss_memory, processEvent->rssMemory)
         ctf_integer(uint16_t, thread_count, processEvent->threadCount)
+        ctf_integer(uint16_t, gui_cpu_usage, processEvent->guiCpuUsage)
+        ctf_integer(uint16_t, render_cpu_usage, processEvent->renderCpuUsage)
+        ctf_integer(uint16_t, logging_cpu_usage, processEvent->loggingCpuUsage)
+        ctf_integer(uint32_t, pss_memory, processEvent->pssMemory)
+        ctf_integer(uint32_t, uss_memory, processEvent->ussMemory)
+        ctf_integer(uint32_t, minor_fault_count, processEvent->minorFaultCount)
+        ctf_integer(uint32_t, major_fault_count, processEvent->majorFaultCount)
+        ctf_integer(uint32_t, voluntary_context_switch_count,
+                    processEvent->voluntaryContextSwitchCount)
+        ctf_integer(uint32_t, involuntary_context_switch_count,
+                    processEvent->involuntaryContextSwitchCount)
+        ctf_integer(uint32_t, read_bytes, processEvent->readBytes)
+        ctf_integer(uint32_t, write_bytes, processEvent->writeBytes)
     )
 )
 
@@ -79,5 +92,58 @@ TRACEPOINT_EVENT(
     )
 )
 
+TRACEPOINT_EVENT(
+    UbuntuMetrics, frame_summary,
+    TP_ARGS(
+        UMLTTNGFrameSummaryEvent*, frameSummaryEvent
+    ),
+    TP_FIELDS(
+        ctf_integer(uint32_t, window, frameSummaryEvent->window)
+        ctf_integer(uint32_t, frame_count, frameSummaryEvent->frameCount)
+        ctf_integer(uint32_t, missed_frame_count, frameSummaryEvent->missedFrameCount)
+        ctf_array(uint32_t, delta_time, frameSummaryEvent->times[0], 4)
+        ctf_array(uint32_t, sync_time, frameSummaryEvent->times[1], 4)
+        ctf_array(uint32_t, render_time, frameSummaryEvent->times[2], 4)
+        ctf_array(uint32_t, gpu_time, frameSummaryEvent->times[3], 4)
+        ctf_array(uint32_t, swap_time, frameSummaryEvent->times[4], 4)
+    )
+)
+
+TRACEPOINT_EVENT(
+    UbuntuMetrics, span,
+    TP_ARGS(
+        UMLTTNGSpanEvent*, spanEvent
+    ),
+    TP_FIELDS(
+        ctf_string(phase, spanEvent->phase)
+        ctf_integer(uint32_t, id, spanEvent->id)
+        ctf_integer(uint32_t, thread_id, spanEvent->threadId)
+        ctf_integer(uint16_t, depth, spanEvent->depth)
+        ctf_float(float, duration, spanEvent->duration)
+        ctf_string(string, spanEvent->string)
+    )
+)
+
+TRACEPOINT_EVENT(
+    UbuntuMetrics, long_frame,
+    TP_ARGS(
+        UMLTTNGLongFrameEvent*, longFrameEvent
+    ),
+    TP_FIELDS(
+        ctf_integer(uint32_t, window, longFrameEvent->window)
+        ctf_integer(uint32_t, number, longFrameEvent->number)
+        ctf_string(phase, longFrameEvent->phase)
+        ctf_float(float, budget, longFrameEvent->budget)
+        ctf_float(float, frame_time, longFrameEvent->frameTime)
+        ctf_float(float, gap_time, longFrameEvent->phaseTimes[0])
+        ctf_float(float, sync_time, longFrameEvent->phaseTimes[1])
+        ctf_float(float, render_time, longFrameEvent->phaseTimes[2])
+        ctf_float(float, gpu_time, longFrameEvent->phaseTimes[3])
+        ctf_float(float, swap_time, longFrameEvent->phaseTimes[4])
+        ctf_integer(uint32_t, dirty_item_count, longFrameEvent->dirtyItemCount)
+        ctf_integer(uint32_t, animation_count, longFrameEvent->animationCount)
+    )
+)
+
 #endif  // TRACEPOINTS_P_H
 #include <lttng/tracepoint-event.h>
@@ -55,6 +55,13 @@ static const struct {
     { "threadCount", sizeof("threadCount") - 1, 3, UMEvent::Process },
     { "vszMemory",   sizeof("vszMemory") - 1,   8, UMEvent::Process },
     { "rssMemory",   sizeof("rssMemory") - 1,   8, UMEvent::Process },
+    { "guiCpuUsage", sizeof("guiCpuUsage") - 1, 3, UMEvent::Process },
+    { "renderCpuUsage", sizeof("renderCpuUsage") - 1, 3, UMEvent::Process },
+    { "loggingCpuUsage", sizeof("loggingCpuUsage") - 1, 3, UMEvent::Process },
+    { "pssMemory",   sizeof("pssMemory") - 1,   8, UMEvent::Process },
+    { "ussMemory",   sizeof("ussMemory") - 1,   8, UMEvent::Process },
+    { "minorFaults", sizeof("minorFaults") - 1, 6, UMEvent::Process },
+    { "majorFaults", sizeof("majorFaults") - 1, 6, UMEvent::Process },
     { "windowId",    sizeof("windowId") - 1,    2, UMEvent::Window  },
     { "windowSize",  sizeof("windowSize") - 1,  9, UMEvent::Window  },
     { "frameNumber", sizeof("frameNumber") - 1, 7, UMEvent::Frame   },
@@ -62,11 +69,16 @@ static const struct {
     { "syncTime",    sizeof("syncTime") - 1,    7, UMEvent::Frame   },
     { "renderTime",  sizeof("renderTime") - 1,  7, UMEvent::Frame   },
     { "gpuTime",     sizeof("gpuTime") - 1,     7, UMEvent::Frame   },
-    { "totalTime",   sizeof("totalTime") - 1,   7, UMEvent::Frame   }
+    { "totalTime",   sizeof("totalTime") - 1,   7, UMEvent::Frame   },
+    { "longFrameCount", sizeof("longFrameCount") - 1, 5, UMEvent::LongFrame },
+    { "longFrameTime",  sizeof("longFrameTime") - 1,  7, UMEvent::LongFrame },
+    { "longFramePhase", sizeof("longFramePhase") - 1, 6, UMEvent::LongFrame }
 };
 enum {
-    CpuUsage = 0, ThreadCount, VszMemory, RssMemory, WindowId, WindowSize, FrameNumber, DeltaTime,
-    SyncTime, RenderTime, GpuTime, TotalTime, MetricCount
+    CpuUsage = 0, ThreadCount, VszMemory, RssMemory, GuiCpuUsage, RenderCpuUsage, LoggingCpuUsage,
+    PssMemory, UssMemory, MinorFaults, MajorFaults, WindowId, WindowSize, FrameNumber, DeltaTime,
+    SyncTime, RenderTime, GpuTime, TotalTime, LongFrameCount, LongFrameTime, LongFramePhase,
+    MetricCount
 };
 Q_STATIC_ASSERT(ARRAY_SIZE(metricInfo) == MetricCount);
 
@@ -92,13 +104,16 @@ Overlay::Overlay(const char* text, int windowId)
     , m_metricsSize{}
     , m_frameSize(0, 0)
     , m_windowId(windowId)
-    , m_flags(DirtyText | DirtyProcessEvent)
+    , m_longFrameCount(0)
+    , m_flags(DirtyText | DirtyProcessEvent | DirtyLongFrameEvent)
 {
     DASSERT(text);
 
     m_buffer = alignedAlloc(bufferAlignment, bufferSize);
     memset(&m_processEvent, 0, sizeof(m_processEvent));
     m_processEvent.type = UMEvent::Process;
+    memset(&m_longFrameEvent, 0, sizeof(m_longFrameEvent));
+    m_longFrameEvent.type = UMEvent::LongFrame;
 }
 
 Overlay::~Overlay()
@@ -150,6 +165,15 @@ void Overlay::setProcessEvent(const UMEvent& processEvent)
     m_flags |= DirtyProcessEvent;
 }
 
+void Overlay::setLongFrameEvent(const UMEvent& longFrameEvent)
+{
+    DASSERT(longFrameEvent.type == UMEvent::LongFrame);
+
+    memcpy(&m_longFrameEvent, &longFrameEvent, sizeof(m_longFrameEvent));
+    m_longFrameCount++;
+    m_flags |= DirtyLongFrameEvent;
+}
+
 void Overlay::render(const UMEvent& frameEvent, const QSize& frameSize)
 {
     DASSERT(m_flags & Initialized);
@@ -170,6 +194,10 @@ void Overlay::render(const UMEvent& frameEvent, const QSize& frameSize)
         updateProcessMetrics();
         m_flags &= ~DirtyProcessEvent;
     }
+    if (m_flags & DirtyLongFrameEvent) {
+        updateLongFrameMetrics();
+        m_flags &= ~DirtyLongFrameEvent;
+    }
     updateFrameMetrics(frameEvent);
     m_bitmapText.render();
 }
@@ -343,6 +371,32 @@ void Overlay::updateProcessMetrics()
         case RssMemory:
             integerMetricToText(m_processEvent.process.rssMemory, text, textWidth);
             break;
+        case GuiCpuUsage:
+            integerMetricToText(
+                m_processEvent.process.threadCpuUsage[UMProcessEvent::GuiThread], text, textWidth);
+            break;
+        case RenderCpuUsage:
+            integerMetricToText(
+                m_processEvent.process.threadCpuUsage[UMProcessEvent::RenderThread], text,
+                textWidth);
+            break;
+        case LoggingCpuUsage:
+            integerMetricToText(
+                m_processEvent.process.threadCpuUsage[UMProcessEvent::LoggingThread], text,
+                textWidth);
+            break;
+        case PssMemory:
+            integerMetricToText(m_processEvent.process.pssMemory, text, textWidth);
+            break;
+        case UssMemory:
+            integerMetricToText(m_processEvent.process.ussMemory, text, textWidth);
+            break;
+        case MinorFaults:
+            integerMetricToText(m_processEvent.process.minorFaultCount, text, textWidth);
+            break;
+        case MajorFaults:
+            integerMetricToText(m_processEvent.process.majorFaultCount, text, textWidth);
+            break;
         default:
             DNOT_REACHED();
             break;
@@ -354,6 +408,44 @@ void Overlay::updateProcessMetrics()
     }
 }
 
+void Overlay::updateLongFrameMetrics()
+{
+    DASSERT(m_flags & Initialized);
+    Q_STATIC_ASSERT(IS_POWER_OF_TWO(maxMetricWidth));
+
+    char* text = static_cast<char*>(m_buffer);
+    for (int i = 0; i < m_metricsSize[UMEvent::LongFrame]; i++) {
+        int textWidth = m_metrics[UMEvent::LongFrame][i].width;
+        DASSERT(textWidth <= maxMetricWidth);
+        memset(text, ' ', maxMetricWidth);
+
+        switch (m_metrics[UMEvent::LongFrame][i].index) {
+        case LongFrameCount:
+            integerMetricToText(m_longFrameCount, text, textWidth);
+            break;
+        case LongFrameTime:
+            timeMetricToText(m_longFrameEvent.longFrame.frameTime, text, textWidth);
+            break;
+        case LongFramePhase: {
+            const char* const phaseString[] = { "Gap", "Sync", "Render", "GPU", "Swap" };
+            Q_STATIC_ASSERT(ARRAY_SIZE(phaseString) == UMLongFrameEvent::PhaseCount);
+            const char* const phase =
+                m_longFrameCount > 0 ? phaseString[m_longFrameEvent.longFrame.phase] : "N/A";
+            int phaseSize = strlen(phase);
+            do { text[--textWidth] = phase[--phaseSize]; } while (textWidth > 0 && phaseSize > 0);
+            break;
+        }
+        default:
+            DNOT_REACHED();
+            break;
+        }
+
+        m_bitmapText.updateText(
+            text, m_metrics[UMEvent::LongFrame][i].textIndex,
+            m_metrics[UMEvent::LongFrame][i].width);
+    }
+}
+
 static int cpuModel(char* buffer, int bufferSize)
 {
     DASSERT(buffer);
@@ -45,6 +45,9 @@ public:
     // Sets the process event.
     void setProcessEvent(const UMEvent& processEvent);
 
+    // Sets the latest long frame event, long frames are counted.
+    void setLongFrameEvent(const UMEvent& longFrameEvent);
+
     // Renders the overlay. Must be called in a thread with the same OpenGL
     // context bound than at initialize().
     void render(const UMEvent& frameEvent, const QSize& frameSize);
@@ -53,13 +56,15 @@ private:
     void updateFrameMetrics(const UMEvent& frameEvent);
     void updateWindowMetrics(quint32 windowId, const QSize& frameSize);
     void updateProcessMetrics();
+    void updateLongFrameMetrics();
     int keywordString(int index, char* buffer, int bufferSize);
     void parseText();
 
     enum {
         Initialized       = (1 << 0),
         DirtyText         = (1 << 1),
-        DirtyProcessEvent = (1 << 2)
+        DirtyProcessEvent = (1 << 2),
+        DirtyLongFrameEvent = (1 << 3)
     };
 
     static const int maxMetricsPerType = 16;
@@ -79,8 +84,10 @@ private:
     BitmapText m_bitmapText;
     QSize m_frameSize;
     quint32 m_windowId;
+    quint32 m_longFrameCount;
     quint8 m_flags;
     alignas(64) UMEvent m_processEvent;
+    UMEvent m_longFrameEvent;
 };
 
 #endif  // OVERLAY_P_H
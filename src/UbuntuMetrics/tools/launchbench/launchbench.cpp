@@ -0,0 +1,404 @@
+// Copyright © 2016 Canonical Ltd.
+// Author: Loïc Molinari <loic.molinari@canonical.com>
+//
+// This file is part of Ubuntu UI Toolkit.
+//
+// Ubuntu UI Toolkit is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation; version 3.
+//
+// Ubuntu UI Toolkit is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Ubuntu UI Toolkit. If not, see <http://www.gnu.org/licenses/>.
+
+// Launches a toolkit application a number of times on a headless QPA platform
+// and measures the time from the process creation to the first frame swapped
+// and to the UserInterfaceReady event, both received from the UbuntuMetrics
+// socket logger. The QML disk cache is redirected to a private directory which
+// is either cleared before each launch (cold) or primed by an uncounted launch
+// (warm). Statistics are written as JSON.
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCommandLineOption>
+#include <QtCore/QDir>
+#include <QtCore/QFile>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
+#include <QtCore/QProcess>
+#include <QtCore/QTemporaryDir>
+#include <QtCore/QVector>
+
+#include <UbuntuMetrics/events.h>
+#include <UbuntuMetrics/logger.h>
+
+static quint64 monotonicTime()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * Q_UINT64_C(1000000000) + time.tv_nsec;
+}
+
+// Times in nanoseconds since the process creation, 0 if not received.
+struct Launch
+{
+    quint64 firstFrame;
+    quint64 userInterfaceReady;
+};
+
+class LaunchBench
+{
+public:
+    LaunchBench(int fd, const QStringList& command, const QProcessEnvironment& environment,
+                int timeout, bool waitReady)
+        : m_fd(fd), m_command(command), m_environment(environment), m_timeout(timeout)
+        , m_waitReady(waitReady)
+        , m_buffer(sizeof(UMSocketLogHeader)
+                   + UMSocketLogHeader::maxEventCount * sizeof(UMEvent), '\0') {}
+
+    // Launches the command once and waits for the first frame (and the
+    // UserInterfaceReady event if requested) or for the timeout. Returns false
+    // if the process can't be started, exits early or times out.
+    bool launch(Launch* launch);
+
+private:
+    void drainSocket();
+    void receiveEvents(qint64 pid, quint64 startTime, Launch* launch);
+
+    const int m_fd;
+    const QStringList m_command;
+    const QProcessEnvironment m_environment;
+    const int m_timeout;
+    const bool m_waitReady;
+    QByteArray m_buffer;
+};
+
+// Discards the events left by a previous launch.
+void LaunchBench::drainSocket()
+{
+    while (recv(m_fd, m_buffer.data(), m_buffer.size(), MSG_DONTWAIT) > 0) {}
+}
+
+void LaunchBench::receiveEvents(qint64 pid, quint64 startTime, Launch* launch)
+{
+    const ssize_t size = recv(m_fd, m_buffer.data(), m_buffer.size(), MSG_DONTWAIT);
+    const UMSocketLogHeader* header =
+        reinterpret_cast<const UMSocketLogHeader*>(m_buffer.constData());
+    if (size < static_cast<ssize_t>(sizeof(UMSocketLogHeader))
+        || memcmp(header->magic, "UMSOCKET", sizeof(header->magic))
+        || header->version != UMSocketLogHeader::currentVersion
+        || header->eventSize != sizeof(UMEvent)
+        || header->eventCount > UMSocketLogHeader::maxEventCount
+        || size != static_cast<ssize_t>(
+            sizeof(UMSocketLogHeader) + header->eventCount * sizeof(UMEvent))
+        || header->pid != pid) {
+        return;
+    }
+
+    const UMEvent* events =
+        reinterpret_cast<const UMEvent*>(m_buffer.constData() + sizeof(UMSocketLogHeader));
+    for (quint32 i = 0; i < header->eventCount; ++i) {
+        const UMEvent& event = events[i];
+        if (event.type != UMEvent::Generic || event.generic.id != 0) {
+            continue;
+        }
+        const quint64 timeStamp = event.timeStamp + header->timeStampOrigin;
+        const quint64 time = qMax(timeStamp > startTime ? timeStamp - startTime : 0, Q_UINT64_C(1));
+        const QByteArray string(event.generic.string, qstrnlen(event.generic.string,
+                                                                event.generic.stringSize));
+        if (string == "FirstFrameSwapped" && !launch->firstFrame) {
+            launch->firstFrame = time;
+        } else if (string == "UserInterfaceReady" && !launch->userInterfaceReady) {
+            launch->userInterfaceReady = time;
+        }
+    }
+}
+
+bool LaunchBench::launch(Launch* launch)
+{
+    launch->firstFrame = 0;
+    launch->userInterfaceReady = 0;
+    drainSocket();
+
+    QProcess process;
+    process.setProcessEnvironment(m_environment);
+    process.setProcessChannelMode(QProcess::ForwardedErrorChannel);
+    process.setStandardOutputFile(QProcess::nullDevice());
+    const quint64 startTime = monotonicTime();
+    process.start(m_command[0], m_command.mid(1));
+    if (!process.waitForStarted()) {
+        fprintf(stderr, "Can't start '%s'.\n", m_command[0].toLocal8Bit().constData());
+        return false;
+    }
+    const qint64 pid = process.processId();
+
+    bool success = false;
+    while (true) {
+        struct pollfd pollFd = { m_fd, POLLIN, 0 };
+        if (poll(&pollFd, 1, 10) > 0) {
+            receiveEvents(pid, startTime, launch);
+        }
+        if (launch->firstFrame && (!m_waitReady || launch->userInterfaceReady)) {
+            success = true;
+            break;
+        }
+        if ((monotonicTime() - startTime) / 1000000 > static_cast<quint64>(m_timeout)) {
+            fprintf(stderr, "Launch timed out.\n");
+            break;
+        }
+        if (process.waitForFinished(0) || process.state() == QProcess::NotRunning) {
+            fprintf(stderr, "Process exited before the first frame.\n");
+            break;
+        }
+    }
+
+    if (process.state() != QProcess::NotRunning) {
+        process.terminate();
+        if (!process.waitForFinished(5000)) {
+            process.kill();
+            process.waitForFinished();
+        }
+    }
+    return success;
+}
+
+// Writes 3 to drop_caches so that the page cache, dentries and inodes are
+// freed. Requires root privileges.
+static bool dropCaches()
+{
+    sync();
+    QFile file(QStringLiteral("/proc/sys/vm/drop_caches"));
+    return file.open(QIODevice::WriteOnly) && file.write("3\n") == 2;
+}
+
+// Gets the statistics of the given times in milliseconds.
+static QJsonObject statistics(QVector<double> samples)
+{
+    QJsonObject object;
+    QJsonArray array;
+    for (int i = 0; i < samples.size(); ++i) {
+        array.append(samples[i]);
+    }
+    object.insert(QStringLiteral("count"), samples.size());
+    object.insert(QStringLiteral("samples"), array);
+    if (samples.isEmpty()) {
+        return object;
+    }
+
+    std::sort(samples.begin(), samples.end());
+    const int count = samples.size();
+    double mean = 0.0;
+    for (int i = 0; i < count; ++i) {
+        mean += samples[i];
+    }
+    mean /= count;
+    double variance = 0.0;
+    for (int i = 0; i < count; ++i) {
+        variance += (samples[i] - mean) * (samples[i] - mean);
+    }
+    variance = count > 1 ? variance / (count - 1) : 0.0;
+    const double median = count % 2
+        ? samples[count / 2] : (samples[count / 2 - 1] + samples[count / 2]) * 0.5;
+    // Nearest-rank percentile.
+    const int p95Rank = qMax(static_cast<int>(ceil(0.95 * count)), 1);
+
+    object.insert(QStringLiteral("mean"), mean);
+    object.insert(QStringLiteral("median"), median);
+    object.insert(QStringLiteral("p95"), samples[p95Rank - 1]);
+    object.insert(QStringLiteral("variance"), variance);
+    object.insert(QStringLiteral("stddev"), sqrt(variance));
+    object.insert(QStringLiteral("min"), samples.first());
+    object.insert(QStringLiteral("max"), samples.last());
+    return object;
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication application(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("ubuntu-metrics-launchbench"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        QStringLiteral("Benchmark the start up time of a toolkit application on a headless "
+                       "platform. Times are in milliseconds from the process creation."));
+    parser.addHelpOption();
+    QCommandLineOption countOption(
+        QStringList() << QStringLiteral("n") << QStringLiteral("count"),
+        QStringLiteral("Number of measured launches per cache mode, default is 10."),
+        QStringLiteral("count"), QStringLiteral("10"));
+    parser.addOption(countOption);
+    QCommandLineOption platformOption(
+        QStringList() << QStringLiteral("p") << QStringLiteral("platform"),
+        QStringLiteral("QPA platform, default is 'offscreen'."), QStringLiteral("name"),
+        QStringLiteral("offscreen"));
+    parser.addOption(platformOption);
+    QCommandLineOption cacheOption(
+        QStringList() << QStringLiteral("c") << QStringLiteral("cache"),
+        QStringLiteral("QML disk cache mode, 'cold', 'warm' or 'both' (default)."),
+        QStringLiteral("mode"), QStringLiteral("both"));
+    parser.addOption(cacheOption);
+    QCommandLineOption dropCachesOption(
+        QStringList() << QStringLiteral("d") << QStringLiteral("drop-caches"),
+        QStringLiteral("Drop the kernel page cache before each launch (requires root)."));
+    parser.addOption(dropCachesOption);
+    QCommandLineOption readyOption(
+        QStringList() << QStringLiteral("r") << QStringLiteral("wait-ready"),
+        QStringLiteral("Wait for the UserInterfaceReady event, not only for the first "
+                       "frame."));
+    parser.addOption(readyOption);
+    QCommandLineOption timeoutOption(
+        QStringList() << QStringLiteral("t") << QStringLiteral("timeout"),
+        QStringLiteral("Time out of a launch in milliseconds, default is 30000."),
+        QStringLiteral("ms"), QStringLiteral("30000"));
+    parser.addOption(timeoutOption);
+    QCommandLineOption outputOption(
+        QStringList() << QStringLiteral("o") << QStringLiteral("output"),
+        QStringLiteral("Output JSON file, standard output if not set."),
+        QStringLiteral("file"));
+    parser.addOption(outputOption);
+    parser.addPositionalArgument(
+        QStringLiteral("command"), QStringLiteral("Command launching the application."),
+        QStringLiteral("-- command [arguments...]"));
+    parser.process(application);
+
+    const QStringList command = parser.positionalArguments();
+    const int count = parser.value(countOption).toInt();
+    const int timeout = parser.value(timeoutOption).toInt();
+    const QString cache = parser.value(cacheOption);
+    if (command.isEmpty() || count <= 0 || timeout <= 0
+        || (cache != QStringLiteral("cold") && cache != QStringLiteral("warm")
+            && cache != QStringLiteral("both"))) {
+        parser.showHelp(1);
+    }
+
+    // The QML disk cache and the socket are stored in a private directory.
+    QTemporaryDir directory;
+    if (!directory.isValid()) {
+        fprintf(stderr, "Can't create temporary directory.\n");
+        return 1;
+    }
+    const QString cachePath = directory.path() + QStringLiteral("/cache");
+    const QByteArray path = QFile::encodeName(directory.path() + QStringLiteral("/socket"));
+    struct sockaddr_un address;
+    if (path.size() >= static_cast<int>(sizeof(address.sun_path))) {
+        fprintf(stderr, "Invalid socket path '%s'.\n", path.constData());
+        return 1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.constData(), path.size());
+    const int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        fprintf(stderr, "Can't create socket '%s'.\n", strerror(errno));
+        return 1;
+    }
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) == -1) {
+        fprintf(stderr, "Can't bind socket '%s' '%s'.\n", path.constData(), strerror(errno));
+        close(fd);
+        return 1;
+    }
+
+    // Only the generic events are needed, the toolkit configures the
+    // application monitor from the environment.
+    QProcessEnvironment environment = QProcessEnvironment::systemEnvironment();
+    environment.insert(QStringLiteral("QT_QPA_PLATFORM"), parser.value(platformOption));
+    environment.insert(QStringLiteral("XDG_CACHE_HOME"), cachePath);
+    environment.insert(QStringLiteral("UC_METRICS_LOGGING"),
+                       QStringLiteral("socket:") + QFile::decodeName(path));
+    environment.insert(QStringLiteral("UC_METRICS_LOGGING_FILTER"), QStringLiteral("generic"));
+    LaunchBench bench(fd, command, environment, timeout, parser.isSet(readyOption));
+
+    bool dropCachesFailed = false;
+    QStringList modes;
+    if (cache != QStringLiteral("warm")) {
+        modes << QStringLiteral("cold");
+    }
+    if (cache != QStringLiteral("cold")) {
+        modes << QStringLiteral("warm");
+    }
+
+    QJsonObject results;
+    for (int i = 0; i < modes.size(); ++i) {
+        const bool cold = modes[i] == QStringLiteral("cold");
+        QDir(cachePath).removeRecursively();
+        QDir().mkpath(cachePath);
+        Launch launch;
+        if (!cold) {
+            // Uncounted launch filling the cache.
+            bench.launch(&launch);
+        }
+
+        QVector<double> firstFrameTimes;
+        QVector<double> userInterfaceReadyTimes;
+        int failureCount = 0;
+        for (int j = 0; j < count; ++j) {
+            if (cold) {
+                QDir(cachePath).removeRecursively();
+                QDir().mkpath(cachePath);
+            }
+            if (parser.isSet(dropCachesOption) && !dropCaches() && !dropCachesFailed) {
+                fprintf(stderr, "Can't drop caches, root privileges are required.\n");
+                dropCachesFailed = true;
+            }
+            const bool success = bench.launch(&launch);
+            if (success) {
+                firstFrameTimes.append(launch.firstFrame / 1000000.0);
+                fprintf(stderr, "%s launch %d/%d: %.2f ms\n", modes[i].toLatin1().constData(),
+                        j + 1, count, launch.firstFrame / 1000000.0);
+            } else {
+                failureCount++;
+                fprintf(stderr, "%s launch %d/%d: failed\n", modes[i].toLatin1().constData(),
+                        j + 1, count);
+            }
+            if (launch.userInterfaceReady) {
+                userInterfaceReadyTimes.append(launch.userInterfaceReady / 1000000.0);
+            }
+        }
+
+        QJsonObject result;
+        result.insert(QStringLiteral("firstFrame"), statistics(firstFrameTimes));
+        result.insert(QStringLiteral("userInterfaceReady"), statistics(userInterfaceReadyTimes));
+        result.insert(QStringLiteral("failures"), failureCount);
+        results.insert(modes[i], result);
+    }
+    close(fd);
+
+    QJsonObject root;
+    root.insert(QStringLiteral("command"), QJsonArray::fromStringList(command));
+    root.insert(QStringLiteral("platform"), parser.value(platformOption));
+    root.insert(QStringLiteral("count"), count);
+    root.insert(QStringLiteral("dropCaches"),
+                parser.isSet(dropCachesOption) && !dropCachesFailed);
+    root.insert(QStringLiteral("results"), results);
+    const QByteArray json = QJsonDocument(root).toJson();
+
+    if (parser.isSet(outputOption)) {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)
+            || file.write(json) != json.size()) {
+            fprintf(stderr, "Can't write file '%s'.\n",
+                    parser.value(outputOption).toLocal8Bit().constData());
+            return 1;
+        }
+    } else {
+        fwrite(json.constData(), 1, json.size(), stdout);
+    }
+
+    return 0;
+}
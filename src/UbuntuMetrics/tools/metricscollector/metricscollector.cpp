@@ -0,0 +1,238 @@
+// Copyright © 2016 Canonical Ltd.
+// Author: Loïc Molinari <loic.molinari@canonical.com>
+//
+// This file is part of Ubuntu UI Toolkit.
+//
+// Ubuntu UI Toolkit is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation; version 3.
+//
+// Ubuntu UI Toolkit is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Ubuntu UI Toolkit. If not, see <http://www.gnu.org/licenses/>.
+
+// Collects the events streamed by UMSocketLogger from any number of local
+// processes and writes them either to a single Trace Event JSON file, with one
+// track per process on a common timeline, or live to the standard output in the
+// human readable text format.
+
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCommandLineOption>
+#include <QtCore/QFile>
+
+#include <UbuntuMetrics/events.h>
+#include <UbuntuMetrics/logger.h>
+
+static volatile sig_atomic_t quitRequested = 0;
+
+static void signalHandler(int)
+{
+    quitRequested = 1;
+}
+
+static quint64 monotonicTime()
+{
+    struct timespec time;
+    clock_gettime(CLOCK_MONOTONIC, &time);
+    return time.tv_sec * Q_UINT64_C(1000000000) + time.tv_nsec;
+}
+
+// Removes the socket left at path by a previous run that didn't exit cleanly.
+// Returns false if path exists and isn't a socket or if another collector is
+// bound to it, in which case it's left untouched.
+static bool removeStaleSocket(const QByteArray& path, const struct sockaddr_un& address)
+{
+    struct stat status;
+    if (lstat(path.constData(), &status) == -1) {
+        return errno == ENOENT;
+    }
+    if (!S_ISSOCK(status.st_mode)) {
+        fprintf(stderr, "'%s' exists and isn't a socket.\n", path.constData());
+        return false;
+    }
+    // Connecting to a datagram socket nobody is bound to is refused.
+    const int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        return false;
+    }
+    const int result = connect(
+        fd, reinterpret_cast<const struct sockaddr*>(&address), sizeof(address));
+    const int error = errno;
+    close(fd);
+    if (result == 0 || error != ECONNREFUSED) {
+        fprintf(stderr, "Socket '%s' is in use.\n", path.constData());
+        return false;
+    }
+    return unlink(path.constData()) == 0;
+}
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication application(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("ubuntu-metrics-collector"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        QStringLiteral("Collect the UbuntuMetrics events streamed by local processes."));
+    parser.addHelpOption();
+    QCommandLineOption socketOption(
+        QStringList() << QStringLiteral("s") << QStringLiteral("socket"),
+        QStringLiteral("Socket path, default is '%1'.").arg(UMSocketLogger::defaultSocketPath()),
+        QStringLiteral("path"));
+    parser.addOption(socketOption);
+    QCommandLineOption textOption(
+        QStringList() << QStringLiteral("t") << QStringLiteral("text"),
+        QStringLiteral("Output the human readable text format, each line prefixed by the "
+                       "process id, instead of the Trace Event JSON format."));
+    parser.addOption(textOption);
+    parser.addPositionalArgument(
+        QStringLiteral("output"), QStringLiteral("Output file, standard output if not set."),
+        QStringLiteral("[output]"));
+    parser.process(application);
+
+    const QStringList arguments = parser.positionalArguments();
+    if (arguments.size() > 1) {
+        parser.showHelp(1);
+    }
+
+    const QByteArray path = QFile::encodeName(
+        parser.isSet(socketOption) ? parser.value(socketOption)
+        : UMSocketLogger::defaultSocketPath());
+    struct sockaddr_un address;
+    if (path.isEmpty() || path.size() >= static_cast<int>(sizeof(address.sun_path))) {
+        fprintf(stderr, "Invalid socket path '%s'.\n", path.constData());
+        return 1;
+    }
+    memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    memcpy(address.sun_path, path.constData(), path.size());
+
+    if (!removeStaleSocket(path, address)) {
+        return 1;
+    }
+    const int fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        fprintf(stderr, "Can't create socket '%s'.\n", strerror(errno));
+        return 1;
+    }
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) == -1) {
+        fprintf(stderr, "Can't bind socket '%s' '%s'.\n", path.constData(), strerror(errno));
+        close(fd);
+        return 1;
+    }
+
+    const bool text = parser.isSet(textOption);
+    FILE* textFile = stdout;
+    UMLogger* logger;
+    if (text) {
+        // The text file is opened here since the process id prefixes are
+        // written to it too.
+        if (arguments.size() == 1) {
+            textFile = fopen(QFile::encodeName(arguments[0]).constData(), "w");
+            if (!textFile) {
+                fprintf(stderr, "Can't open file '%s' '%s'.\n",
+                        arguments[0].toLocal8Bit().constData(), strerror(errno));
+                unlink(path.constData());
+                close(fd);
+                return 1;
+            }
+        }
+        logger = new UMFileLogger(textFile, false);
+    } else {
+        logger = arguments.size() == 1
+            ? new UMTraceEventLogger(arguments[0]) : new UMTraceEventLogger(stdout);
+    }
+    if (!logger->isOpen()) {
+        delete logger;
+        if (textFile != stdout) {
+            fclose(textFile);
+        }
+        unlink(path.constData());
+        close(fd);
+        return 1;
+    }
+
+    // Stop on SIGINT and SIGTERM. SA_RESTART isn't set so that the blocking
+    // receive is interrupted.
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = signalHandler;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    // Time stamps are rebased on the start of the collector so that the events
+    // of all the processes share the same timeline.
+    const quint64 origin = monotonicTime();
+    const quint32 maxSize = sizeof(UMSocketLogHeader)
+        + UMSocketLogHeader::maxEventCount * sizeof(UMEvent);
+    QByteArray buffer(maxSize, '\0');
+    UMEvent* events = reinterpret_cast<UMEvent*>(buffer.data() + sizeof(UMSocketLogHeader));
+
+    while (!quitRequested) {
+        const ssize_t size = recv(fd, buffer.data(), maxSize, 0);
+        if (size == -1) {
+            if (errno != EINTR) {
+                fprintf(stderr, "Can't receive events '%s'.\n", strerror(errno));
+                break;
+            }
+            continue;
+        }
+
+        const UMSocketLogHeader* header =
+            reinterpret_cast<const UMSocketLogHeader*>(buffer.constData());
+        if (size < static_cast<ssize_t>(sizeof(UMSocketLogHeader))
+            || memcmp(header->magic, "UMSOCKET", sizeof(header->magic))
+            || header->version != UMSocketLogHeader::currentVersion
+            || header->eventSize != sizeof(UMEvent)
+            || header->eventCount > UMSocketLogHeader::maxEventCount
+            || size != static_cast<ssize_t>(
+                sizeof(UMSocketLogHeader) + header->eventCount * sizeof(UMEvent))) {
+            fprintf(stderr, "Ignoring invalid datagram.\n");
+            continue;
+        }
+
+        const quint32 count = header->eventCount;
+        for (quint32 i = 0; i < count; ++i) {
+            const quint64 timeStamp = events[i].timeStamp + header->timeStampOrigin;
+            events[i].timeStamp = timeStamp > origin ? timeStamp - origin : 0;
+        }
+        if (text) {
+            // The logger writes unbuffered to the same file descriptor, flush
+            // the prefix before each event to keep the ordering.
+            for (quint32 i = 0; i < count; ++i) {
+                fprintf(textFile, "%llu ", static_cast<unsigned long long>(header->pid));
+                fflush(textFile);
+                logger->log(events[i]);
+            }
+        } else {
+            static_cast<UMTraceEventLogger*>(logger)->setProcessId(header->pid);
+            logger->log(events, count);
+        }
+    }
+
+    // Deleting the logger terminates the JSON array.
+    delete logger;
+    if (textFile != stdout) {
+        fclose(textFile);
+    }
+    unlink(path.constData());
+    close(fd);
+
+    return 0;
+}
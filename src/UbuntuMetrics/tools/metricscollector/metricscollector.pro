@@ -0,0 +1,7 @@
+TEMPLATE = app
+TARGET = ubuntu-metrics-collector
+QT = core UbuntuMetrics
+CONFIG += c++11
+SOURCES += metricscollector.cpp
+target.path = $$[QT_INSTALL_PREFIX]/bin
+INSTALLS += target
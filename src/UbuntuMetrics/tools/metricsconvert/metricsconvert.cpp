@@ -0,0 +1,85 @@
+// Copyright © 2016 Canonical Ltd.
+// Author: Loïc Molinari <loic.molinari@canonical.com>
+//
+// This file is part of Ubuntu UI Toolkit.
+//
+// Ubuntu UI Toolkit is free software: you can redistribute it and/or modify it
+// under the terms of the GNU Lesser General Public License as published by the
+// Free Software Foundation; version 3.
+//
+// Ubuntu UI Toolkit is distributed in the hope that it will be useful, but
+// WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE. See the GNU Lesser General Public License
+// for more details.
+//
+// You should have received a copy of the GNU Lesser General Public License
+// along with Ubuntu UI Toolkit. If not, see <http://www.gnu.org/licenses/>.
+
+// Converts binary log files written by UMBinaryLogger to the text format of
+// UMFileLogger or to the Trace Event JSON format of UMTraceEventLogger.
+
+#include <cstdio>
+
+#include <QtCore/QCoreApplication>
+#include <QtCore/QCommandLineParser>
+#include <QtCore/QCommandLineOption>
+
+#include <UbuntuMetrics/binarylog.h>
+#include <UbuntuMetrics/logger.h>
+
+int main(int argc, char* argv[])
+{
+    QCoreApplication application(argc, argv);
+    QCoreApplication::setApplicationName(QStringLiteral("ubuntu-metrics-convert"));
+
+    QCommandLineParser parser;
+    parser.setApplicationDescription(
+        QStringLiteral("Convert an UbuntuMetrics binary log to a text format."));
+    parser.addHelpOption();
+    QCommandLineOption readableOption(
+        QStringList() << QStringLiteral("r") << QStringLiteral("readable"),
+        QStringLiteral("Output the human readable text format instead of the parsable one."));
+    parser.addOption(readableOption);
+    QCommandLineOption traceOption(
+        QStringList() << QStringLiteral("t") << QStringLiteral("trace"),
+        QStringLiteral("Output the Trace Event JSON format (chrome://tracing, Perfetto)."));
+    parser.addOption(traceOption);
+    parser.addPositionalArgument(QStringLiteral("input"), QStringLiteral("Binary log file."));
+    parser.addPositionalArgument(
+        QStringLiteral("output"), QStringLiteral("Output file, standard output if not set."),
+        QStringLiteral("[output]"));
+    parser.process(application);
+
+    const QStringList arguments = parser.positionalArguments();
+    if (arguments.size() < 1 || arguments.size() > 2) {
+        parser.showHelp(1);
+    }
+
+    UMBinaryLogReader reader(arguments[0]);
+    if (!reader.isOpen()) {
+        return 1;
+    }
+    UMLogger* logger;
+    if (parser.isSet(traceOption)) {
+        logger = arguments.size() == 2
+            ? new UMTraceEventLogger(arguments[1]) : new UMTraceEventLogger(stdout);
+    } else {
+        const bool parsable = !parser.isSet(readableOption);
+        logger = arguments.size() == 2
+            ? new UMFileLogger(arguments[1], parsable) : new UMFileLogger(stdout, parsable);
+    }
+    if (!logger->isOpen()) {
+        delete logger;
+        return 1;
+    }
+
+    // Events are contiguous in the mapped file, log them by batches.
+    const int batchSize = 1024;
+    const quint64 eventCount = reader.eventCount();
+    for (quint64 i = 0; i < eventCount; i += batchSize) {
+        logger->log(reader.event(i), static_cast<int>(qMin<quint64>(batchSize, eventCount - i)));
+    }
+    delete logger;
+
+    return 0;
+}
@@ -50,6 +50,7 @@ HEADERS += \
     $$PWD/privates/listitemdraghandler_p.h \
     $$PWD/privates/listitemselection_p.h \
     $$PWD/privates/listviewextensions_p.h \
+    $$PWD/privates/softwareshapes_p.h \
     $$PWD/privates/splitviewhandler_p.h \
     $$PWD/privates/threelabelsslot_p.h \
     $$PWD/privates/ucpagewrapper_p.h \
@@ -163,6 +164,7 @@ SOURCES += \
     $$PWD/privates/listitemexpansion.cpp \
     $$PWD/privates/listitemselection.cpp \
     $$PWD/privates/listviewextensions.cpp \
+    $$PWD/privates/softwareshapes.cpp \
     $$PWD/privates/splitviewhandler.cpp \
     $$PWD/privates/threelabelsslot_p.cpp \
     $$PWD/privates/ucpagewrapper.cpp \
@@ -18,9 +18,12 @@
 
 #include "privates/frame_p.h"
 
+#include <QtCore/qmath.h>
+#include <QtGui/QGuiApplication>
 #include <QtGui/QOpenGLContext>
 #include <QtGui/QOpenGLFunctions>
 
+#include "privates/softwareshapes_p.h"
 #include "privates/textures_p.h"
 
 UT_NAMESPACE_BEGIN
@@ -466,6 +469,17 @@ QSGNode* UCFrame::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* data)
         return NULL;
     }
 
+    if (isSoftwareRendering(this)) {
+        const float dpr = qGuiApp->devicePixelRatio();
+        SoftwareShape shape;
+        shape.type = SoftwareShape::Frame;
+        shape.size = QSize(qCeil(itemSize.width() * dpr), qCeil(itemSize.height() * dpr));
+        shape.thickness = m_thickness * dpr;
+        shape.radius = m_radius * dpr;
+        shape.color[0] = m_color;
+        return updateSoftwareShapeNode(this, oldNode, shape);
+    }
+
     UCFrameNode* node = oldNode ? static_cast<UCFrameNode*>(oldNode) : new UCFrameNode();
     node->updateGeometry(itemSize, m_thickness, m_radius, m_color);
 
@@ -0,0 +1,293 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "privates/softwareshapes_p.h"
+
+#include <QtCore/QCache>
+#include <QtCore/QMutex>
+#include <QtGui/QPainter>
+#include <QtQuick/QQuickWindow>
+#include <QtQuick/QSGImageNode>
+#include <QtQuick/QSGRendererInterface>
+// Only used for its inline pixmap() getter, the class isn't exported.
+#include <QtQuick/private/qsgsoftwarepixmaptexture_p.h>
+
+UT_NAMESPACE_BEGIN
+
+// Maximum size in bytes of the shape images cache.
+const int maxShapeImageCacheCost = 8 * 1024 * 1024;
+
+// Factor by which the RGB colors are multiplied for the pressed aspect, like the OpenGL shader.
+const float pressedFactor = 0.85f;
+
+// Opacity of the bottom shadow of the drop shadow aspect and of the bevel of the inset aspect.
+const int shadowAlpha = 48;
+const int bevelAlpha = 64;
+
+SoftwareShape::SoftwareShape()
+    : radius(0.0f)
+    , thickness(0.0f)
+    , overlayColor(qRgba(0, 0, 0, 0))
+    , type(Shape)
+    , aspect(Flat)
+    , pressed(false)
+    , sourceOpacity(255)
+    , sourceHorizontallyRepeated(false)
+    , sourceVerticallyRepeated(false)
+{
+    color[0] = color[1] = qRgba(0, 0, 0, 0);
+}
+
+// The source isn't compared, shapes with a source are never cached.
+bool SoftwareShape::operator==(const SoftwareShape& other) const
+{
+    return size == other.size && radius == other.radius && thickness == other.thickness
+        && color[0] == other.color[0] && color[1] == other.color[1]
+        && overlayRect == other.overlayRect && overlayColor == other.overlayColor
+        && type == other.type && aspect == other.aspect && pressed == other.pressed;
+}
+
+static uint qHash(const SoftwareShape& shape, uint seed = 0)
+{
+    return ::qHash(shape.size.width(), seed) ^ ::qHash(shape.size.height() << 16, seed)
+        ^ ::qHash(shape.radius, seed) ^ ::qHash(shape.thickness, seed)
+        ^ ::qHash(shape.color[0], seed) ^ (::qHash(shape.color[1], seed) << 1)
+        ^ ::qHash(shape.overlayColor, seed) ^ ::qHash(shape.type | (shape.aspect << 8), seed);
+}
+
+static QCache<SoftwareShape, QImage> shapeImageCache(maxShapeImageCacheCost);
+static QMutex shapeImageCacheMutex;
+static SoftwareShapeCacheStatistics shapeImageCacheStatistics = { 0, 0 };
+
+bool isSoftwareRendering(const QQuickItem* item)
+{
+    QQuickWindow* window = item->window();
+    return window && window->rendererInterface()
+        && window->rendererInterface()->graphicsApi() == QSGRendererInterface::Software;
+}
+
+QImage softwareTextureImage(QSGTexture* texture)
+{
+    if (texture && texture->inherits("QSGSoftwarePixmapTexture")) {
+        return static_cast<QSGSoftwarePixmapTexture*>(texture)->pixmap().toImage();
+    }
+    return QImage();
+}
+
+static void fillShape(QPainter* painter, const QPainterPath& path, const QRectF& rect,
+                      QRgb topColor, QRgb bottomColor)
+{
+    if (topColor == bottomColor) {
+        painter->fillPath(path, QColor::fromRgba(topColor));
+    } else {
+        QLinearGradient gradient(rect.topLeft(), rect.bottomLeft());
+        gradient.setColorAt(0.0, QColor::fromRgba(topColor));
+        gradient.setColorAt(1.0, QColor::fromRgba(bottomColor));
+        painter->fillPath(path, gradient);
+    }
+}
+
+static void paintSource(QPainter* painter, const SoftwareShape& shape, const QRectF& rect)
+{
+    const QRectF& target = shape.sourceRect;
+    if (target.isEmpty()) {
+        return;
+    }
+    painter->setOpacity(shape.sourceOpacity / 255.0);
+    if (!shape.sourceHorizontallyRepeated && !shape.sourceVerticallyRepeated) {
+        painter->drawImage(target, shape.source);
+    } else {
+        // Repeated directions take the whole shape, the others are limited to the target.
+        const QRectF area(
+            shape.sourceHorizontallyRepeated ? rect.x() : target.x(),
+            shape.sourceVerticallyRepeated ? rect.y() : target.y(),
+            shape.sourceHorizontallyRepeated ? rect.width() : target.width(),
+            shape.sourceVerticallyRepeated ? rect.height() : target.height());
+        QBrush brush(shape.source);
+        QTransform transform;
+        transform.translate(target.x(), target.y());
+        transform.scale(target.width() / shape.source.width(),
+                        target.height() / shape.source.height());
+        brush.setTransform(transform);
+        painter->fillRect(area, brush);
+    }
+    painter->setOpacity(1.0);
+}
+
+// Darkens the RGB channels of the premultiplied pixels.
+static void applyPressedFactor(QImage* image)
+{
+    const uint factor = static_cast<uint>(pressedFactor * 256.0f);
+    for (int y = 0; y < image->height(); y++) {
+        QRgb* pixels = reinterpret_cast<QRgb*>(image->scanLine(y));
+        for (int x = 0; x < image->width(); x++) {
+            const QRgb pixel = pixels[x];
+            pixels[x] = qRgba((qRed(pixel) * factor) >> 8, (qGreen(pixel) * factor) >> 8,
+                              (qBlue(pixel) * factor) >> 8, qAlpha(pixel));
+        }
+    }
+}
+
+// Rasterizes a shape. The squircle of the OpenGL textures is approximated by a rounded rectangle.
+static QImage rasterizeShape(const SoftwareShape& shape)
+{
+    QImage image(shape.size, QImage::Format_ARGB32_Premultiplied);
+    image.fill(Qt::transparent);
+    QPainter painter(&image);
+    painter.setRenderHint(QPainter::Antialiasing);
+    painter.setRenderHint(QPainter::SmoothPixmapTransform);
+
+    const QRectF rect(QPointF(0.0, 0.0), QSizeF(shape.size));
+    const qreal maxRadius = qMin(rect.width(), rect.height()) * 0.5;
+
+    if (shape.type == SoftwareShape::Frame) {
+        const qreal thickness = qMin(static_cast<qreal>(shape.thickness), maxRadius);
+        const qreal radiusOut = qBound(0.0, static_cast<qreal>(shape.radius), maxRadius);
+        const qreal radiusIn = radiusOut * ((maxRadius - thickness) / maxRadius);
+        QPainterPath outer;
+        outer.addRoundedRect(rect, radiusOut, radiusOut);
+        QPainterPath inner;
+        inner.addRoundedRect(
+            rect.adjusted(thickness, thickness, -thickness, -thickness), radiusIn, radiusIn);
+        painter.fillPath(outer.subtracted(inner), QColor::fromRgba(shape.color[0]));
+        return image;
+    }
+
+    // The drop shadow takes a few pixels at the bottom of the shape.
+    const qreal radius = qBound(0.0, static_cast<qreal>(shape.radius), maxRadius);
+    const qreal shadowSize =
+        shape.aspect == SoftwareShape::DropShadow ? qBound(1.0, radius * 0.125, 3.0) : 0.0;
+    const QRectF body = rect.adjusted(0.0, 0.0, 0.0, -shadowSize);
+    QPainterPath path;
+    path.addRoundedRect(body, radius, radius);
+
+    if (shadowSize > 0.0) {
+        QPainterPath shadow;
+        shadow.addRoundedRect(body.translated(0.0, shadowSize), radius, radius);
+        painter.fillPath(shadow.subtracted(path), QColor(0, 0, 0, shadowAlpha));
+    }
+
+    fillShape(&painter, path, body, shape.color[0], shape.color[1]);
+
+    painter.save();
+    painter.setClipPath(path);
+    if (!shape.source.isNull()) {
+        paintSource(&painter, shape, rect);
+    }
+    if (!shape.overlayRect.isEmpty()) {
+        painter.fillRect(
+            QRectF(shape.overlayRect.x() * rect.width(), shape.overlayRect.y() * rect.height(),
+                   shape.overlayRect.width() * rect.width(),
+                   shape.overlayRect.height() * rect.height()),
+            QColor::fromRgba(shape.overlayColor));
+    }
+    if (shape.aspect == SoftwareShape::Inset) {
+        // Dark line below the top edge and light line above the bottom edge.
+        QPainterPath lower;
+        lower.addRoundedRect(body.translated(0.0, 1.0), radius, radius);
+        painter.fillPath(path.subtracted(lower), QColor(0, 0, 0, bevelAlpha));
+        QPainterPath upper;
+        upper.addRoundedRect(body.translated(0.0, -1.0), radius, radius);
+        painter.fillPath(path.subtracted(upper), QColor(255, 255, 255, bevelAlpha));
+    }
+    painter.restore();
+    painter.end();
+
+    if (shape.pressed) {
+        applyPressedFactor(&image);
+    }
+    return image;
+}
+
+// Gets the image of a shape from the cache, rasterizing it if needed.
+static QImage shapeImage(const SoftwareShape& shape)
+{
+    if (!shape.source.isNull()) {
+        return rasterizeShape(shape);
+    }
+
+    QMutexLocker locker(&shapeImageCacheMutex);
+    if (QImage* image = shapeImageCache.object(shape)) {
+        shapeImageCacheStatistics.hits++;
+        return *image;
+    }
+    shapeImageCacheStatistics.misses++;
+    QImage* image = new QImage(rasterizeShape(shape));
+    const QImage result = *image;
+    shapeImageCache.insert(shape, image, image->bytesPerLine() * image->height());
+    return result;
+}
+
+SoftwareShapeCacheStatistics softwareShapeCacheStatistics()
+{
+    QMutexLocker locker(&shapeImageCacheMutex);
+    return shapeImageCacheStatistics;
+}
+
+void clearSoftwareShapeCache()
+{
+    QMutexLocker locker(&shapeImageCacheMutex);
+    shapeImageCache.clear();
+    shapeImageCacheStatistics.hits = 0;
+    shapeImageCacheStatistics.misses = 0;
+}
+
+class SoftwareShapeNode : public QSGNode
+{
+public:
+    SoftwareShapeNode(QSGImageNode* imageNode) : m_imageNode(imageNode) {
+        imageNode->setOwnsTexture(true);
+        appendChildNode(imageNode);
+#ifdef QSG_RUNTIME_DESCRIPTION
+        qsgnode_set_description(this, QLatin1String("softwareshape"));
+#endif
+    }
+    QSGImageNode* imageNode() { return m_imageNode; }
+    const SoftwareShape& shape() const { return m_shape; }
+    void setShape(const SoftwareShape& shape) {
+        m_shape = shape;
+        // Don't keep the source alive, shapes with a source are rasterized at each update.
+        m_shape.source = QImage();
+    }
+
+private:
+    QSGImageNode* m_imageNode;
+    SoftwareShape m_shape;
+};
+
+QSGNode* updateSoftwareShapeNode(QQuickItem* item, QSGNode* oldNode, const SoftwareShape& shape)
+{
+    if (shape.size.isEmpty()) {
+        delete oldNode;
+        return NULL;
+    }
+
+    QQuickWindow* window = item->window();
+    SoftwareShapeNode* node = oldNode ?
+        static_cast<SoftwareShapeNode*>(oldNode) : new SoftwareShapeNode(window->createImageNode());
+    QSGImageNode* imageNode = node->imageNode();
+
+    if (!imageNode->texture() || !shape.source.isNull() || node->shape() != shape) {
+        imageNode->setTexture(window->createTextureFromImage(shapeImage(shape)));
+        imageNode->setFiltering(QSGTexture::Linear);
+        node->setShape(shape);
+    }
+    imageNode->setRect(QRectF(0.0, 0.0, item->width(), item->height()));
+
+    return node;
+}
+
+UT_NAMESPACE_END
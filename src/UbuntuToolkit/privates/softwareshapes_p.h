@@ -0,0 +1,82 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef SOFTWARESHAPES_P_H
+#define SOFTWARESHAPES_P_H
+
+#include <QtGui/QImage>
+#include <QtQuick/QQuickItem>
+#include <QtQuick/QSGNode>
+
+#include <UbuntuToolkit/ubuntutoolkitglobal.h>
+
+UT_NAMESPACE_BEGIN
+
+// Description of a shape rasterized for the QtQuick software adaptation, which can't run the
+// shaders of the OpenGL nodes. Sizes are in physical pixels, colors are non-premultiplied.
+struct SoftwareShape
+{
+    enum Type { Shape = 0, Frame = 1 };
+    enum Aspect { Flat = 0, Inset = 1, DropShadow = 2 };
+
+    SoftwareShape();
+    bool operator==(const SoftwareShape& other) const;
+    bool operator!=(const SoftwareShape& other) const { return !(*this == other); }
+
+    QSize size;
+    float radius;
+    // Frame only.
+    float thickness;
+    // Top and bottom colors of the vertical gradient, only the first one is used by frames.
+    QRgb color[2];
+    // Overlay rectangle normalized in the shape size, ignored if empty.
+    QRectF overlayRect;
+    QRgb overlayColor;
+    quint8 type;
+    quint8 aspect;
+    bool pressed;
+
+    // Source image and its rectangle in the shape, shapes with a source aren't cached.
+    QImage source;
+    QRectF sourceRect;
+    quint8 sourceOpacity;
+    bool sourceHorizontallyRepeated;
+    bool sourceVerticallyRepeated;
+};
+
+// Whether the item is rendered by the QtQuick software adaptation.
+bool isSoftwareRendering(const QQuickItem* item);
+
+// Gets the image of a texture of the software adaptation, null if not supported.
+QImage softwareTextureImage(QSGTexture* texture);
+
+// Creates or updates the node rendering the given shape in the item. Shape images are cached and
+// shared by all the items of the same size, radius, colors and aspect, only a change of these
+// parameters re-rasterizes the shape.
+QSGNode* updateSoftwareShapeNode(QQuickItem* item, QSGNode* oldNode, const SoftwareShape& shape);
+
+// Counters of the shape images cache since the last clear, used by the unit tests.
+struct SoftwareShapeCacheStatistics
+{
+    int hits;
+    int misses;
+};
+UBUNTUTOOLKIT_EXPORT SoftwareShapeCacheStatistics softwareShapeCacheStatistics();
+UBUNTUTOOLKIT_EXPORT void clearSoftwareShapeCache();
+
+UT_NAMESPACE_END
+
+#endif  // SOFTWARESHAPES_P_H
@@ -402,45 +402,25 @@ int main(int argc, char* argv[])
     cppOut << "};\n\n";
     painter.end();
 
-    // Create the mipmap textures and write them to the C++ file.
+    // Create the base level of the mipmap textures and write them to the C++ file. The other
+    // levels are generated at runtime by the UbuntuShape.
     cppOut << "const int shapeTextureMipmapWidth = " << widthMipmap << ";\n"
            << "const int shapeTextureMipmapHeight = " << heightMipmap << ";\n"
            << "const int shapeTextureMipmapCount = " << mipmapCount << ";\n"
-           << "static const int shapeTextureMipmapOffset[" << mipmapCount << "] = {\n"
-           << "    0";
-    int size = 0, i = 0;
-    for (int i = 0; i < mipmapCount-1; i++) {
-        size += (widthMipmap >> i) * (heightMipmap >> i) * 4;
-        cppOut << ", " << size;
-    }
-    size += (widthMipmap >> (mipmapCount-1)) * (heightMipmap >> (mipmapCount-1)) * 4;
-    cppOut << "\n};\n";
-    cppOut << "static const unsigned char shapeTextureMipmapData[" << textureCount
-           <<   "][" << size + 1 << "] = {\n";
-    for (int i = 0; i < mipmapCount; i++) {
-        const int width = widthMipmap >> i;
-        const int height = heightMipmap >> i;
-        QImage shapeMipmap(reinterpret_cast<uchar*>(renderBuffer), width, height,
-                           width * 4, QImage::Format_ARGB32_Premultiplied);
-        painter.begin(&shapeMipmap);
-        createTexture1(&svg, &painter, textureDataMipmap, width, height, false);
-        cppOut << "    // Mipmap level " << i << ".\n";
-        dumpTexture(cppOut, textureDataMipmap, width * height);
-        painter.end();
-    }
+           << "static const unsigned char shapeTextureMipmapData[" << textureCount
+           <<   "][" << sizeMipmap * 4 + 1 << "] = {\n";
+    QImage shapeMipmap(reinterpret_cast<uchar*>(renderBuffer), widthMipmap, heightMipmap,
+                       widthMipmap * 4, QImage::Format_ARGB32_Premultiplied);
+    painter.begin(&shapeMipmap);
+    createTexture1(&svg, &painter, textureDataMipmap, widthMipmap, heightMipmap, false);
+    cppOut << "    // Mipmap level 0.\n";
+    dumpTexture(cppOut, textureDataMipmap, sizeMipmap);
     cppOut << "    ,\n";
-    for (int i = 0; i < mipmapCount; i++) {
-        const int width = widthMipmap >> i;
-        const int height = heightMipmap >> i;
-        QImage shapeMipmap(reinterpret_cast<uchar*>(renderBuffer), width, height,
-                           width * 4, QImage::Format_ARGB32_Premultiplied);
-        painter.begin(&shapeMipmap);
-        createTexture2(&svg, &painter, textureDataMipmap, width, height, false);
-        cppOut << "    // Mipmap level " << i << ".\n";
-        dumpTexture(cppOut, textureDataMipmap, width * height);
-        painter.end();
-    }
+    createTexture2(&svg, &painter, textureDataMipmap, widthMipmap, heightMipmap, false);
+    cppOut << "    // Mipmap level 0.\n";
+    dumpTexture(cppOut, textureDataMipmap, sizeMipmap);
     cppOut << "};\n";
+    painter.end();
 
     return 0;
 }
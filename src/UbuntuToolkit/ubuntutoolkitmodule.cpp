@@ -18,6 +18,7 @@
 
 #include "ubuntutoolkitmodule.h"
 
+#include <signal.h>
 #include <sys/types.h>
 #include <unistd.h>
 
@@ -28,6 +29,8 @@
 #include <QtQml/QQmlExtensionPlugin>
 #include <QtQuick/private/qquickimagebase_p.h>
 #include <QtDBus/QDBusConnection>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QThread>
 #include <QtGui/QGuiApplication>
 #include <QtGui/QScreen>
 #include <UbuntuMetrics/applicationmonitor.h>
@@ -106,6 +109,14 @@ UT_NAMESPACE_BEGIN
 static const QString notInstantiatable = QStringLiteral("Not instantiatable");
 static const char engineProperty[] = "__ubuntu_toolkit_plugin_data";
 
+// Types can be registered from the QML type loader thread, the application
+// monitor must be created on the GUI thread though.
+static bool isGuiThread()
+{
+    QCoreApplication *application = QCoreApplication::instance();
+    return application && QThread::currentThread() == application->thread();
+}
+
 /******************************************************************************
  * UbuntuToolkitModule
  */
@@ -147,6 +158,8 @@ void UbuntuToolkitModule::setWindowContextProperty(QWindow* focusWindow)
 
 void UbuntuToolkitModule::initializeContextProperties(QQmlEngine *engine)
 {
+    UMScopedTrace trace(traceId(), "InitializeContextProperties");
+
     UCUnits::instance(engine);
     QuickUtils::instance(engine);
     UbuntuI18n::instance(engine);
@@ -200,6 +213,14 @@ void UbuntuToolkitModule::initializeContextProperties(QQmlEngine *engine)
 
 void UbuntuToolkitModule::registerTypesToVersion(const char *uri, int major, int minor)
 {
+    QScopedPointer<UMScopedTrace> trace;
+    if (isGuiThread()) {
+        char traceName[32];
+        const int traceNameSize =
+            qsnprintf(traceName, sizeof(traceName), "RegisterTypes %d.%d", major, minor) + 1;
+        trace.reset(new UMScopedTrace(traceId(), traceName, traceNameSize));
+    }
+
     qmlRegisterType<UCAction>(uri, major, minor, "Action");
     qmlRegisterType<UCActionContext>(uri, major, minor, "ActionContext");
     qmlRegisterUncreatableType<UCApplication>(
@@ -236,56 +257,24 @@ void UbuntuToolkitModule::registerTypesToVersion(const char *uri, int major, int
 }
 
 /*
- * public API
+ * Application monitoring, configured through the environment. Done at plugin
+ * registration so that the start up phases can be traced, see
+ * UMApplicationMonitor::beginSpan().
  */
-UbuntuToolkitModule::UbuntuToolkitModule(QObject *parent)
-    : QObject(parent)
+quint32 UbuntuToolkitModule::traceId()
 {
+    static const quint32 id = UMApplicationMonitor::instance()->registerGenericEvent();
+    return id;
 }
 
-QUrl UbuntuToolkitModule::baseUrl(QQmlEngine *engine)
+void UbuntuToolkitModule::initializeMetrics()
 {
-    if (!engine) {
-        return QUrl();
+    static bool initialized = false;
+    if (initialized) {
+        return;
     }
-    UbuntuToolkitModule *data = engine->property(engineProperty).value<UbuntuToolkitModule*>();
-    return !data ? QUrl() : data->m_baseUrl;
-}
+    initialized = true;
 
-void UbuntuToolkitModule::initializeModule(QQmlEngine *engine, const QUrl &pluginBaseUrl)
-{
-    UbuntuToolkitModule *module = create(engine, pluginBaseUrl);
-
-    // Register private types.
-    const char *privateUri = "Ubuntu.Components.Private";
-    qmlRegisterType<UCFrame>(privateUri, 1, 3, "Frame");
-    qmlRegisterType<UCPageWrapper>(privateUri, 1, 3, "PageWrapper");
-    qmlRegisterType<UCAppHeaderBase>(privateUri, 1, 3, "AppHeaderBase");
-    qmlRegisterType<Tree>(privateUri, 1, 3, "Tree");
-
-    //FIXME: move to a more generic location, i.e StyledItem or QuickUtils
-    qmlRegisterSimpleSingletonType<UCScrollbarUtils>(privateUri, 1, 3, "PrivateScrollbarUtils");
-
-    // allocate all context property objects prior we register them
-    initializeContextProperties(engine);
-
-    HapticsProxy::instance(engine);
-
-    engine->addImageProvider(QLatin1String("scaling"), new UCScalingImageProvider);
-
-    // register icon provider
-    engine->addImageProvider(QLatin1String("theme"), new UnityThemeIconProvider);
-
-    // Necessary for Screen.orientation (from import QtQuick.Window 2.0) to work
-    QGuiApplication::primaryScreen()->setOrientationUpdateMask( Qt::ScreenOrientations(
-            Qt::PortraitOrientation |
-            Qt::LandscapeOrientation |
-            Qt::InvertedPortraitOrientation |
-            Qt::InvertedLandscapeOrientation));
-
-    module->registerWindowContextProperty();
-
-    // Application monitoring.
     UMApplicationMonitor* applicationMonitor = UMApplicationMonitor::instance();
     const QString metricsLoggingFilter =
         QString::fromLocal8Bit(qgetenv("UC_METRICS_LOGGING_FILTER"));
@@ -306,6 +295,12 @@ void UbuntuToolkitModule::initializeModule(QQmlEngine *engine, const QUrl &plugi
                 filter |= UMApplicationMonitor::FrameEvent;
             } else if (filterList[i] == QStringLiteral("generic")) {
                 filter |= UMApplicationMonitor::GenericEvent;
+            } else if (filterList[i] == QStringLiteral("summary")) {
+                filter |= UMApplicationMonitor::FrameSummaryEvent;
+            } else if (filterList[i] == QStringLiteral("span")) {
+                filter |= UMApplicationMonitor::SpanEvent;
+            } else if (filterList[i] == QStringLiteral("longframe")) {
+                filter |= UMApplicationMonitor::LongFrameEvent;
             }
         }
         applicationMonitor->setLoggingFilter(filter);
@@ -319,6 +314,17 @@ void UbuntuToolkitModule::initializeModule(QQmlEngine *engine, const QUrl &plugi
         } else if (metricsLogging == "lttng") {
             logger = new UMLTTNGLogger();
 #endif  // defined(Q_OS_LINUX)
+        } else if (metricsLogging.startsWith("binary:")) {
+            logger = new UMBinaryLogger(
+                QString::fromLocal8Bit(metricsLogging.mid(sizeof("binary:") - 1)));
+        } else if (metricsLogging.startsWith("trace:")) {
+            logger = new UMTraceEventLogger(
+                QString::fromLocal8Bit(metricsLogging.mid(sizeof("trace:") - 1)));
+        } else if (metricsLogging == "socket") {
+            logger = new UMSocketLogger();
+        } else if (metricsLogging.startsWith("socket:")) {
+            logger = new UMSocketLogger(
+                QString::fromLocal8Bit(metricsLogging.mid(sizeof("socket:") - 1)));
         } else {
             logger = new UMFileLogger(QString::fromLocal8Bit(metricsLogging));
         }
@@ -329,9 +335,79 @@ void UbuntuToolkitModule::initializeModule(QQmlEngine *engine, const QUrl &plugi
             delete logger;
         }
     }
+    const QByteArray metricsFrameSummary = qgetenv("UC_METRICS_FRAME_SUMMARY");
+    if (!metricsFrameSummary.isEmpty()) {
+        applicationMonitor->setUpdateInterval(UMEvent::FrameSummary, metricsFrameSummary.toInt());
+    }
+    const QByteArray metricsLongFrameBudget = qgetenv("UC_METRICS_LONG_FRAME_BUDGET");
+    if (!metricsLongFrameBudget.isEmpty()) {
+        applicationMonitor->setLongFrameBudget(metricsLongFrameBudget.toInt());
+    }
+    // The flight recorder keeps the last 10 seconds of events in memory, dumped
+    // on SIGUSR2 or when the performance monitor warns.
+    const QByteArray metricsFlightRecorder = qgetenv("UC_METRICS_FLIGHT_RECORDER");
+    if (!metricsFlightRecorder.isEmpty()) {
+        applicationMonitor->setFlightRecorderFile(QString::fromLocal8Bit(metricsFlightRecorder));
+        applicationMonitor->setFlightRecorderSignal(SIGUSR2);
+        applicationMonitor->setFlightRecorder(10000);
+    }
     if (qEnvironmentVariableIsSet("UC_METRICS_OVERLAY")) {
         applicationMonitor->setOverlay(true);
     }
+}
+
+/*
+ * public API
+ */
+UbuntuToolkitModule::UbuntuToolkitModule(QObject *parent)
+    : QObject(parent)
+{
+}
+
+QUrl UbuntuToolkitModule::baseUrl(QQmlEngine *engine)
+{
+    if (!engine) {
+        return QUrl();
+    }
+    UbuntuToolkitModule *data = engine->property(engineProperty).value<UbuntuToolkitModule*>();
+    return !data ? QUrl() : data->m_baseUrl;
+}
+
+void UbuntuToolkitModule::initializeModule(QQmlEngine *engine, const QUrl &pluginBaseUrl)
+{
+    initializeMetrics();
+    UMScopedTrace trace(traceId(), "PluginInitializeEngine");
+
+    UbuntuToolkitModule *module = create(engine, pluginBaseUrl);
+
+    // Register private types.
+    const char *privateUri = "Ubuntu.Components.Private";
+    qmlRegisterType<UCFrame>(privateUri, 1, 3, "Frame");
+    qmlRegisterType<UCPageWrapper>(privateUri, 1, 3, "PageWrapper");
+    qmlRegisterType<UCAppHeaderBase>(privateUri, 1, 3, "AppHeaderBase");
+    qmlRegisterType<Tree>(privateUri, 1, 3, "Tree");
+
+    //FIXME: move to a more generic location, i.e StyledItem or QuickUtils
+    qmlRegisterSimpleSingletonType<UCScrollbarUtils>(privateUri, 1, 3, "PrivateScrollbarUtils");
+
+    // allocate all context property objects prior we register them
+    initializeContextProperties(engine);
+
+    HapticsProxy::instance(engine);
+
+    engine->addImageProvider(QLatin1String("scaling"), new UCScalingImageProvider);
+
+    // register icon provider
+    engine->addImageProvider(QLatin1String("theme"), new UnityThemeIconProvider);
+
+    // Necessary for Screen.orientation (from import QtQuick.Window 2.0) to work
+    QGuiApplication::primaryScreen()->setOrientationUpdateMask( Qt::ScreenOrientations(
+            Qt::PortraitOrientation |
+            Qt::LandscapeOrientation |
+            Qt::InvertedPortraitOrientation |
+            Qt::InvertedLandscapeOrientation));
+
+    module->registerWindowContextProperty();
 
     // register performance monitor
     engine->rootContext()->setContextProperty(
@@ -340,6 +416,12 @@ void UbuntuToolkitModule::initializeModule(QQmlEngine *engine, const QUrl &plugi
 
 void UbuntuToolkitModule::defineModule()
 {
+    QScopedPointer<UMScopedTrace> trace;
+    if (isGuiThread()) {
+        initializeMetrics();
+        trace.reset(new UMScopedTrace(traceId(), "PluginRegisterTypes"));
+    }
+
     const char *uri = "Ubuntu.Components";
     // register 0.1 for backward compatibility
     registerTypesToVersion(uri, 0, 1);
@@ -60,12 +60,16 @@ public:
 
     // use this API only in tests!
     static void initializeContextProperties(QQmlEngine*);
+
+    // generic event id of the toolkit traces, see UMScopedTrace
+    static quint32 traceId();
 private:
     explicit UbuntuToolkitModule(QObject *parent = Q_NULLPTR);
     static UbuntuToolkitModule* create(QQmlEngine *engine, const QUrl &baseUrl);
     void registerWindowContextProperty();
     Q_SLOT void setWindowContextProperty(QWindow* focusWindow);
     static void registerTypesToVersion(const char *uri, int major, int minor);
+    static void initializeMetrics();
 
     QUrl m_baseUrl;
 };
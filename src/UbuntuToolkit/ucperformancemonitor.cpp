@@ -19,6 +19,7 @@
 #include "ucperformancemonitor_p.h"
 
 #include <QtGui/QGuiApplication>
+#include <UbuntuMetrics/applicationmonitor.h>
 
 Q_LOGGING_CATEGORY(ucPerformance, "[PERFORMANCE]")
 
@@ -127,6 +128,8 @@ void UCPerformanceMonitor::stopTimer()
     const int totalTimeInMs = m_timer.elapsed();
     m_timer.invalidate();
 
+    const int warningCount = m_warningCount;
+
     if (totalTimeInMs >= singleFrameThreshold) {
         qCWarning(ucPerformance, "Last frame took %d ms to render.", totalTimeInMs);
         m_warningCount++;
@@ -145,6 +148,11 @@ void UCPerformanceMonitor::stopTimer()
         m_framesAboveThreshold = 0;
     }
 
+    // Called from the render thread, the dump is requested from the GUI thread.
+    if (m_warningCount > warningCount) {
+        QMetaObject::invokeMethod(this, "dumpFlightRecorder", Qt::QueuedConnection);
+    }
+
     if (m_warningCount >= warningCountThreshold && warningCountThreshold != -1) {
         qCWarning(ucPerformance, "Too many warnings were given. Performance monitoring stops.");
         connectToWindow(NULL);
@@ -156,4 +164,10 @@ void UCPerformanceMonitor::windowDestroyed()
     connectToWindow(NULL);
 }
 
+// the file is written by the logging thread, throttled by the application monitor
+void UCPerformanceMonitor::dumpFlightRecorder()
+{
+    UMApplicationMonitor::instance()->requestFlightRecorderDump();
+}
+
 UT_NAMESPACE_END
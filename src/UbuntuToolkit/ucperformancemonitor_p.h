@@ -43,6 +43,7 @@ private Q_SLOTS:
     void startTimer();
     void stopTimer();
     void windowDestroyed();
+    void dumpFlightRecorder();
 
 private:
     QQuickWindow* findQQuickWindow();
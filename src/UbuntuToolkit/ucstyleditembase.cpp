@@ -18,12 +18,20 @@
 
 #include "ucstyleditembase_p_p.h"
 
+#include <QtCore/QQueue>
+#include <QtCore/QScopedPointer>
+#include <QtCore/QSet>
+#include <QtCore/QTimer>
 #include <QtQml/QQmlEngine>
+#include <QtQuick/QQuickWindow>
 #include <QtQuick/private/qquickanchors_p.h>
+#include <UbuntuMetrics/applicationmonitor.h>
 
+#include "asyncloader_p.h"
 #include "ucstylehints_p.h"
 #include "uctheme_p.h"
 #include "ucthemingextension_p.h"
+#include "ubuntutoolkitmodule.h"
 
 UT_NAMESPACE_BEGIN
 
@@ -31,11 +39,14 @@ UCStyledItemBasePrivate::UCStyledItemBasePrivate()
     : oldParentItem(Q_NULLPTR)
     , styleComponent(Q_NULLPTR)
     , styleItem(Q_NULLPTR)
+    , styleLoader(Q_NULLPTR)
     , styleVersion(0)
     , keyNavigationFocus(false)
     , activeFocusOnPress(false)
     , wasStyleLoaded(false)
     , isFocusScope(true)
+    , incubateStyle(false)
+    , styleIncubationQueued(false)
 {
 }
 
@@ -94,6 +105,9 @@ void UCStyledItemBase::setActiveFocusOnTab2(bool v)
 
 UCStyledItemBasePrivate::~UCStyledItemBasePrivate()
 {
+    cancelStyleIncubation();
+    delete styleLoader;
+    releaseSharedStyleComponent();
 }
 
 void UCStyledItemBasePrivate::init()
@@ -343,6 +357,9 @@ void UCStyledItemBasePrivate::setStyleName(const QString &name)
 // connections and destroys the style component
 void UCStyledItemBasePrivate::preStyleChanged()
 {
+    cancelStyleIncubation();
+    // the shared component is kept alive as long as the style item is
+    releaseSharedStyleComponent();
     if (styleItem) {
         // make sure the context holder is reset too
         styleItemContext.clear();
@@ -356,25 +373,232 @@ void UCStyledItemBasePrivate::preStyleChanged()
     }
 }
 
-// loads the style animated or not, depending on the loading time
-// returns true on successful style loading
-bool UCStyledItemBasePrivate::loadStyleItem(bool animated)
+// releases the style component shared with the other items of the theme
+void UCStyledItemBasePrivate::releaseSharedStyleComponent()
 {
-    if (styleItem || (!styleComponent && styleDocument.isEmpty()) || !componentComplete) {
-        // the style loading is delayed
+    if (sharedStyleComponent) {
+        UCTheme::releaseStyleComponent(sharedStyleComponent);
+        sharedStyleComponent.clear();
+    }
+}
+
+/*
+ * Asynchronous style loading, enabled with the UC_ASYNC_STYLES environment
+ * variable. The first style instance of the items completed is incubated
+ * through the incubation controller of the engine, the one of the QtQuick
+ * window, which only spends the time left in each frame. Items have no style
+ * instance until their style is ready. Incubations run one at a time so that
+ * the items shown in their window are styled before the others.
+ *
+ * Most components use their style instance as soon as they're completed, only
+ * the theme styles of the components audited to cope with a null style
+ * instance are incubated.
+ */
+static bool asyncStylesEnabled()
+{
+    static bool enabled = qEnvironmentVariableIsSet("UC_ASYNC_STYLES");
+    return enabled;
+}
+
+static bool canIncubateStyle(const QString &styleDocument)
+{
+    static const QSet<QString> auditedStyles = {
+        QStringLiteral("ActivityIndicatorStyle"),
+        QStringLiteral("CheckBoxStyle"),
+        QStringLiteral("ProgressBarStyle"),
+        QStringLiteral("SectionsStyle"),
+        QStringLiteral("SliderStyle"),
+        QStringLiteral("SwitchStyle")
+    };
+    return auditedStyles.contains(styleDocument);
+}
+
+class UCStyleIncubationQueue
+{
+public:
+    static UCStyleIncubationQueue *instance()
+    {
+        static UCStyleIncubationQueue queue;
+        return &queue;
+    }
+
+    // items are completed before they are in their window, they are sorted
+    // once the event loop runs
+    void enqueue(UCStyledItemBase *item)
+    {
+        m_queued.enqueue(item);
+        scheduleNext();
+    }
+    void remove(UCStyledItemBase *item);
+    void finished(UCStyledItemBase *item)
+    {
+        if (m_running == item) {
+            m_running.clear();
+            startNext();
+        }
+    }
+
+private:
+    UCStyleIncubationQueue()
+        : m_scheduled(false)
+    {}
+
+    static bool isQueued(UCStyledItemBase *item);
+    static bool isOnScreen(UCStyledItemBase *item);
+    void scheduleNext();
+    void startNext();
+
+    QQueue< QPointer<UCStyledItemBase> > m_queued;
+    QQueue< QPointer<UCStyledItemBase> > m_onScreen;
+    QQueue< QPointer<UCStyledItemBase> > m_offScreen;
+    QPointer<UCStyledItemBase> m_running;
+    bool m_scheduled;
+};
+
+// also called from the item destructor, pointers are only compared; the queued
+// entries of the items cancelled are skipped when reached
+void UCStyleIncubationQueue::remove(UCStyledItemBase *item)
+{
+    if (!m_running || m_running.data() == item) {
+        m_running.clear();
+        // don't start incubations from item destructors
+        scheduleNext();
+    }
+}
+
+void UCStyleIncubationQueue::scheduleNext()
+{
+    if (m_scheduled) {
+        return;
+    }
+    m_scheduled = true;
+    QTimer::singleShot(0, [] {
+        UCStyleIncubationQueue *queue = UCStyleIncubationQueue::instance();
+        queue->m_scheduled = false;
+        queue->startNext();
+    });
+}
+
+// deleted and cancelled items may still have entries in the queues
+bool UCStyleIncubationQueue::isQueued(UCStyledItemBase *item)
+{
+    return item && UCStyledItemBasePrivate::get(item)->styleIncubationQueued;
+}
+
+// unstyled items usually have no size yet, their position is used then
+bool UCStyleIncubationQueue::isOnScreen(UCStyledItemBase *item)
+{
+    QQuickWindow *window = item->window();
+    if (!window || !window->isVisible() || !item->isVisible()) {
         return false;
     }
+    const QRectF rect = item->mapRectToScene(
+        QRectF(0.0, 0.0, qMax(item->width(), 1.0), qMax(item->height(), 1.0)));
+    return rect.intersects(QRectF(0.0, 0.0, window->width(), window->height()));
+}
+
+void UCStyleIncubationQueue::startNext()
+{
+    // the visibility of each item is only evaluated once, on screen items are
+    // then incubated first, in completion order
+    while (!m_queued.isEmpty()) {
+        UCStyledItemBase *item = m_queued.dequeue();
+        if (isQueued(item)) {
+            (isOnScreen(item) ? m_onScreen : m_offScreen).enqueue(item);
+        }
+    }
+    while (!m_running) {
+        QQueue< QPointer<UCStyledItemBase> > &queue = m_onScreen.isEmpty() ? m_offScreen : m_onScreen;
+        if (queue.isEmpty()) {
+            break;
+        }
+        UCStyledItemBase *item = queue.dequeue();
+        if (isQueued(item)) {
+            m_running = item;
+            UCStyledItemBasePrivate::get(item)->incubateStyleItem();
+        }
+    }
+}
+
+// starts the incubation of the queued style, always loaded not animated
+void UCStyledItemBasePrivate::incubateStyleItem()
+{
     Q_Q(UCStyledItemBase);
-    // either styleComponent or styleName is valid
-    QQmlComponent *component = styleComponent;
-    UCTheme *theme = q->getTheme();
-    if (!component && theme) {
-        component = theme->createStyleComponent(styleDocument + ".qml", q, styleVersion);
+    styleIncubationQueued = false;
+    QQmlComponent *component = styleComponent ? styleComponent : sharedStyleComponent.data();
+    if (!component || !createStyleContext(component, false)) {
+        UCStyleIncubationQueue::instance()->finished(q);
+        return;
     }
-    if (!component) {
-        return false;
+    if (!styleLoader) {
+        styleLoader = new AsyncLoader;
+        QObject::connect(styleLoader, &AsyncLoader::loadingStatus,
+                         q, [this](AsyncLoader::LoadingStatus status, QObject *object) {
+            _q_styleLoadingStatus(status, object);
+        });
     }
-    // create context
+    styleLoader->load(component, styleItemContext);
+}
+
+void UCStyledItemBasePrivate::_q_styleLoadingStatus(AsyncLoader::LoadingStatus status, QObject *object)
+{
+    Q_Q(UCStyledItemBase);
+    switch (status) {
+    case AsyncLoader::Initializing:
+        // link context to the style object to delete them together, the object
+        // is only parented once ready, the loader deletes it when reset
+        QQml_setParent_noEvent(styleItemContext, object);
+        break;
+    case AsyncLoader::Ready:
+        styleItem = attachStyleItem(object);
+        if (styleItem) {
+            styleItemCreated(false);
+        } else {
+            delete object;
+        }
+        UCStyleIncubationQueue::instance()->finished(q);
+        break;
+    case AsyncLoader::Error:
+        // the context is left alone if the incubated object owns it
+        if (styleItemContext && !styleItemContext->parent()) {
+            delete styleItemContext;
+        }
+        UCStyleIncubationQueue::instance()->finished(q);
+        break;
+    default:
+        break;
+    }
+}
+
+// tells whether the style is being incubated or waits for its incubation
+bool UCStyledItemBasePrivate::isStyleIncubating() const
+{
+    return styleIncubationQueued
+        || (styleLoader && styleLoader->status() > AsyncLoader::Null
+            && styleLoader->status() < AsyncLoader::Ready);
+}
+
+// aborts the style incubation, if any
+void UCStyledItemBasePrivate::cancelStyleIncubation()
+{
+    if (!isStyleIncubating()) {
+        return;
+    }
+    UCStyleIncubationQueue::instance()->remove(static_cast<UCStyledItemBase*>(q_ptr));
+    styleIncubationQueued = false;
+    if (styleLoader) {
+        styleLoader->reset();
+    }
+    // the context is left alone if the incubated object owns it
+    if (styleItemContext && !styleItemContext->parent()) {
+        delete styleItemContext;
+    }
+}
+
+// creates the context the style item is loaded with
+bool UCStyledItemBasePrivate::createStyleContext(QQmlComponent *component, bool animated)
+{
+    Q_Q(UCStyledItemBase);
     // use creation context as parent to create the context we load the style item with
     QQmlContext *creationContext = component->creationContext();
     if (!creationContext) {
@@ -388,33 +612,35 @@ bool UCStyledItemBasePrivate::loadStyleItem(bool animated)
     styleItemContext->setContextObject(q);
     styleItemContext->setContextProperty(QStringLiteral("styledItem"), q);
     styleItemContext->setContextProperty(QStringLiteral("animated"), animated);
-    QObject *object = component->beginCreate(styleItemContext);
-    if (!object) {
-        delete styleItemContext;
-        return false;
-    }
+    return true;
+}
+
+// links the style object to the styled item, returns the style item or NULL
+// if the object is not an item
+QQuickItem *UCStyledItemBasePrivate::attachStyleItem(QObject *object)
+{
+    Q_Q(UCStyledItemBase);
     // link context to the style item to delete them together
     QQml_setParent_noEvent(styleItemContext, object);
-    styleItem = qobject_cast<::QQuickItem*>(object);
-    if (styleItem) {
-        QQml_setParent_noEvent(styleItem, q);
-        styleItem->setParentItem(q);
+    QQuickItem *item = qobject_cast<::QQuickItem*>(object);
+    if (item) {
+        QQml_setParent_noEvent(item, q);
+        item->setParentItem(q);
         // put the style behind evenrything
-        styleItem->setZ(-1);
+        item->setZ(-1);
         // anchor fill to the styled component
-        QQuickAnchors *styleAnchors = QQuickItemPrivate::get(styleItem)->anchors();
+        QQuickAnchors *styleAnchors = QQuickItemPrivate::get(item)->anchors();
         styleAnchors->setFill(q);
-    } else {
-        delete object;
-    }
-    component->completeCreate();
-    // delete temporary component
-    if (!styleComponent) {
-        delete component;
     }
+    return item;
+}
 
+// completes the style item set up once created
+void UCStyledItemBasePrivate::styleItemCreated(bool animated)
+{
+    Q_Q(UCStyledItemBase);
     // make sure we reset the animated property to true
-    if (!animated) {
+    if (!animated && styleItemContext) {
         styleItemContext->setContextProperty(QStringLiteral("animated"), true);
     }
 
@@ -422,6 +648,61 @@ bool UCStyledItemBasePrivate::loadStyleItem(bool animated)
     _q_styleResized();
     connectStyleSizeChanges(true);
     Q_EMIT q->styleInstanceChanged();
+}
+
+// loads the style animated or not, depending on the loading time
+// returns true on successful style loading
+bool UCStyledItemBasePrivate::loadStyleItem(bool animated)
+{
+    if (styleItem || isStyleIncubating()
+            || (!styleComponent && styleDocument.isEmpty()) || !componentComplete) {
+        // the style loading is delayed
+        return false;
+    }
+    Q_Q(UCStyledItemBase);
+    // trace the first style creation, which loads the theme and the style
+    // modules, as part of the start up phases
+    static bool firstStyleItem = true;
+    QScopedPointer<UMScopedTrace> trace(firstStyleItem ?
+        new UMScopedTrace(UbuntuToolkitModule::traceId(), "FirstStyleCreation") : Q_NULLPTR);
+    firstStyleItem = false;
+    // either styleComponent or styleName is valid
+    QQmlComponent *component = styleComponent;
+    UCTheme *theme = q->getTheme();
+    if (!component && theme) {
+        // the theme shares the component with the other items using the same style
+        releaseSharedStyleComponent();
+        component = theme->acquireStyleComponent(styleDocument + ".qml", q, styleVersion);
+        sharedStyleComponent = component;
+    }
+    if (!component) {
+        return false;
+    }
+    // incubate if the engine's incubation controller can, otherwise the
+    // incubation would never progress
+    QQmlEngine *engine = qmlEngine(q);
+    if (incubateStyle && engine && engine->incubationController()) {
+        styleIncubationQueued = true;
+        UCStyleIncubationQueue::instance()->enqueue(q);
+        return false;
+    }
+    // create context
+    if (!createStyleContext(component, animated)) {
+        releaseSharedStyleComponent();
+        return false;
+    }
+    QObject *object = component->beginCreate(styleItemContext);
+    if (!object) {
+        delete styleItemContext;
+        releaseSharedStyleComponent();
+        return false;
+    }
+    styleItem = attachStyleItem(object);
+    if (!styleItem) {
+        delete object;
+    }
+    component->completeCreate();
+    styleItemCreated(animated);
     return true;
 }
 
@@ -538,7 +819,10 @@ void UCStyledItemBasePrivate::completeComponentInitialization()
     // no animation at this time
     // prepare style context if not been done yet
     postStyleChanged();
+    // the first style instance can be incubated, not to delay the first frames
+    incubateStyle = asyncStylesEnabled() && !styleComponent && canIncubateStyle(styleDocument);
     loadStyleItem(false);
+    incubateStyle = false;
 }
 
 void UCStyledItemBase::classBegin()
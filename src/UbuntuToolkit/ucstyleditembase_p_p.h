@@ -23,6 +23,7 @@
 
 #include <QtQuick/private/qquickitem_p.h>
 
+#include <UbuntuToolkit/private/asyncloader_p.h>
 #include <UbuntuToolkit/private/ucthemingextension_p.h>
 #include <UbuntuToolkit/private/ucimportversionchecker_p.h>
 
@@ -61,6 +62,13 @@ public:
     virtual void preStyleChanged();
     virtual void postStyleChanged() {}
     virtual bool loadStyleItem(bool animated = true);
+    bool createStyleContext(QQmlComponent *component, bool animated);
+    QQuickItem *attachStyleItem(QObject *object);
+    void styleItemCreated(bool animated);
+    void incubateStyleItem();
+    void _q_styleLoadingStatus(AsyncLoader::LoadingStatus status, QObject *object);
+    bool isStyleIncubating() const;
+    void cancelStyleIncubation();
     virtual void completeComponentInitialization();
 
     // from UCImportVersionChecker
@@ -72,16 +80,23 @@ public:
     QString styleDocument;
     QQuickItem *oldParentItem;
     QQmlComponent *styleComponent;
+    // style component acquired from the theme, when the style is set by styleName
+    QPointer<QQmlComponent> sharedStyleComponent;
     QQuickItem *styleItem;
+    // incubates the style, see UC_ASYNC_STYLES
+    AsyncLoader *styleLoader;
     quint16 styleVersion;
     bool keyNavigationFocus:1;
     bool activeFocusOnPress:1;
     bool wasStyleLoaded:1;
     bool isFocusScope:1;
+    bool incubateStyle:1;
+    bool styleIncubationQueued:1;
 
 protected:
 
     void connectStyleSizeChanges(bool attach);
+    void releaseSharedStyleComponent();
 };
 
 UT_NAMESPACE_END
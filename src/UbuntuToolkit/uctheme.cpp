@@ -19,9 +19,13 @@
 
 #include "uctheme_p.h"
 
+#include <QtCore/QDateTime>
 #include <QtCore/QDir>
 #include <QtCore/QFile>
+#include <QtCore/QFileInfo>
 #include <QtCore/QLibraryInfo>
+#include <QtCore/QMutex>
+#include <QtCore/QRegularExpression>
 #include <QtCore/QStandardPaths>
 #include <QtCore/QTextStream>
 #include <QtGui/QFont>
@@ -34,12 +38,14 @@
 #include <QtQml/private/qqmlabstractbinding_p.h>
 #define foreach Q_FOREACH
 #include <QtQml/private/qqmlbinding_p.h>
+#include <UbuntuMetrics/applicationmonitor.h>
 #undef foreach
 
 #include "i18n_p.h"
 #include "listener_p.h"
 #include "quickutils_p.h"
 #include "ubuntutoolkitglobal.h"
+#include "ubuntutoolkitmodule.h"
 #include "ucfontutils_p.h"
 #include "ucstyleditembase_p_p.h"
 #include "ucthemingextension_p.h"
@@ -218,6 +224,59 @@ UCTheme::ThemeRecord pathFromThemeName(QString themeName)
     return record;
 }
 
+// lists the files a style lookup can resolve in a theme folder, the non-versioned styles at
+// the root and the versioned ones in the "major.minor" folders, relative to the theme folder.
+// Symbolic links to folders aren't followed. Theme folders are scanned once and shared by all
+// the themes, a listing is refreshed when the theme paths are updated if the theme folder or
+// one of its version folders has been modified since.
+static QSet<QString> themeFiles(const UCTheme::ThemeRecord& themePath)
+{
+    struct Listing {
+        QDateTime lastModified;
+        QHash<QString, QDateTime> versionsLastModified;
+        QSet<QString> files;
+    };
+    static QHash<QString, Listing> cache;
+    static QMutex cacheMutex;
+    static const QRegularExpression versionFolder(QStringLiteral("^\\d+\\.\\d+$"));
+
+    const QString path = themePath.path.toLocalFile();
+    const QDir folder(path);
+    const QDateTime lastModified = QFileInfo(path).lastModified();
+    QMutexLocker locker(&cacheMutex);
+    auto cached = cache.constFind(path);
+    if (cached != cache.constEnd() && cached->lastModified == lastModified) {
+        bool upToDate = true;
+        for (auto version = cached->versionsLastModified.constBegin();
+             upToDate && version != cached->versionsLastModified.constEnd(); ++version) {
+            upToDate = QFileInfo(folder.filePath(version.key())).lastModified() == version.value();
+        }
+        if (upToDate) {
+            return cached->files;
+        }
+    }
+
+    // modification times are read before the entries, later changes are seen at next refresh
+    Listing listing;
+    listing.lastModified = lastModified;
+    Q_FOREACH(const QString &file, folder.entryList(QDir::Files)) {
+        listing.files.insert(file);
+    }
+    Q_FOREACH(const QString &version,
+              folder.entryList(QDir::Dirs | QDir::NoDotAndDotDot | QDir::NoSymLinks)) {
+        if (!versionFolder.match(version).hasMatch()) {
+            continue;
+        }
+        const QString versionPath = folder.filePath(version);
+        listing.versionsLastModified.insert(version, QFileInfo(versionPath).lastModified());
+        Q_FOREACH(const QString &file, QDir(versionPath).entryList(QDir::Files)) {
+            listing.files.insert(version + '/' + file);
+        }
+    }
+    cache.insert(path, listing);
+    return listing.files;
+}
+
 QString parentThemeName(const UCTheme::ThemeRecord& themePath)
 {
     QString parentTheme;
@@ -399,6 +458,7 @@ UCTheme::UCTheme(QObject *parent)
     : QObject(parent)
     , m_parentTheme(Q_NULLPTR)
     , m_palette(Q_NULLPTR)
+    , m_reloadPass(0)
     , m_completed(false)
 {
     init();
@@ -421,6 +481,8 @@ UCTheme *UCTheme::defaultTheme(QQmlEngine *engine)
 
 void UCTheme::setupDefault()
 {
+    UMScopedTrace trace(UbuntuToolkitModule::traceId(), "ThemeSetupDefault");
+
     // FIXME: move this into QPA
     // set the default font
     QFont defaultFont = QGuiApplication::font();
@@ -472,11 +534,13 @@ void UCTheme::_q_defaultThemeChanged()
 void UCTheme::updateThemePaths()
 {
     m_themePaths.clear();
+    m_styleUrls.clear();
 
     QString themeName = name();
     while (!themeName.isEmpty()) {
         ThemeRecord themePath = pathFromThemeName(themeName);
         if (themePath.isValid()) {
+            themePath.files = themeFiles(themePath);
             m_themePaths.append(themePath);
         }
         themeName = parentThemeName(themePath);
@@ -636,9 +700,23 @@ void UCTheme::resetPalette()
 
 QUrl UCTheme::styleUrl(const QString& styleName, quint16 version, bool *isFallback)
 {
+    // styles are resolved for every styled item created, remember the results
+    const QPair<QString, quint16> key(styleName, version);
+    auto record = m_styleUrls.constFind(key);
+    if (record == m_styleUrls.constEnd()) {
+        StyleUrlRecord newRecord;
+        newRecord.url = lookupStyleUrl(styleName, version, &newRecord.isFallback);
+        record = m_styleUrls.insert(key, newRecord);
+    }
     if (isFallback) {
-        (*isFallback) = false;
+        (*isFallback) = record->isFallback;
     }
+    return record->url;
+}
+
+QUrl UCTheme::lookupStyleUrl(const QString& styleName, quint16 version, bool *isFallback)
+{
+    (*isFallback) = false;
 
     // loop through the versions first, so we will look after the style in all
     // the parents, then fall back to the older version
@@ -664,9 +742,9 @@ QUrl UCTheme::styleUrl(const QString& styleName, quint16 version, bool *isFallba
 
             QString versionedName = QStringLiteral("%1.%2/%3").arg(major).arg(minor).arg(styleName);
             styleUrl = themePath.path.resolved(versionedName);
-            if (styleUrl.isValid() && QFile::exists(styleUrl.toLocalFile())) {
+            if (styleUrl.isValid() && themePath.files.contains(versionedName)) {
                 // set fallback warning if the theme is shared
-                if (isFallback && themePath.shared && (version != styleVersion)) {
+                if (themePath.shared && (version != styleVersion)) {
                     (*isFallback) = true;
                 }
                 return styleUrl;
@@ -675,7 +753,7 @@ QUrl UCTheme::styleUrl(const QString& styleName, quint16 version, bool *isFallba
             // if we don't get any style, get the non-versioned ones for non-shared and deprecated styles
             if (!themePath.shared || themePath.deprecated) {
                 styleUrl = themePath.path.resolved(styleName);
-                if (styleUrl.isValid() && QFile::exists(styleUrl.toLocalFile())) {
+                if (styleUrl.isValid() && themePath.files.contains(styleName)) {
                     return styleUrl;
                 }
             }
@@ -703,21 +781,44 @@ void UCTheme::createDefaultTheme(QQmlEngine* engine)
                      listener, &ContextPropertyChangeListener::updateContextProperty);
 }
 
-void UCTheme::attachItem(QQuickItem *item, bool attach)
+void UCTheme::attachItem(UCThemingExtension *extension, bool attach)
 {
     if (attach) {
-        m_attachedItems.append(item);
+        extension->themeIndex = m_attachedItems.count();
+        // items attached during a reload pass already use the reloaded theme
+        extension->reloadedTheme = this;
+        extension->reloadPass = m_reloadPass;
+        m_attachedItems.append(extension);
     } else {
-        m_attachedItems.removeOne(item);
+        // move the last item into the freed slot
+        const int index = extension->themeIndex;
+        Q_ASSERT(index >= 0 && index < m_attachedItems.count());
+        Q_ASSERT(m_attachedItems[index] == extension);
+        UCThemingExtension *last = m_attachedItems.takeLast();
+        if (last != extension) {
+            m_attachedItems[index] = last;
+            last->themeIndex = index;
+        }
+        extension->themeIndex = -1;
     }
 }
 
+// Reloading the styles creates and destroys themed items, which reorders the attached items,
+// so these are scanned until all of them were reloaded once in this pass.
 void UCTheme::updateThemedItems()
 {
-    for (int i = 0; i < m_attachedItems.count(); i++) {
-        UCThemingExtension *extension = qobject_cast<UCThemingExtension*>(m_attachedItems[i]);
-        if (extension) {
-            extension->itemThemeReloaded(this);
+    const uint pass = ++m_reloadPass;
+    bool reloaded = true;
+    while (reloaded) {
+        reloaded = false;
+        for (int i = 0; i < m_attachedItems.count(); i++) {
+            UCThemingExtension *extension = m_attachedItems[i];
+            if (extension->reloadedTheme != this || extension->reloadPass != pass) {
+                extension->reloadedTheme = this;
+                extension->reloadPass = pass;
+                extension->itemThemeReloaded(this);
+                reloaded = true;
+            }
         }
     }
 }
@@ -742,6 +843,28 @@ void UCTheme::checkMixedVersionImports(QQuickItem *item, quint16 version)
     previousVersion = version;
 }
 
+/*
+ * Resolves the URL of the style named \a styleName, warning on behalf of
+ * \a parent when the style falls back to another version or isn't found.
+ */
+QUrl UCTheme::resolveStyleUrl(const QString& styleName, QObject* parent, quint16 version)
+{
+    // make sure we have the paths
+    bool fallback = false;
+    QUrl url = styleUrl(styleName, version, &fallback);
+    if (url.isValid()) {
+        if (fallback) {
+            qmlWarning(parent) << QStringLiteral("Theme '%1' has no '%2' style for version %3.%4, fall back to version %5.%6.")
+                               .arg(name()).arg(styleName).arg(MAJOR_VERSION(version)).arg(MINOR_VERSION(version))
+                               .arg(MAJOR_VERSION(LATEST_UITK_VERSION)).arg(MINOR_VERSION(LATEST_UITK_VERSION));
+        }
+    } else {
+        qmlWarning(parent) <<
+           QStringLiteral("Warning: Style %1 not found in theme %2").arg(styleName).arg(name());
+    }
+    return url;
+}
+
 /*
  * Returns an instance of the style component named \a styleName and parented
  * to \a parent.
@@ -758,15 +881,8 @@ QQmlComponent* UCTheme::createStyleComponent(const QString& styleName, QObject*
             // so for now we return NULL
             return Q_NULLPTR;
         }
-        // make sure we have the paths
-        bool fallback = false;
-        QUrl url = styleUrl(styleName, version, &fallback);
+        QUrl url = resolveStyleUrl(styleName, parent, version);
         if (url.isValid()) {
-            if (fallback) {
-                qmlWarning(parent) << QStringLiteral("Theme '%1' has no '%2' style for version %3.%4, fall back to version %5.%6.")
-                                   .arg(name()).arg(styleName).arg(MAJOR_VERSION(version)).arg(MINOR_VERSION(version))
-                                   .arg(MAJOR_VERSION(LATEST_UITK_VERSION)).arg(MINOR_VERSION(LATEST_UITK_VERSION));
-            }
             component = new QQmlComponent(engine, url, QQmlComponent::PreferSynchronous, parent);
             if (component->isError()) {
                 qmlWarning(parent) << component->errorString();
@@ -776,20 +892,90 @@ QQmlComponent* UCTheme::createStyleComponent(const QString& styleName, QObject*
                 // set context for the component
                 QQmlEngine::setContextForObject(component, qmlContext(parent));
             }
-        } else {
-            qmlWarning(parent) <<
-               QStringLiteral("Warning: Style %1 not found in theme %2").arg(styleName).arg(name());
         }
     }
 
     return component;
 }
 
+/*
+ * Style components shared by the styled items of an engine, keyed by engine
+ * and style URL. The components are owned by the engine and deleted when the
+ * last reference is released.
+ */
+struct SharedStyleComponent
+{
+    SharedStyleComponent()
+        : refCount(0)
+    {}
+    QPointer<QQmlComponent> component;
+    int refCount;
+};
+typedef QPair<QQmlEngine*, QUrl> SharedStyleComponentKey;
+static QHash<SharedStyleComponentKey, SharedStyleComponent> sharedStyleComponents;
+
+/*
+ * Returns the shared style component named \a styleName for the engine of
+ * \a parent, creating it on first use. The styles are created in the context
+ * of the styled item as the component has no creation context. Each returned
+ * component must be released with releaseStyleComponent().
+ */
+QQmlComponent* UCTheme::acquireStyleComponent(const QString& styleName, QObject* parent, quint16 version)
+{
+    Q_ASSERT(version && parent);
+    QQmlEngine* engine = qmlEngine(parent);
+    if (!engine) {
+        // same as createStyleComponent(), the qml context may not be defined yet
+        return Q_NULLPTR;
+    }
+    QUrl url = resolveStyleUrl(styleName, parent, version);
+    if (!url.isValid()) {
+        return Q_NULLPTR;
+    }
+
+    const SharedStyleComponentKey key(engine, url);
+    SharedStyleComponent &shared = sharedStyleComponents[key];
+    if (!shared.component) {
+        QQmlComponent *component = new QQmlComponent(engine, url, QQmlComponent::PreferSynchronous, engine);
+        if (component->isError()) {
+            // don't cache errors, each item reports it as before
+            qmlWarning(parent) << component->errorString();
+            delete component;
+            sharedStyleComponents.remove(key);
+            return Q_NULLPTR;
+        }
+        // the engine may delete the component before all the references are released
+        QObject::connect(component, &QObject::destroyed, [key]() {
+            sharedStyleComponents.remove(key);
+        });
+        shared.component = component;
+        shared.refCount = 0;
+    }
+    shared.refCount++;
+    return shared.component;
+}
+
+void UCTheme::releaseStyleComponent(QQmlComponent *component)
+{
+    if (!component) {
+        return;
+    }
+    auto shared = sharedStyleComponents.find(SharedStyleComponentKey(component->engine(), component->url()));
+    if (shared == sharedStyleComponents.end() || shared->component != component) {
+        return;
+    }
+    if (--shared->refCount == 0) {
+        // removes the entry
+        delete component;
+    }
+}
+
 void UCTheme::loadPalette(QQmlEngine *engine, bool notify)
 {
     if (!engine) {
         return;
     }
+    UMScopedTrace trace(UbuntuToolkitModule::traceId(), "ThemeLoadPalette");
     if (m_palette) {
         // restore bindings to the config palette before we delete
         m_config.restorePalette();
@@ -20,17 +20,20 @@
 #ifndef UCTHEME_P_H
 #define UCTHEME_P_H
 
+#include <QtCore/QHash>
 #include <QtCore/QObject>
+#include <QtCore/QPair>
 #include <QtCore/QPointer>
+#include <QtCore/QSet>
 #include <QtCore/QString>
 #include <QtCore/QUrl>
+#include <QtCore/QVector>
 #include <QtQml/QQmlComponent>
 #include <QtQml/QQmlParserStatus>
 #include <QtQml/QQmlProperty>
 #if QT_VERSION >= QT_VERSION_CHECK(5, 6, 0)
 #include <QtQml/private/qqmlabstractbinding_p.h>
 #endif
-#include <QtQml/private/qpodvector_p.h>
 
 #include <UbuntuToolkit/ubuntutoolkitglobal.h>
 #include <UbuntuToolkit/private/ucdefaulttheme_p.h>
@@ -43,6 +46,7 @@ class QQuickItem;
 UT_NAMESPACE_BEGIN
 
 class UCStyledItemBase;
+class UCThemingExtension;
 class UBUNTUTOOLKIT_EXPORT UCTheme : public QObject, public QQmlParserStatus
 {
     Q_OBJECT
@@ -67,6 +71,9 @@ public:
 
         QString name;
         QUrl path;
+        // style files of the theme folder relative to path, shared by the themes using it and
+        // listed again at theme paths updates if the folder changed
+        QSet<QString> files;
         bool shared:1;
         bool deprecated:1;
     };
@@ -86,7 +93,10 @@ public:
 
     // internal, used by the deprecated Theme.createStyledComponent()
     QQmlComponent* createStyleComponent(const QString& styleName, QObject* parent, quint16 version = 0);
-    void attachItem(QQuickItem *item, bool attach);
+    // shared between the styled items of an engine, used by StyledItem
+    QQmlComponent* acquireStyleComponent(const QString& styleName, QObject* parent, quint16 version);
+    static void releaseStyleComponent(QQmlComponent *component);
+    void attachItem(UCThemingExtension *extension, bool attach);
 
     // helper functions
     QColor getPaletteColor(const char *profile, const char *color);
@@ -115,6 +125,8 @@ private:
     void updateEnginePaths(QQmlEngine *engine);
     void updateThemePaths();
     QUrl styleUrl(const QString& styleName, quint16 version, bool *isFallback = NULL);
+    QUrl lookupStyleUrl(const QString& styleName, quint16 version, bool *isFallback);
+    QUrl resolveStyleUrl(const QString& styleName, QObject* parent, quint16 version);
     void loadPalette(QQmlEngine *engine, bool notify = true);
     void updateThemedItems();
 
@@ -172,8 +184,17 @@ private:
     QPointer<UCTheme> m_parentTheme;
     QPointer<QObject> m_palette; // the palette might be from the default style if the theme doesn't define palette
     QList<ThemeRecord> m_themePaths;
+    // style URLs resolved for (styleName, version), cleared when the theme paths change
+    struct StyleUrlRecord {
+        QUrl url;
+        bool isFallback;
+    };
+    QHash<QPair<QString, quint16>, StyleUrlRecord> m_styleUrls;
     UCDefaultTheme m_defaultTheme;
-    QPODVector<QQuickItem*, 4> m_attachedItems;
+    // the extensions store their index, attaching and detaching are O(1)
+    QVector<UCThemingExtension*> m_attachedItems;
+    // identifies the reload passes of the attached items, see updateThemedItems()
+    uint m_reloadPass;
     bool m_completed:1;
 
     friend class UCDeprecatedTheme;
@@ -55,7 +55,8 @@ void notifyThemeReloaded(QQuickItem *item, UCTheme *theme)
 {
     Q_FOREACH(QQuickItem *child, item->childItems()) {
         UCThemingExtension *extension = qobject_cast<UCThemingExtension*>(child);
-        if (extension) {
+        // the items using the reloaded theme are reloaded by the theme itself
+        if (extension && extension->getTheme() != theme) {
             extension->itemThemeReloaded(theme);
         }
         // StyledItem will handle the broadcast itself depending on whether the theme change was appropriate or not
@@ -174,6 +175,9 @@ UCThemingExtension::UCThemingExtension(QQuickItem *extendedItem)
     : theme(Q_NULLPTR)
     , themedItem(extendedItem)
     , themeType(Inherited)
+    , themeIndex(-1)
+    , reloadedTheme(Q_NULLPTR)
+    , reloadPass(0)
 {
     themedItem->setUserData(xdata, new UCItemAttached(themedItem));
 }
@@ -181,7 +185,7 @@ UCThemingExtension::UCThemingExtension(QQuickItem *extendedItem)
 UCThemingExtension::~UCThemingExtension()
 {
     if (theme) {
-        theme->attachItem(themedItem, false);
+        theme->attachItem(this, false);
     }
 }
 
@@ -250,7 +254,7 @@ UCTheme *UCThemingExtension::getTheme()
             qCritical().noquote() << msg;
             return Q_NULLPTR;
         }
-        theme->attachItem(themedItem, true);
+        theme->attachItem(this, true);
     }
     return theme;
 }
@@ -268,14 +272,14 @@ void UCThemingExtension::setTheme(UCTheme *newTheme, ThemeType type)
 
     // disconnect from the previous set
     if (theme) {
-        theme->attachItem(themedItem, false);
+        theme->attachItem(this, false);
     }
 
     theme = newTheme;
 
     // connect to the new set
     if (theme) {
-        theme->attachItem(themedItem, true);
+        theme->attachItem(this, true);
         // set the parent of the theme if custom
         setParentTheme();
     }
@@ -59,8 +59,15 @@ private:
     QPointer<UCTheme> theme;
     QQuickItem *themedItem;
     ThemeType themeType;
+    // position in the attached items of the theme and last reload pass with the theme
+    // running it, see UCTheme
+    int themeIndex;
+    UCTheme *reloadedTheme;
+    uint reloadPass;
 
     void setParentTheme();
+
+    friend class UCTheme;
 };
 
 UT_NAMESPACE_END
@@ -28,8 +28,10 @@
 #include "ucubuntushape_p.h"
 
 #include <math.h>
+#include <stddef.h>
 
 #include <QtCore/QPointer>
+#include <QtCore/qmath.h>
 #include <QtGui/QGuiApplication>
 #include <QtQml/QQmlInfo>
 #include <QtQuick/private/qsgadaptationlayer_p.h>
@@ -38,6 +40,7 @@
 #include <QtQuick/private/qquickimage_p.h>
 #undef emit
 
+#include "privates/softwareshapes_p.h"
 #include "quickutils_p.h"
 #include "ubuntutoolkitglobal.h"
 #include "ucunits_p.h"
@@ -158,9 +161,68 @@ void ShapeShader::updateState(
 
 // --- Scene graph material ---
 
-// Create and setup shape textures.
-static void createShapeTextures(QOpenGLContext* openglContext, quint32* ids)
+#ifndef GL_TEXTURE_BASE_LEVEL
+#define GL_TEXTURE_BASE_LEVEL 0x813C
+#endif
+
+// Only the base level of the mipmap textures is stored in the library, the other levels are
+// generated from it (using a box filter) the first time they're needed and then shared by all the
+// graphics contexts. Must be called with shapeTexturesHashMutex locked.
+static QByteArray shapeTextureMipmapLevels[shapeTextureCount][shapeTextureMipmapCount];
+static const uchar* shapeTextureMipmapLevel(int index, int level)
+{
+    if (level == 0) {
+        return shapeTextureMipmapData[index];
+    }
+
+    QByteArray& data = shapeTextureMipmapLevels[index][level];
+    if (data.isEmpty()) {
+        const uchar* src = shapeTextureMipmapLevel(index, level - 1);
+        const int srcStride = (shapeTextureMipmapWidth >> (level - 1)) * 4;
+        const int width = shapeTextureMipmapWidth >> level;
+        const int height = shapeTextureMipmapHeight >> level;
+        data.resize(width * height * 4);
+        uchar* dst = reinterpret_cast<uchar*>(data.data());
+        for (int y = 0; y < height; y++) {
+            const uchar* src0 = &src[2 * y * srcStride];
+            const uchar* src1 = src0 + srcStride;
+            for (int x = 0; x < width * 4; x += 4) {
+                for (int c = 0; c < 4; c++) {
+                    *dst++ = (src0[2 * x + c] + src0[2 * x + 4 + c] + src1[2 * x + c]
+                              + src1[2 * x + 4 + c] + 2) >> 2;
+                }
+            }
+        }
+    }
+    return reinterpret_cast<const uchar*>(data.constData());
+}
+
+class ShapeTextures {
+public:
+    ShapeTextures() : m_refCount(0), m_hasBaseLevel(false) {}
+    quint32* ids() { return m_ids; }
+    quint8* baseLevels() { return m_baseLevels; }
+    bool hasBaseLevel() const { return m_hasBaseLevel; }
+    void setHasBaseLevel(bool hasBaseLevel) { m_hasBaseLevel = hasBaseLevel; }
+    quint32 ref() { Q_ASSERT(m_refCount < UINT_MAX); return ++m_refCount; }
+    quint32 unref() { Q_ASSERT(m_refCount > 0); return --m_refCount; }
+private:
+    quint32 m_refCount;
+    quint32 m_ids[shapeTextureCount];
+    // Lowest mipmap level uploaded per texture, shapeTextureMipmapCount if none.
+    quint8 m_baseLevels[shapeTextureCount];
+    bool m_hasBaseLevel;
+};
+
+// Shape textures are shared by the contexts of a share group.
+static QHash<QOpenGLContextGroup*, ShapeTextures> shapeTexturesHash;
+static QMutex shapeTexturesHashMutex;
+
+// Create and setup shape textures. Mipmap levels are uploaded lazily, see
+// ShapeMaterial::updateShapeTexture().
+static void createShapeTextures(QOpenGLContext* openglContext, ShapeTextures* textures)
 {
+    quint32* ids = textures->ids();
     glGenTextures(shapeTextureCount, ids);
 
     if (UCUbuntuShape::useDistanceFields(openglContext)) {
@@ -173,38 +235,25 @@ static void createShapeTextures(QOpenGLContext* openglContext, quint32* ids)
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
             glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, shapeTextureWidth, shapeTextureHeight, 0,
                          GL_RGBA, GL_UNSIGNED_BYTE, shapeTextureData[i]);
+            textures->baseLevels()[i] = 0;
         }
     } else {
-        // Create mipmap textures.
+        // Create mipmap textures. OpenGL ES 2 can't restrict the levels sampled, so the whole
+        // chain is uploaded at once there.
+        textures->setHasBaseLevel(
+            !openglContext->isOpenGLES() || openglContext->format().majorVersion() >= 3);
         for (int i = 0; i < shapeTextureCount; i++) {
             glBindTexture(GL_TEXTURE_2D, ids[i]);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
             glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-            for (int j = 0; j < shapeTextureMipmapCount; j++) {
-                glTexImage2D(GL_TEXTURE_2D, j, GL_RGBA, shapeTextureMipmapWidth >> j,
-                             shapeTextureMipmapHeight >> j, 0, GL_RGBA, GL_UNSIGNED_BYTE,
-                             &shapeTextureMipmapData[i][shapeTextureMipmapOffset[j]]);
-            }
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+            textures->baseLevels()[i] = shapeTextureMipmapCount;
         }
     }
+    glBindTexture(GL_TEXTURE_2D, 0);
 }
 
-class ShapeTextures {
-public:
-    ShapeTextures() : m_refCount(0) {}
-    quint32* ids() { return m_ids; }
-    quint32 ref() { Q_ASSERT(m_refCount < UINT_MAX); return ++m_refCount; }
-    quint32 unref() { Q_ASSERT(m_refCount > 0); return --m_refCount; }
-private:
-    quint32 m_refCount;
-    quint32 m_ids[shapeTextureCount];
-};
-
-static QHash<QOpenGLContext*, ShapeTextures> shapeTexturesHash;
-static QMutex shapeTexturesHashMutex;
-
 ShapeMaterial::ShapeMaterial()
 {
     // The whole struct (with the padding bytes) must be initialized for memcmp() to work as
@@ -216,18 +265,19 @@ ShapeMaterial::ShapeMaterial()
     // associates the same graphics context to a material for its entire lifetime.
     QOpenGLContext* context = QOpenGLContext::currentContext();
     shapeTexturesHashMutex.lock();
-    ShapeTextures& textures = shapeTexturesHash[context];
+    ShapeTextures& textures = shapeTexturesHash[context->shareGroup()];
     if (textures.ref() == 1) {
-        createShapeTextures(context, textures.ids());
+        createShapeTextures(context, &textures);
     }
     memcpy(m_shapeTexturesId, textures.ids(), shapeTextureCount * sizeof(quint32));
+    memcpy(m_shapeTexturesBaseLevel, textures.baseLevels(), shapeTextureCount * sizeof(quint8));
     shapeTexturesHashMutex.unlock();
 }
 
 ShapeMaterial::~ShapeMaterial()
 {
     shapeTexturesHashMutex.lock();
-    auto it = shapeTexturesHash.find(QOpenGLContext::currentContext());
+    auto it = shapeTexturesHash.find(QOpenGLContext::currentContext()->shareGroup());
     Q_ASSERT(it != shapeTexturesHash.end());
     if (it.value().unref() == 0) {
         glDeleteTextures(shapeTextureCount, it.value().ids());
@@ -236,6 +286,49 @@ ShapeMaterial::~ShapeMaterial()
     shapeTexturesHashMutex.unlock();
 }
 
+// A shape texture spans the radius, so the level sampled is log2(shapeTextureMipmapWidth /
+// radius), one finer level is required to account for trilinear filtering and scaled items.
+// static
+int ShapeMaterial::shapeTextureLevel(float physicalRadius)
+{
+    const int sampledLevel = physicalRadius >= 1.0f ?
+        static_cast<int>(log2f(shapeTextureMipmapWidth / physicalRadius)) :
+        shapeTextureMipmapCount - 1;
+    return qBound(0, sampledLevel - 1, shapeTextureMipmapCount - 1);
+}
+
+// Ensure the mipmap levels sampled by a shape of the given radius are uploaded. Must be called
+// with the context of the material current.
+void ShapeMaterial::updateShapeTexture(quint8 shapeTextureIndex, float physicalRadius)
+{
+    const int level = shapeTextureLevel(physicalRadius);
+    if (level >= m_shapeTexturesBaseLevel[shapeTextureIndex]) {
+        return;
+    }
+
+    shapeTexturesHashMutex.lock();
+    ShapeTextures& textures = shapeTexturesHash[QOpenGLContext::currentContext()->shareGroup()];
+    quint8& baseLevel = textures.baseLevels()[shapeTextureIndex];
+    if (level < baseLevel) {
+        const int firstLevel = textures.hasBaseLevel() ? level : 0;
+        // Levels are uploaded from the finest one needed down to the lowest one already uploaded
+        // (or the last one), so that the chain stays complete.
+        glBindTexture(GL_TEXTURE_2D, textures.ids()[shapeTextureIndex]);
+        for (int i = firstLevel; i < baseLevel; i++) {
+            glTexImage2D(GL_TEXTURE_2D, i, GL_RGBA, shapeTextureMipmapWidth >> i,
+                         shapeTextureMipmapHeight >> i, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                         shapeTextureMipmapLevel(shapeTextureIndex, i));
+        }
+        if (textures.hasBaseLevel()) {
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, firstLevel);
+        }
+        glBindTexture(GL_TEXTURE_2D, 0);
+        baseLevel = firstLevel;
+    }
+    m_shapeTexturesBaseLevel[shapeTextureIndex] = baseLevel;
+    shapeTexturesHashMutex.unlock();
+}
+
 QSGMaterialType* ShapeMaterial::type() const
 {
     static QSGMaterialType type;
@@ -253,8 +346,33 @@ int ShapeMaterial::compare(const QSGMaterial* other) const
     // the texture provider in the material data (not the texture as we want to do the extraction at
     // QSGShader::updateState() time), we make the comparison fail when repeat wrapping is set.
     const ShapeMaterial::Data* otherData = static_cast<const ShapeMaterial*>(other)->constData();
-    return memcmp(&m_data, otherData, sizeof(m_data))
+    const size_t offset = offsetof(ShapeMaterial::Data, shapeTextureIndex);
+    const int result = memcmp(reinterpret_cast<const char*>(&m_data) + offset,
+                              reinterpret_cast<const char*>(otherData) + offset,
+                              sizeof(m_data) - offset)
         | (m_data.flags & ShapeMaterial::Data::Repeated);
+    if (result || !(m_data.flags & ShapeMaterial::Data::Textured)
+        || m_data.sourceTextureProvider == otherData->sourceTextureProvider) {
+        return result;
+    }
+
+    // Sources are compared by texture rather than by provider so that shapes showing different
+    // images of the same atlas can be batched, the atlas sub-rectangles being selected by the
+    // per-vertex source coordinates (see UCUbuntuShape::updatePaintNode()). Textures without an id
+    // yet (like layers before their first grab) can't be told apart, providers are compared then.
+    QSGTextureProvider* provider = m_data.sourceTextureProvider;
+    QSGTextureProvider* otherProvider = otherData->sourceTextureProvider;
+    QSGTexture* texture = provider ? provider->texture() : NULL;
+    QSGTexture* otherTexture = otherProvider ? otherProvider->texture() : NULL;
+    const int textureId = texture ? texture->textureId() : 0;
+    const int otherTextureId = otherTexture ? otherTexture->textureId() : 0;
+    if (textureId == 0 || otherTextureId == 0) {
+        return provider < otherProvider ? -1 : 1;
+    }
+    if (textureId != otherTextureId) {
+        return textureId < otherTextureId ? -1 : 1;
+    }
+    return texture->filtering() - otherTexture->filtering();
 }
 
 void ShapeMaterial::updateTextures()
@@ -415,6 +533,7 @@ void UCUbuntuShape::setRadius(const QString& radius)
         Medium : ((radius == QStringLiteral("large")) ? Large : Small);
     if (m_radius != newRadius) {
         m_radius = newRadius;
+        m_flags |= DirtyGeometry;
         update();
         Q_EMIT radiusChanged();
     }
@@ -466,6 +585,7 @@ void UCUbuntuShape::setRelativeRadius(qreal relativeRadius)
     const quint8 relativeRadiusPacked = qRound(qBound(0.0, relativeRadius, 0.75) * 100.0);
     if (m_relativeRadius != relativeRadiusPacked) {
         m_relativeRadius = relativeRadiusPacked;
+        m_flags |= DirtyGeometry;
         update();
         Q_EMIT relativeRadiusChanged();
     }
@@ -479,6 +599,7 @@ void UCUbuntuShape::dropImageSupport()
         if (m_source) {
             QObject::disconnect(m_source);
             m_source = NULL;
+            m_flags |= DirtyGeometry | DirtyColors;
             update();
             Q_EMIT imageChanged();
         }
@@ -546,6 +667,7 @@ void UCUbuntuShape::setSource(const QVariant& source)
             m_flags |= DirtySourceTransform;
         }
         m_source = newSource;
+        m_flags |= DirtyGeometry | DirtyColors;
         update();
         Q_EMIT sourceChanged();
     }
@@ -629,6 +751,7 @@ void UCUbuntuShape::setSourceHorizontalWrapMode(UCUbuntuShape::WrapMode sourceHo
 
     if (m_sourceHorizontalWrapMode != sourceHorizontalWrapMode) {
         m_sourceHorizontalWrapMode = sourceHorizontalWrapMode;
+        m_flags |= DirtyGeometry;
         update();
         Q_EMIT sourceHorizontalWrapModeChanged();
     }
@@ -640,6 +763,7 @@ void UCUbuntuShape::setSourceVerticalWrapMode(UCUbuntuShape::WrapMode sourceVert
 
     if (m_sourceVerticalWrapMode != sourceVerticalWrapMode) {
         m_sourceVerticalWrapMode = sourceVerticalWrapMode;
+        m_flags |= DirtyGeometry;
         update();
         Q_EMIT sourceVerticalWrapModeChanged();
     }
@@ -758,7 +882,7 @@ void UCUbuntuShape::setSourceScale(const QVector2D& sourceScale)
 void UCUbuntuShape::dropColorSupport()
 {
     if (!(m_flags & BackgroundApiSet)) {
-        m_flags |= BackgroundApiSet;
+        m_flags |= BackgroundApiSet | DirtyColors;
         if (m_backgroundColor) {
             m_backgroundColor = qRgba(0, 0, 0, 0);
             Q_EMIT colorChanged();
@@ -786,6 +910,7 @@ void UCUbuntuShape::setBackgroundColor(const QColor& backgroundColor)
         backgroundColor.alpha());
     if (m_backgroundColor != backgroundColorRgb) {
         m_backgroundColor = backgroundColorRgb;
+        m_flags |= DirtyColors;
         update();
         Q_EMIT backgroundColorChanged();
     }
@@ -808,6 +933,7 @@ void UCUbuntuShape::setSecondaryBackgroundColor(const QColor& secondaryBackgroun
         secondaryBackgroundColor.blue(), secondaryBackgroundColor.alpha());
     if (m_secondaryBackgroundColor != secondaryBackgroundColorRgb) {
         m_secondaryBackgroundColor = secondaryBackgroundColorRgb;
+        m_flags |= DirtyColors;
         update();
         Q_EMIT secondaryBackgroundColorChanged();
     }
@@ -833,6 +959,7 @@ void UCUbuntuShape::setBackgroundMode(BackgroundMode backgroundMode)
 
     if (m_backgroundMode != backgroundMode) {
         m_backgroundMode = backgroundMode;
+        m_flags |= DirtyColors;
         update();
         Q_EMIT backgroundModeChanged();
     }
@@ -896,6 +1023,7 @@ void UCUbuntuShape::setColor(const QColor& color)
                 m_secondaryBackgroundColor = colorRgb;
                 Q_EMIT gradientColorChanged();
             }
+            m_flags |= DirtyColors;
             update();
             Q_EMIT colorChanged();
         }
@@ -923,6 +1051,7 @@ void UCUbuntuShape::setGradientColor(const QColor& gradientColor)
             gradientColor.alpha());
         if (m_secondaryBackgroundColor != gradientColorRgb) {
             m_secondaryBackgroundColor = gradientColorRgb;
+            m_flags |= DirtyColors;
             update();
             Q_EMIT gradientColorChanged();
         }
@@ -958,6 +1087,7 @@ void UCUbuntuShape::setImage(const QVariant& image)
                 m_flags |= DirtySourceTransform;
             }
             QObject::disconnect(m_source);
+            m_flags |= DirtyGeometry | DirtyColors;
             update();
             m_source = newImage;
             Q_EMIT imageChanged();
@@ -1078,6 +1208,7 @@ void UCUbuntuShape::_q_gridUnitChanged()
     const float gridUnitInDevicePixels = UCUnits::instance()->gridUnit() / qGuiApp->devicePixelRatio();
     setImplicitWidth(implicitWidthGU * gridUnitInDevicePixels);
     setImplicitHeight(implicitHeightGU * gridUnitInDevicePixels);
+    m_flags |= DirtyGeometry;
     update();
 }
 
@@ -1089,7 +1220,7 @@ void UCUbuntuShape::_q_providerDestroyed(QObject* object)
 
 void UCUbuntuShape::_q_textureChanged()
 {
-    m_flags |= DirtySourceTransform;
+    m_flags |= DirtySourceTransform | DirtyGeometry | DirtyColors;
     update();
 }
 
@@ -1111,7 +1242,7 @@ void UCUbuntuShape::componentComplete()
 void UCUbuntuShape::geometryChanged(const QRectF& newGeometry, const QRectF& oldGeometry)
 {
     QQuickItem::geometryChanged(newGeometry, oldGeometry);
-    m_flags |= DirtySourceTransform;
+    m_flags |= DirtySourceTransform | DirtyGeometry;
 }
 
 // Gets the nearest boundary to coord in the texel grid of the given size.
@@ -1191,9 +1322,6 @@ QSGNode* UCUbuntuShape::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* d
         return NULL;
     }
 
-    QSGNode* node = oldNode ? oldNode : createSceneGraphNode();
-    Q_ASSERT(node);
-
     // Get the source texture info and update the source transform if needed.
     QSGTextureProvider* provider = m_source ? m_source->textureProvider() : NULL;
     QSGTexture* sourceTexture = provider ? provider->texture() : NULL;
@@ -1216,6 +1344,7 @@ QSGNode* UCUbuntuShape::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* d
                                       sourceTexture->textureSize());
             }
             m_flags &= ~DirtySourceTransform;
+            m_flags |= DirtyGeometry;
         }
     }
 
@@ -1252,25 +1381,7 @@ QSGNode* UCUbuntuShape::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* d
                      / qGuiApp->devicePixelRatio();
     }
 
-    updateMaterial(node, radius, m_aspect != DropShadow ? 0 : 1, sourceTexture && m_sourceOpacity);
-
-    // Get the affine transformation for the source texture coordinates.
-    const QVector4D sourceCoordTransform(
-        m_sourceTransform.x() * sourceTextureRect.width(),
-        m_sourceTransform.y() * sourceTextureRect.height(),
-        m_sourceTransform.z() * sourceTextureRect.width() + sourceTextureRect.x(),
-        m_sourceTransform.w() * sourceTextureRect.height() + sourceTextureRect.y());
-
-    // Get the affine transformation for the source mask coordinates, pixels lying inside the mask
-    // (values in the range [-1, 1]) will be textured in the fragment shader. In case of a repeat
-    // wrap mode, the transformation is made so that the mask takes the whole area.
-    const QVector4D sourceMaskTransform(
-        m_sourceHorizontalWrapMode == Transparent ? m_sourceTransform.x() * 2.0f : 2.0f,
-        m_sourceVerticalWrapMode == Transparent ? m_sourceTransform.y() * 2.0f : 2.0f,
-        m_sourceHorizontalWrapMode == Transparent ? m_sourceTransform.z() * 2.0f - 1.0f : -1.0f,
-        m_sourceVerticalWrapMode == Transparent ? m_sourceTransform.w() * 2.0f - 1.0f : -1.0f);
-
-    // Select and pack the lerped and premultiplied background colors.
+    // Select the background colors.
     QRgb color[2];
     if (m_flags & BackgroundApiSet) {
         color[0] = m_backgroundColor;
@@ -1289,15 +1400,57 @@ QSGNode* UCUbuntuShape::updatePaintNode(QSGNode* oldNode, UpdatePaintNodeData* d
             color[1] = qRgba(0, 0, 0, 0);
         }
     }
+
+    if (isSoftwareRendering(this)) {
+        return updateSoftwareNode(oldNode, itemSize, radius, color, sourceTexture);
+    }
+
+    QSGNode* node = oldNode;
+    if (!node) {
+        node = createSceneGraphNode();
+        m_flags |= DirtyGeometry | DirtyColors;
+    }
+    Q_ASSERT(node);
+
+    updateMaterial(node, radius, m_aspect != DropShadow ? 0 : 1, sourceTexture && m_sourceOpacity);
+
+    // Material only changes (aspect, source opacity, ...) and changes not affecting the item at all
+    // (like its opacity) leave the vertices untouched, color only changes just update the colors.
+    if (!(m_flags & (DirtyGeometry | DirtyColors))) {
+        return node;
+    }
+
+    // Pack the lerped and premultiplied background colors.
     const quint32 backgroundColor[3] = {
         packColor(qAlpha(color[0]), qBlue(color[0]), qGreen(color[0]), qRed(color[0])),
         averageColor(color[0], color[1]),
         packColor(qAlpha(color[1]), qBlue(color[1]), qGreen(color[1]), qRed(color[1]))
     };
 
-    updateGeometry(
-        node, itemSize, radius, shapeTextureOffset, sourceCoordTransform, sourceMaskTransform,
-        backgroundColor);
+    if (m_flags & DirtyGeometry) {
+        // Get the affine transformation for the source texture coordinates.
+        const QVector4D sourceCoordTransform(
+            m_sourceTransform.x() * sourceTextureRect.width(),
+            m_sourceTransform.y() * sourceTextureRect.height(),
+            m_sourceTransform.z() * sourceTextureRect.width() + sourceTextureRect.x(),
+            m_sourceTransform.w() * sourceTextureRect.height() + sourceTextureRect.y());
+
+        // Get the affine transformation for the source mask coordinates, pixels lying inside the
+        // mask (values in the range [-1, 1]) will be textured in the fragment shader. In case of a
+        // repeat wrap mode, the transformation is made so that the mask takes the whole area.
+        const QVector4D sourceMaskTransform(
+            m_sourceHorizontalWrapMode == Transparent ? m_sourceTransform.x() * 2.0f : 2.0f,
+            m_sourceVerticalWrapMode == Transparent ? m_sourceTransform.y() * 2.0f : 2.0f,
+            m_sourceHorizontalWrapMode == Transparent ? m_sourceTransform.z() * 2.0f - 1.0f : -1.0f,
+            m_sourceVerticalWrapMode == Transparent ? m_sourceTransform.w() * 2.0f - 1.0f : -1.0f);
+
+        updateGeometry(
+            node, itemSize, radius, shapeTextureOffset, sourceCoordTransform, sourceMaskTransform,
+            backgroundColor);
+    } else {
+        updateColors(node, backgroundColor);
+    }
+    m_flags &= ~(DirtyGeometry | DirtyColors);
 
     return node;
 }
@@ -1307,10 +1460,54 @@ QSGNode* UCUbuntuShape::createSceneGraphNode() const
     return new ShapeNode;
 }
 
+// The QtQuick software adaptation can't run the shape shaders, the shape is rasterized instead.
+QSGNode* UCUbuntuShape::updateSoftwareNode(
+    QSGNode* oldNode, const QSizeF& itemSize, float radius, const QRgb color[2],
+    QSGTexture* sourceTexture)
+{
+    const float dpr = qGuiApp->devicePixelRatio();
+    SoftwareShape shape;
+    shape.size = QSize(qCeil(itemSize.width() * dpr), qCeil(itemSize.height() * dpr));
+    shape.radius = radius * dpr;
+    shape.color[0] = color[0];
+    shape.color[1] = color[1];
+    shape.aspect = (m_aspect == Pressed) ? SoftwareShape::Inset : m_aspect;
+    shape.pressed = m_aspect == Pressed;
+
+    if (sourceTexture && m_sourceOpacity) {
+        shape.source = softwareTextureImage(sourceTexture);
+        const float sx = m_sourceTransform.x();
+        const float sy = m_sourceTransform.y();
+        if (!shape.source.isNull() && sx != 0.0f && sy != 0.0f) {
+            // The source transform maps the item coordinates in the range [0, 1] to the source
+            // coordinates, the source rectangle in the shape is given by its inverse.
+            shape.sourceRect = QRectF(
+                (-m_sourceTransform.z() / sx) * shape.size.width(),
+                (-m_sourceTransform.w() / sy) * shape.size.height(),
+                shape.size.width() / sx, shape.size.height() / sy);
+            shape.sourceOpacity = m_sourceOpacity;
+            shape.sourceHorizontallyRepeated = m_sourceHorizontalWrapMode == Repeat;
+            shape.sourceVerticallyRepeated = m_sourceVerticalWrapMode == Repeat;
+        } else {
+            shape.source = QImage();
+        }
+    }
+
+    updateSoftwareShape(&shape);
+    return updateSoftwareShapeNode(this, oldNode, shape);
+}
+
+void UCUbuntuShape::updateSoftwareShape(SoftwareShape* shape)
+{
+    Q_UNUSED(shape);
+}
+
 void UCUbuntuShape::updateMaterial(
     QSGNode* node, float radius, quint8 shapeTextureIndex, bool textured)
 {
-    ShapeMaterial::Data* materialData = static_cast<ShapeNode*>(node)->material()->data();
+    ShapeMaterial* material = static_cast<ShapeNode*>(node)->material();
+    ShapeMaterial::Data* materialData = material->data();
+    const ShapeMaterial::Data oldMaterialData = *materialData;
     quint8 flags = 0;
 
     materialData->shapeTextureIndex = shapeTextureIndex;
@@ -1330,6 +1527,7 @@ void UCUbuntuShape::updateMaterial(
     }
 
     const float physicalRadius = radius * qGuiApp->devicePixelRatio();
+    material->updateShapeTexture(shapeTextureIndex, physicalRadius);
 
     // Mapping of radius size range from [0, 4] to [0, 1] with clamping, plus quantization.
     const float start = 0.0f + radiusSizeOffset;
@@ -1353,6 +1551,12 @@ void UCUbuntuShape::updateMaterial(
     }
 
     materialData->flags = flags;
+
+    // The geometry isn't necessarily marked dirty anymore, the renderer must be notified so that
+    // batches are rebuilt.
+    if (memcmp(&oldMaterialData, materialData, sizeof(ShapeMaterial::Data))) {
+        node->markDirty(QSGNode::DirtyMaterial);
+    }
 }
 
 void UCUbuntuShape::updateGeometry(
@@ -1466,4 +1670,17 @@ void UCUbuntuShape::updateGeometry(
     node->markDirty(QSGNode::DirtyGeometry);
 }
 
+void UCUbuntuShape::updateColors(QSGNode* node, const quint32 backgroundColor[3])
+{
+    ShapeNode::Vertex* v = reinterpret_cast<ShapeNode::Vertex*>(
+        static_cast<ShapeNode*>(node)->geometry()->vertexData());
+
+    // Rows of 3 vertices use the top, middle and bottom colors.
+    for (int i = 0; i < ShapeNode::vertexCount; i++) {
+        v[i].backgroundColor = backgroundColor[i / 3];
+    }
+
+    node->markDirty(QSGNode::DirtyGeometry);
+}
+
 UT_NAMESPACE_END
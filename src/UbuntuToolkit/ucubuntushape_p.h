@@ -31,6 +31,8 @@
 
 UT_NAMESPACE_BEGIN
 
+struct SoftwareShape;
+
 class ShapeShader : public QSGMaterialShader
 {
 public:
@@ -54,7 +56,7 @@ private:
 
 // --- Scene graph material ---
 
-class ShapeMaterial : public QSGMaterial
+class UBUNTUTOOLKIT_EXPORT ShapeMaterial : public QSGMaterial
 {
 public:
     struct Data {
@@ -69,6 +71,8 @@ public:
             AspectMask           = (Flat | Inset | DropShadow),
             Pressed              = (1 << 6)
         };
+        // Must stay the first field, the remaining ones are compared with memcmp() in
+        // ShapeMaterial::compare().
         QSGTextureProvider* sourceTextureProvider;
         quint8 shapeTextureIndex;
         quint8 distanceAAFactor;
@@ -82,6 +86,11 @@ public:
     QSGMaterialShader* createShader() const override;
     int compare(const QSGMaterial* other) const override;
     virtual void updateTextures();
+    void updateShapeTexture(quint8 shapeTextureIndex, float physicalRadius);
+    static int shapeTextureLevel(float physicalRadius);
+    // Lowest mipmap level uploaded, shapeTextureMipmapCount if none.
+    quint8 shapeTextureBaseLevel(quint8 shapeTextureIndex) const {
+        return m_shapeTexturesBaseLevel[shapeTextureIndex]; }
     const Data* constData() const { return &m_data; }
     Data* data() { return &m_data; }
     quint32* textureIds() { return m_shapeTexturesId; }
@@ -89,6 +98,7 @@ public:
 private:
     Data m_data;
     quint32 m_shapeTexturesId[shapeTextureCount];
+    quint8 m_shapeTexturesBaseLevel[shapeTextureCount];
 };
 
 // --- Scene graph node ---
@@ -308,6 +318,14 @@ protected:
         QSGNode* node, const QSizeF& itemSize, float radius, float shapeOffset,
         const QVector4D& sourceCoordTransform, const QVector4D& sourceMaskTransform,
         const quint32 backgroundColor[3]);
+    // Called instead of updateGeometry() when only the colors changed.
+    virtual void updateColors(QSGNode* node, const quint32 backgroundColor[3]);
+    // Called with the QtQuick software adaptation, once the base shape is set.
+    virtual void updateSoftwareShape(SoftwareShape* shape);
+
+    // Schedule an update of the whole geometry or of the colors only, for extended shapes.
+    void invalidateGeometry() { m_flags |= DirtyGeometry; update(); }
+    void invalidateColors() { m_flags |= DirtyColors; update(); }
 
 private Q_SLOTS:
     void _q_imagePropertiesChanged();
@@ -326,6 +344,9 @@ private:
     void updateSourceTransform(
         float itemWidth, float itemHeight, FillMode fillMode, HAlignment horizontalAlignment,
         VAlignment verticalAlignment, const QSize& textureSize);
+    QSGNode* updateSoftwareNode(
+        QSGNode* oldNode, const QSizeF& itemSize, float radius, const QRgb color[2],
+        QSGTexture* sourceTexture);
 
     enum Radius { Small = 0, Medium = 1, Large = 2 };
     enum { Pressed = 3 };  // Aspect extension (to keep support for deprecated aspects).
@@ -335,7 +356,9 @@ private:
         BackgroundApiSet     = (1 << 2),
         SourceApiSet         = (1 << 3),
         Stretched            = (1 << 4),
-        DirtySourceTransform = (1 << 5)
+        DirtySourceTransform = (1 << 5),
+        DirtyGeometry        = (1 << 6),
+        DirtyColors          = (1 << 7)
     };
 
     QQuickItem* m_source;
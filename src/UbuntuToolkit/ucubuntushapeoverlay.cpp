@@ -22,6 +22,8 @@
 
 #include "ucubuntushapeoverlay_p.h"
 
+#include "privates/softwareshapes_p.h"
+
 // -- Scene graph shader ---
 
 UT_NAMESPACE_BEGIN
@@ -185,7 +187,7 @@ void UCUbuntuShapeOverlay::setOverlayRect(const QRectF& overlayRect)
         m_overlayY = overlayY;
         m_overlayWidth = overlayWidth;
         m_overlayHeight = overlayHeight;
-        update();
+        invalidateGeometry();
         Q_EMIT overlayRectChanged();
     }
 }
@@ -202,7 +204,7 @@ void UCUbuntuShapeOverlay::setOverlayColor(const QColor& overlayColor)
         overlayColor.red(), overlayColor.green(), overlayColor.blue(), overlayColor.alpha());
     if (m_overlayColor != overlayColorRgb) {
         m_overlayColor = overlayColorRgb;
-        update();
+        invalidateColors();
         Q_EMIT overlayColorChanged();
     }
 }
@@ -212,6 +214,12 @@ QSGNode* UCUbuntuShapeOverlay::createSceneGraphNode() const
     return new ShapeOverlayNode;
 }
 
+void UCUbuntuShapeOverlay::updateSoftwareShape(SoftwareShape* shape)
+{
+    shape->overlayRect = overlayRect();
+    shape->overlayColor = m_overlayColor;
+}
+
 // Pack to a premultiplied 32-bit ABGR integer.
 static quint32 packColor(QRgb color)
 {
@@ -222,6 +230,13 @@ static quint32 packColor(QRgb color)
     return (a << 24) | ((b & 0xff) << 16) | ((g & 0xff) << 8) | (r & 0xff);
 }
 
+// The overlay affine transformation doesn't exist when width or height is null, whenever that is
+// the case we simply set the color to transparent. GPUs handle NaN/Inf values flowlessly.
+quint32 UCUbuntuShapeOverlay::packOverlayColor() const
+{
+    return (m_overlayWidth && m_overlayHeight) ? packColor(m_overlayColor) : 0x00000000;
+}
+
 void UCUbuntuShapeOverlay::updateGeometry(
     QSGNode* node, const QSizeF& itemSize, float radius, float shapeOffset,
     const QVector4D& sourceCoordTransform, const QVector4D& sourceMaskTransform,
@@ -240,10 +255,7 @@ void UCUbuntuShapeOverlay::updateGeometry(
     const float overlayTx = -((m_overlayX * u16toF32) * invOverlayWidth) * 2.0f - 1.0f;
     const float overlayTy = -((m_overlayY * u16toF32) * invOverlayHeight) * 2.0f - 1.0f;
 
-    // The overlay affine transformation doesn't exist when width or height is null, whenever that
-    // is the case we simply set the color to transparent. GPUs handle NaN/Inf values flowlessly.
-    const quint32 overlayColor = qIsFinite(invOverlayHeight + invOverlayWidth) ?
-        packColor(m_overlayColor) : 0x00000000;
+    const quint32 overlayColor = packOverlayColor();
 
     // Set top row of 3 vertices.
     v[0].position[0] = 0.0f;
@@ -371,4 +383,19 @@ void UCUbuntuShapeOverlay::updateGeometry(
     node->markDirty(QSGNode::DirtyGeometry);
 }
 
+void UCUbuntuShapeOverlay::updateColors(QSGNode* node, const quint32 backgroundColor[3])
+{
+    ShapeOverlayNode::Vertex* v = reinterpret_cast<ShapeOverlayNode::Vertex*>(
+        static_cast<ShapeOverlayNode*>(node)->geometry()->vertexData());
+    const quint32 overlayColor = packOverlayColor();
+
+    // Rows of 3 vertices use the top, middle and bottom colors.
+    for (int i = 0; i < ShapeNode::vertexCount; i++) {
+        v[i].backgroundColor = backgroundColor[i / 3];
+        v[i].overlayColor = overlayColor;
+    }
+
+    node->markDirty(QSGNode::DirtyGeometry);
+}
+
 UT_NAMESPACE_END
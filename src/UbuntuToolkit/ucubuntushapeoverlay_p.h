@@ -99,8 +99,12 @@ protected:
         QSGNode* node, const QSizeF& itemSize, float radius, float shapeOffset,
         const QVector4D& sourceCoordTransform, const QVector4D& sourceMaskTransform,
         const quint32 backgroundColor[3]) override;
+    void updateColors(QSGNode* node, const quint32 backgroundColor[3]) override;
+    void updateSoftwareShape(SoftwareShape* shape) override;
 
 private:
+    quint32 packOverlayColor() const;
+
     quint16 m_overlayX;
     quint16 m_overlayY;
     quint16 m_overlayWidth;
@@ -15,7 +15,6 @@ const int shapeTextureMipmapWidth = 256;
 const int shapeTextureMipmapHeight = 256;
 const int shapeTextureMipmapCount = 9;
 
-extern const int shapeTextureMipmapOffset[9];
-extern const unsigned char shapeTextureMipmapData[2][349525];
+extern const unsigned char shapeTextureMipmapData[2][262145];
 
 #endif // UCUBUNTUSHAPETEXTURES_H
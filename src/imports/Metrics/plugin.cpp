@@ -20,6 +20,7 @@
 // FIXME(loicm)
 //   - Not sure how to add support for the loggers API?
 //   - Add support for the generic logging API.
+//   - Spans traced from QML all share the same generic event id.
 
 class ApplicationMonitorWrapper : public QObject
 {
@@ -33,11 +34,16 @@ class ApplicationMonitorWrapper : public QObject
                NOTIFY loggingFilterChanged)
     Q_PROPERTY(int processUpdateInterval READ processUpdateInterval
                WRITE setProcessUpdateInterval NOTIFY processUpdateIntervalChanged)
+    Q_PROPERTY(int frameSummaryUpdateInterval READ frameSummaryUpdateInterval
+               WRITE setFrameSummaryUpdateInterval NOTIFY frameSummaryUpdateIntervalChanged)
+    Q_PROPERTY(int longFrameBudget READ longFrameBudget WRITE setLongFrameBudget
+               NOTIFY longFrameBudgetChanged)
 
 public:
     ApplicationMonitorWrapper(QObject* parent = 0)
         : QObject(parent)
         , m_applicationMonitor(UMApplicationMonitor::instance())
+        , m_spanId(m_applicationMonitor->registerGenericEvent())
     {
         QObject::connect(m_applicationMonitor, SIGNAL(overlayChanged()),
                          this, SIGNAL(overlayChanged()));
@@ -47,6 +53,8 @@ public:
                          this, SIGNAL(loggingFilterChanged()));
         QObject::connect(m_applicationMonitor, SIGNAL(updateIntervalChanged(UMEvent::Type)),
                          this, SLOT(updateIntervalChanged(UMEvent::Type)));
+        QObject::connect(m_applicationMonitor, SIGNAL(longFrameBudgetChanged()),
+                         this, SIGNAL(longFrameBudgetChanged()));
     }
     ~ApplicationMonitorWrapper() {}
 
@@ -55,12 +63,16 @@ public:
         WindowEvent  = UMApplicationMonitor::WindowEvent,
         FrameEvent   = UMApplicationMonitor::FrameEvent,
         GenericEvent = UMApplicationMonitor::GenericEvent,
+        FrameSummaryEvent = UMApplicationMonitor::FrameSummaryEvent,
+        SpanEvent    = UMApplicationMonitor::SpanEvent,
+        LongFrameEvent = UMApplicationMonitor::LongFrameEvent,
         AllEvents    = UMApplicationMonitor::AllEvents
     };
     Q_DECLARE_FLAGS(LoggingFilters, LoggingFilter)
 
     enum Event {
-        UserInterfaceReady = UMApplicationMonitor::UserInterfaceReady
+        UserInterfaceReady = UMApplicationMonitor::UserInterfaceReady,
+        FirstFrameSwapped = UMApplicationMonitor::FirstFrameSwapped
     };
 
     bool overlay() const { return m_applicationMonitor->overlay(); }
@@ -79,26 +91,49 @@ public:
         return m_applicationMonitor->updateInterval(UMEvent::Process); }
     void setProcessUpdateInterval(int interval) {
         m_applicationMonitor->setUpdateInterval(UMEvent::Process, interval); }
+    int frameSummaryUpdateInterval() const {
+        return m_applicationMonitor->updateInterval(UMEvent::FrameSummary); }
+    void setFrameSummaryUpdateInterval(int interval) {
+        m_applicationMonitor->setUpdateInterval(UMEvent::FrameSummary, interval); }
+    int longFrameBudget() const { return m_applicationMonitor->longFrameBudget(); }
+    void setLongFrameBudget(int budget) { m_applicationMonitor->setLongFrameBudget(budget); }
 
     Q_INVOKABLE bool logEvent(Event event) {
         return m_applicationMonitor->logEvent(static_cast<UMApplicationMonitor::Event>(event)); }
 
+    // Spans must be ended in the reverse order they've been begun, trace()
+    // calls the given function within a span and returns its result.
+    Q_INVOKABLE bool beginSpan(const QString& name) {
+        const QByteArray string = name.toUtf8();
+        return m_applicationMonitor->beginSpan(m_spanId, string.constData(), string.size() + 1); }
+    Q_INVOKABLE bool endSpan() { return m_applicationMonitor->endSpan(); }
+    Q_INVOKABLE QJSValue trace(const QString& name, QJSValue function) {
+        beginSpan(name);
+        QJSValue result = function.call();
+        m_applicationMonitor->endSpan();
+        return result; }
+
 Q_SIGNALS:
     void overlayChanged();
     void loggingChanged();
     void loggingFilterChanged();
     void processUpdateIntervalChanged();
+    void frameSummaryUpdateIntervalChanged();
+    void longFrameBudgetChanged();
 
 private Q_SLOTS:
     void updateIntervalChanged(UMEvent::Type type)
     {
         if (type == UMEvent::Process) {
             Q_EMIT processUpdateIntervalChanged();
+        } else if (type == UMEvent::FrameSummary) {
+            Q_EMIT frameSummaryUpdateIntervalChanged();
         }
     }
 
 private:
     UMApplicationMonitor* m_applicationMonitor;
+    quint32 m_spanId;
 };
 
 static QObject* applicationMonitorSingletonProvider(QQmlEngine* engine, QJSEngine* scriptEngine)
@@ -23,6 +23,23 @@ linux {
     SUBDIRS += src_metrics_lttng_plugin
 }
 
+# Tools
+
+src_metrics_convert_tool.subdir = UbuntuMetrics/tools/metricsconvert
+src_metrics_convert_tool.target = sub-metrics-convert-tool
+src_metrics_convert_tool.depends = sub-metrics-lib
+SUBDIRS += src_metrics_convert_tool
+
+src_metrics_collector_tool.subdir = UbuntuMetrics/tools/metricscollector
+src_metrics_collector_tool.target = sub-metrics-collector-tool
+src_metrics_collector_tool.depends = sub-metrics-lib
+SUBDIRS += src_metrics_collector_tool
+
+src_metrics_launchbench_tool.subdir = UbuntuMetrics/tools/launchbench
+src_metrics_launchbench_tool.target = sub-metrics-launchbench-tool
+src_metrics_launchbench_tool.depends = sub-metrics-lib
+SUBDIRS += src_metrics_launchbench_tool
+
 # QML modules
 
 src_metrics_module.subdir = imports/Metrics
@@ -0,0 +1,3 @@
+include(../test-include.pri)
+QT += UbuntuMetrics UbuntuMetrics-private
+SOURCES += tst_applicationmonitor.cpp
@@ -0,0 +1,384 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtTest/QtTest>
+#include <QtGui/QOffscreenSurface>
+#include <QtGui/QOpenGLContext>
+#include <QtQml/QQmlComponent>
+#include <QtQml/QQmlEngine>
+#include <QtQuick/QQuickItem>
+#include <QtQuick/QQuickWindow>
+#include <UbuntuMetrics/applicationmonitor.h>
+#include <UbuntuMetrics/private/applicationmonitor_p.h>
+#include <UbuntuMetrics/private/eventqueue_p.h>
+#include <UbuntuMetrics/private/gputimer_p.h>
+#include <thread>
+#include <vector>
+
+// 60 Hz refresh period in nanoseconds.
+static const quint64 refreshPeriod = Q_UINT64_C(16666667);
+
+static UMEvent frameEvent(quint32 window, quint32 number)
+{
+    UMEvent event;
+    memset(&event, 0, sizeof(event));
+    event.type = UMEvent::Frame;
+    event.frame.window = window;
+    event.frame.number = number;
+    return event;
+}
+
+// Fills and drains a queue of 8 events by steps not aligned on its capacity so
+// that the indices wrap around the ring several times.
+template <class Queue>
+static bool checkQueueWrapAround()
+{
+    Queue queue(8);
+    UMEvent events[16];
+    quint32 pushed = 0;
+    quint32 popped = 0;
+    for (int i = 0; i < 100; ++i) {
+        const int pushCount = 1 + (i * 3) % 8;
+        for (int j = 0; j < pushCount; ++j) {
+            if (!queue.push(frameEvent(0, pushed))) {
+                // Full only when all the slots are taken.
+                if (pushed - popped != 8) {
+                    return false;
+                }
+                break;
+            }
+            pushed++;
+        }
+        const int count = queue.pop(events, 1 + (i * 5) % 8);
+        for (int j = 0; j < count; ++j) {
+            if (events[j].frame.number != popped++) {
+                return false;
+            }
+        }
+    }
+    const int count = queue.pop(events, 16);
+    for (int j = 0; j < count; ++j) {
+        if (events[j].frame.number != popped++) {
+            return false;
+        }
+    }
+    return popped == pushed && queue.isEmpty();
+}
+
+template <class Queue>
+static bool checkQueueFullAndEmpty()
+{
+    Queue queue(8);
+    UMEvent events[16];
+    if (!queue.isEmpty() || queue.pop(events, 16) != 0) {
+        return false;
+    }
+    for (quint32 i = 0; i < 8; ++i) {
+        if (!queue.push(frameEvent(0, i))) {
+            return false;
+        }
+    }
+    if (queue.push(frameEvent(0, 8)) || queue.isEmpty()) {
+        return false;
+    }
+    // Popping frees slots for the following pushes.
+    if (queue.pop(events, 3) != 3 || events[0].frame.number != 0
+        || events[2].frame.number != 2) {
+        return false;
+    }
+    for (quint32 i = 8; i < 11; ++i) {
+        if (!queue.push(frameEvent(0, i))) {
+            return false;
+        }
+    }
+    if (queue.push(frameEvent(0, 11)) || queue.pop(events, 16) != 8) {
+        return false;
+    }
+    for (quint32 i = 0; i < 8; ++i) {
+        if (events[i].frame.number != i + 3) {
+            return false;
+        }
+    }
+    return queue.isEmpty() && queue.pop(events, 16) == 0;
+}
+
+class tst_ApplicationMonitor : public QObject
+{
+    Q_OBJECT
+
+private Q_SLOTS:
+    void test_missed_frames_data()
+    {
+        QTest::addColumn<quint64>("deltaTime");
+        QTest::addColumn<bool>("wasAnimating");
+        QTest::addColumn<bool>("isAnimating");
+        QTest::addColumn<int>("missedFrames");
+
+        QTest::newRow("on time") << refreshPeriod << true << true << 0;
+        QTest::newRow("jitter") << refreshPeriod * 14 / 10 << true << true << 0;
+        QTest::newRow("one missed") << refreshPeriod * 2 << true << true << 1;
+        QTest::newRow("three missed") << refreshPeriod * 4 + refreshPeriod / 3
+                                      << true << true << 3;
+        // frames rendered on demand
+        QTest::newRow("idle gap") << Q_UINT64_C(2000000000) << false << false << 0;
+        QTest::newRow("animation started after idle gap") << Q_UINT64_C(2000000000)
+                                                          << false << true << 0;
+        QTest::newRow("animation stopped") << refreshPeriod * 3 << true << false << 0;
+    }
+    void test_missed_frames()
+    {
+        QFETCH(quint64, deltaTime);
+        QFETCH(bool, wasAnimating);
+        QFETCH(bool, isAnimating);
+        QFETCH(int, missedFrames);
+
+        QCOMPARE(static_cast<int>(WindowMonitor::missedFrameCount(
+                     deltaTime, refreshPeriod, wasAnimating, isAnimating)), missedFrames);
+    }
+
+    // an animation, an idle gap of a few seconds and another animation
+    void test_missed_frames_with_idle_gap()
+    {
+        struct Frame { quint64 deltaTime; bool animating; };
+        const Frame frames[] = {
+            { 0, true }, { refreshPeriod, true }, { refreshPeriod * 2, true },
+            { refreshPeriod, false }, { Q_UINT64_C(3000000000), false },
+            { Q_UINT64_C(5000000000), true }, { refreshPeriod, true }, { refreshPeriod, true }
+        };
+        quint32 missedFrames = 0;
+        bool wasAnimating = false;
+        for (const Frame& frame : frames) {
+            missedFrames += WindowMonitor::missedFrameCount(
+                frame.deltaTime, refreshPeriod, wasAnimating, frame.animating);
+            wasAnimating = frame.animating;
+        }
+        QCOMPARE(missedFrames, 1u);
+    }
+
+    // frame summaries alone (no long frame detection) must know whether the
+    // frames are rendered while animating to aggregate the delta times
+    void test_frame_summary_of_animating_window()
+    {
+        UMApplicationMonitor* monitor = UMApplicationMonitor::instance();
+        monitor->setLongFrameBudget(-1);
+        monitor->setUpdateInterval(UMEvent::FrameSummary, 250);
+        monitor->setLoggingFilter(UMApplicationMonitor::FrameSummaryEvent);
+        monitor->setLogging(true);
+
+        QQmlEngine engine;
+        QQmlComponent component(&engine);
+        component.setData("import QtQuick 2.4\n"
+                          "Rectangle {\n"
+                          "    width: 100; height: 100\n"
+                          "    RotationAnimation on rotation {\n"
+                          "        from: 0; to: 360; duration: 1000; loops: Animation.Infinite\n"
+                          "    }\n"
+                          "}\n", QUrl());
+        QScopedPointer<QQuickItem> item(qobject_cast<QQuickItem*>(component.create()));
+        QVERIFY(item);
+        QQuickWindow window;
+        window.resize(100, 100);
+        item->setParentItem(window.contentItem());
+        QSignalSpy frameSwappedSpy(&window, SIGNAL(frameSwapped()));
+        window.show();
+        if (!frameSwappedSpy.wait(5000)) {
+            monitor->setLogging(false);
+            monitor->setUpdateInterval(UMEvent::FrameSummary, -1);
+            QSKIP("The window isn't rendered, OpenGL is likely not available.");
+        }
+
+        bool hasDeltaTimes = false;
+        QElapsedTimer timer;
+        timer.start();
+        while (!hasDeltaTimes && timer.elapsed() < 5000) {
+            QTest::qWait(50);
+            const QList<UMEvent> summaries = monitor->frameSummaries();
+            for (const UMEvent& event : summaries) {
+                QCOMPARE(event.type, UMEvent::FrameSummary);
+                hasDeltaTimes |= event.frameSummary.frameCount > 1
+                    && event.frameSummary.times[UMFrameSummaryEvent::DeltaTime]
+                                               [UMFrameSummaryEvent::Max] > 0;
+            }
+        }
+        window.hide();
+        monitor->setLogging(false);
+        monitor->setUpdateInterval(UMEvent::FrameSummary, -1);
+        QVERIFY(hasDeltaTimes);
+    }
+
+    void test_gpu_timer_ring_data()
+    {
+        QTest::addColumn<bool>("forceFinish");
+
+        QTest::newRow("default") << false;
+        QTest::newRow("glFinish") << true;
+    }
+    void test_gpu_timer_ring()
+    {
+        QFETCH(bool, forceFinish);
+
+        QOffscreenSurface surface;
+        surface.create();
+        QOpenGLContext context;
+        if (!context.create() || !context.makeCurrent(&surface)) {
+            QSKIP("OpenGL is not available.");
+        }
+        QOpenGLFunctions* functions = context.functions();
+        const quint32 maxPendingQueries = GPUTimer::maxPendingQueries;
+        quint32 tag;
+        quint64 time;
+
+        GPUTimer timer;
+        timer.initialize(forceFinish);
+        QVERIFY(timer.isAvailable());
+        QVERIFY(!timer.result(&tag, &time));
+
+        // Fill the ring, start() fails until a result is collected.
+        for (quint32 i = 0; i < maxPendingQueries; ++i) {
+            QVERIFY(timer.start());
+            functions->glClear(GL_COLOR_BUFFER_BIT);
+            timer.stop(i);
+        }
+        QVERIFY(!timer.start());
+
+        // Results are available in stop order once the GPU is done.
+        functions->glFinish();
+        for (quint32 i = 0; i < maxPendingQueries; ++i) {
+            QVERIFY(timer.result(&tag, &time));
+            QCOMPARE(tag, i);
+        }
+        QVERIFY(!timer.result(&tag, &time));
+
+        // Go around the ring a few times with interleaved measures.
+        for (quint32 i = maxPendingQueries; i < 4 * maxPendingQueries; ++i) {
+            QVERIFY(timer.start());
+            functions->glClear(GL_COLOR_BUFFER_BIT);
+            timer.stop(i);
+            if (i % 2) {
+                functions->glFinish();
+                QVERIFY(timer.result(&tag, &time));
+                QCOMPARE(tag, i - 1);
+                QVERIFY(timer.result(&tag, &time));
+                QCOMPARE(tag, i);
+            }
+        }
+        QVERIFY(!timer.result(&tag, &time));
+
+        timer.finalize();
+        QVERIFY(!timer.isAvailable());
+        context.doneCurrent();
+    }
+
+    void test_event_queue_capacity()
+    {
+        QCOMPARE(EventQueue(1).capacity(), 1);
+        QCOMPARE(EventQueue(100).capacity(), 128);
+        QCOMPARE(EventQueue(128).capacity(), 128);
+        QCOMPARE(SharedEventQueue(1).capacity(), 1);
+        QCOMPARE(SharedEventQueue(100).capacity(), 128);
+        QCOMPARE(SharedEventQueue(128).capacity(), 128);
+    }
+
+    void test_event_queue_full_and_empty()
+    {
+        QVERIFY(checkQueueFullAndEmpty<EventQueue>());
+        QVERIFY(checkQueueFullAndEmpty<SharedEventQueue>());
+    }
+
+    void test_event_queue_wrap_around()
+    {
+        QVERIFY(checkQueueWrapAround<EventQueue>());
+        QVERIFY(checkQueueWrapAround<SharedEventQueue>());
+    }
+
+    // a producer thread pushing through a small ring while the consumer pops
+    void test_event_queue_single_producer()
+    {
+        const quint32 eventCount = 100000;
+        EventQueue queue(16);
+        std::thread producer([&queue, eventCount]() {
+            for (quint32 i = 0; i < eventCount; ++i) {
+                while (!queue.push(frameEvent(0, i))) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        UMEvent events[8];
+        quint32 expected = 0;
+        bool ordered = true;
+        while (expected < eventCount) {
+            const int count = queue.pop(events, 8);
+            for (int i = 0; i < count; ++i) {
+                ordered &= events[i].frame.number == expected++;
+            }
+            if (count == 0) {
+                std::this_thread::yield();
+            }
+        }
+        producer.join();
+        QVERIFY(ordered);
+        QVERIFY(queue.isEmpty());
+    }
+
+    // producers racing for the slots of a small ring, each of them must see its
+    // own events popped in order and none must be lost or duplicated
+    void test_event_queue_multiple_producers()
+    {
+        const int producerCount = 4;
+        const quint32 eventCount = 50000;
+        SharedEventQueue queue(16);
+        std::vector<std::thread> producers;
+        for (int p = 0; p < producerCount; ++p) {
+            producers.emplace_back([&queue, p, eventCount]() {
+                for (quint32 i = 0; i < eventCount; ++i) {
+                    while (!queue.push(frameEvent(p, i))) {
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+
+        UMEvent events[8];
+        quint32 expected[producerCount] = {};
+        quint32 total = 0;
+        bool ordered = true;
+        while (total < producerCount * eventCount) {
+            const int count = queue.pop(events, 8);
+            for (int i = 0; i < count; ++i) {
+                const quint32 window = events[i].frame.window;
+                ordered &= window < static_cast<quint32>(producerCount)
+                    && events[i].frame.number == expected[window]++;
+            }
+            total += count;
+            if (count == 0) {
+                std::this_thread::yield();
+            }
+        }
+        for (std::thread& producer : producers) {
+            producer.join();
+        }
+        QVERIFY(ordered);
+        QVERIFY(queue.isEmpty());
+        for (int p = 0; p < producerCount; ++p) {
+            QCOMPARE(expected[p], eventCount);
+        }
+    }
+};
+
+QTEST_MAIN(tst_ApplicationMonitor)
+
+#include "tst_applicationmonitor.moc"
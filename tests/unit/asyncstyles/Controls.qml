@@ -0,0 +1,41 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import QtQuick 2.4
+import Ubuntu.Components 1.3
+
+Item {
+    width: units.gu(40)
+    height: units.gu(40)
+
+    // only the audited components incubate their style
+    CheckBox {
+        objectName: "checkBox"
+    }
+    Switch {
+        objectName: "switch"
+        x: units.gu(20)
+    }
+    ProgressBar {
+        objectName: "offScreenProgressBar"
+        y: units.gu(200)
+    }
+    Button {
+        objectName: "button"
+        y: units.gu(10)
+        text: "Button"
+    }
+}
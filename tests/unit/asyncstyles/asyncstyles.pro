@@ -0,0 +1,8 @@
+include(../test-include-x11.pri)
+QT += core-private qml-private quick-private gui-private UbuntuToolkit
+
+SOURCES += \
+    tst_asyncstyles.cpp
+
+DISTFILES += \
+    Controls.qml
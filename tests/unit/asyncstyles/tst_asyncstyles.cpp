@@ -0,0 +1,119 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtQml/QQmlEngine>
+#include <QtQuick/QQuickView>
+#include <QtTest/QtTest>
+#include <UbuntuToolkit/private/ucstyleditembase_p.h>
+#include <UbuntuToolkit/private/ucstyleditembase_p_p.h>
+
+UT_USE_NAMESPACE
+
+class tst_AsyncStyles : public QObject
+{
+    Q_OBJECT
+
+private:
+    // the view is shown first so the items are on screen while their styles incubate
+    QQuickView *createView(const QString &file)
+    {
+        QQuickView *view = new QQuickView;
+        view->engine()->addImportPath(QDir(UBUNTU_QML_IMPORT_PATH).absolutePath());
+        view->resize(400, 400);
+        view->show();
+        if (!QTest::qWaitForWindowExposed(view)) {
+            delete view;
+            return Q_NULLPTR;
+        }
+        view->setSource(QUrl::fromLocalFile(file));
+        return view;
+    }
+
+    QQuickItem *styleInstance(QQuickView *view, const QString &objectName)
+    {
+        UCStyledItemBase *item = view->rootObject()->findChild<UCStyledItemBase*>(objectName);
+        return item ? UCStyledItemBasePrivate::get(item)->styleItem : Q_NULLPTR;
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        // must be set before the first styled item is completed
+        qputenv("UC_ASYNC_STYLES", "1");
+    }
+
+    void test_styles_incubated_data()
+    {
+        QTest::addColumn<QString>("objectName");
+
+        QTest::newRow("CheckBox") << "checkBox";
+        QTest::newRow("Switch") << "switch";
+        QTest::newRow("off screen ProgressBar") << "offScreenProgressBar";
+    }
+    void test_styles_incubated()
+    {
+        QFETCH(QString, objectName);
+
+        QScopedPointer<QQuickView> view(createView("Controls.qml"));
+        QVERIFY(view && view->rootObject());
+        UCStyledItemBase *item = view->rootObject()->findChild<UCStyledItemBase*>(objectName);
+        QVERIFY(item);
+        // nothing is created before the event loop runs
+        QVERIFY(!styleInstance(view.data(), objectName));
+
+        QTRY_VERIFY(styleInstance(view.data(), objectName));
+        // the style sets the implicit size
+        QVERIFY(item->implicitWidth() > 0.0);
+    }
+
+    // QML completes the components in reverse order, the off screen ProgressBar first
+    void test_on_screen_style_incubated_first()
+    {
+        QScopedPointer<QQuickView> view(createView("Controls.qml"));
+        QVERIFY(view && view->rootObject());
+        UCStyledItemBase *checkBox = view->rootObject()->findChild<UCStyledItemBase*>("checkBox");
+        UCStyledItemBase *progressBar =
+            view->rootObject()->findChild<UCStyledItemBase*>("offScreenProgressBar");
+        QVERIFY(checkBox && progressBar);
+        bool checkBoxStyled = false;
+        connect(progressBar, &UCStyledItemBase::styleInstanceChanged, progressBar, [&] {
+            checkBoxStyled = styleInstance(view.data(), "checkBox") != Q_NULLPTR;
+        });
+
+        QTRY_VERIFY(styleInstance(view.data(), "offScreenProgressBar"));
+        QVERIFY(checkBoxStyled);
+    }
+
+    void test_not_audited_style_created_synchronously()
+    {
+        QScopedPointer<QQuickView> view(createView("Controls.qml"));
+        QVERIFY(view && view->rootObject());
+        QVERIFY(styleInstance(view.data(), "button"));
+    }
+
+    void test_incubation_cancelled()
+    {
+        QQuickView *view = createView("Controls.qml");
+        QVERIFY(view && view->rootObject());
+        // deleting the items while their styles incubate must not crash
+        delete view;
+        QTest::qWait(100);
+    }
+};
+
+QTEST_MAIN(tst_AsyncStyles)
+
+#include "tst_asyncstyles.moc"
@@ -0,0 +1,3 @@
+INCLUDEPATH += $$PWD
+HEADERS += $$PWD/benchmarkutils.h
+SOURCES += $$PWD/benchmarkutils.cpp
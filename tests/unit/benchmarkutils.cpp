@@ -0,0 +1,185 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "benchmarkutils.h"
+
+#include <algorithm>
+
+#include <QtCore/QFile>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QLockFile>
+
+#if defined(__GLIBC__)
+#include <errno.h>
+#include <malloc.h>
+
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t count, size_t size);
+extern "C" void *__libc_realloc(void *pointer, size_t size);
+extern "C" void *__libc_memalign(size_t alignment, size_t size);
+extern "C" void __libc_free(void *pointer);
+
+static quint64 allocationCounter = 0;
+static quint64 allocatedByteCounter = 0;
+static qint64 heapByteCounter = 0;
+
+static void *trackAllocation(void *pointer)
+{
+    if (pointer) {
+        const size_t size = malloc_usable_size(pointer);
+        __atomic_fetch_add(&allocationCounter, 1, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&allocatedByteCounter, size, __ATOMIC_RELAXED);
+        __atomic_fetch_add(&heapByteCounter, size, __ATOMIC_RELAXED);
+    }
+    return pointer;
+}
+
+extern "C" void *malloc(size_t size)
+{
+    return trackAllocation(__libc_malloc(size));
+}
+
+extern "C" void *calloc(size_t count, size_t size)
+{
+    return trackAllocation(__libc_calloc(count, size));
+}
+
+extern "C" void *realloc(void *pointer, size_t size)
+{
+    const size_t oldSize = pointer ? malloc_usable_size(pointer) : 0;
+    void *newPointer = __libc_realloc(pointer, size);
+    if (newPointer || size == 0) {
+        __atomic_fetch_sub(&heapByteCounter, oldSize, __ATOMIC_RELAXED);
+    }
+    return trackAllocation(newPointer);
+}
+
+extern "C" void *memalign(size_t alignment, size_t size)
+{
+    return trackAllocation(__libc_memalign(alignment, size));
+}
+
+extern "C" void *aligned_alloc(size_t alignment, size_t size)
+{
+    return trackAllocation(__libc_memalign(alignment, size));
+}
+
+extern "C" int posix_memalign(void **pointer, size_t alignment, size_t size)
+{
+    if (alignment % sizeof(void*) || (alignment & (alignment - 1))) {
+        return EINVAL;
+    }
+    void *newPointer = trackAllocation(__libc_memalign(alignment, size));
+    if (!newPointer) {
+        return ENOMEM;
+    }
+    *pointer = newPointer;
+    return 0;
+}
+
+extern "C" void free(void *pointer)
+{
+    if (pointer) {
+        __atomic_fetch_sub(&heapByteCounter, malloc_usable_size(pointer), __ATOMIC_RELAXED);
+    }
+    __libc_free(pointer);
+}
+
+bool BenchmarkUtils::hasHeapTracking()
+{
+    return true;
+}
+
+quint64 BenchmarkUtils::allocationCount()
+{
+    return __atomic_load_n(&allocationCounter, __ATOMIC_RELAXED);
+}
+
+quint64 BenchmarkUtils::allocatedBytes()
+{
+    return __atomic_load_n(&allocatedByteCounter, __ATOMIC_RELAXED);
+}
+
+qint64 BenchmarkUtils::heapBytes()
+{
+    return __atomic_load_n(&heapByteCounter, __ATOMIC_RELAXED);
+}
+#else
+bool BenchmarkUtils::hasHeapTracking() { return false; }
+quint64 BenchmarkUtils::allocationCount() { return 0; }
+quint64 BenchmarkUtils::allocatedBytes() { return 0; }
+qint64 BenchmarkUtils::heapBytes() { return 0; }
+#endif
+
+quint64 BenchmarkUtils::percentile(const QVector<quint64> &sortedValues, int percentile)
+{
+    if (sortedValues.isEmpty()) {
+        return 0;
+    }
+    const int rank = qMax((percentile * sortedValues.size() + 99) / 100, 1);
+    return sortedValues.at(rank - 1);
+}
+
+QJsonObject BenchmarkUtils::durationStatistics(QVector<quint64> durations)
+{
+    std::sort(durations.begin(), durations.end());
+    QJsonObject object;
+    object.insert(QStringLiteral("p50"), percentile(durations, 50) / 1000000.0);
+    object.insert(QStringLiteral("p90"), percentile(durations, 90) / 1000000.0);
+    object.insert(QStringLiteral("p99"), percentile(durations, 99) / 1000000.0);
+    object.insert(QStringLiteral("max"),
+                  (durations.isEmpty() ? 0 : durations.last()) / 1000000.0);
+    return object;
+}
+
+bool BenchmarkUtils::writeResults(const QString &key, const QJsonValue &results, QString *error)
+{
+    const QString fileName = QString::fromLocal8Bit(qgetenv("UITK_BENCHMARK_JSON"));
+    if (fileName.isEmpty()) {
+        return true;
+    }
+
+    // The tests can be run in parallel.
+    QLockFile lock(fileName + QStringLiteral(".lock"));
+    if (!lock.lock()) {
+        *error = QStringLiteral("Can't lock '%1'").arg(fileName);
+        return false;
+    }
+
+    QFile file(fileName);
+    if (!file.open(QIODevice::ReadWrite)) {
+        *error = QStringLiteral("Can't open '%1'").arg(fileName);
+        return false;
+    }
+    QJsonObject root;
+    const QByteArray content = file.readAll();
+    if (!content.trimmed().isEmpty()) {
+        const QJsonDocument document = QJsonDocument::fromJson(content);
+        if (!document.isObject()) {
+            *error = QStringLiteral("Invalid JSON in '%1'").arg(fileName);
+            return false;
+        }
+        root = document.object();
+    }
+    root.insert(key, results);
+
+    const QByteArray json = QJsonDocument(root).toJson();
+    if (!file.resize(0) || !file.seek(0) || file.write(json) != json.size()) {
+        *error = QStringLiteral("Can't write '%1'").arg(fileName);
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,60 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef BENCHMARKUTILS_H
+#define BENCHMARKUTILS_H
+
+#include <QtCore/QJsonObject>
+#include <QtCore/QJsonValue>
+#include <QtCore/QString>
+#include <QtCore/QVector>
+
+/*
+ * Helpers shared by the benchmarks writing machine-readable results.
+ *
+ * The heap is tracked by interposing the glibc allocation functions in the
+ * test executable, which catches the allocations of the toolkit, Qt and the
+ * C++ runtime. The JavaScript heap of the QML engine isn't accounted.
+ */
+namespace BenchmarkUtils {
+
+// Whether the heap is tracked, the counters below stay at 0 otherwise.
+bool hasHeapTracking();
+
+// Number of allocations and number of bytes allocated since the start.
+quint64 allocationCount();
+quint64 allocatedBytes();
+
+// Number of heap bytes currently allocated.
+qint64 heapBytes();
+
+// Returns the value at the given percentile (nearest rank) of sorted values.
+quint64 percentile(const QVector<quint64> &sortedValues, int percentile);
+
+// Returns the 50th, 90th and 99th percentiles and the maximum of a set of
+// durations in nanoseconds, as milliseconds keyed by "p50", "p90", "p99" and
+// "max".
+QJsonObject durationStatistics(QVector<quint64> durations);
+
+// Stores the results of a test under the given key of the JSON object written
+// in the file set in UITK_BENCHMARK_JSON. The keys written by the other tests
+// are kept so that a test run fills a single file. Returns true if the
+// variable isn't set, false and sets error if the file can't be written.
+bool writeResults(const QString &key, const QJsonValue &results, QString *error);
+
+}
+
+#endif  // BENCHMARKUTILS_H
@@ -0,0 +1,5 @@
+include(../test-include.pri)
+include(../qtprivate_dependency.pri)
+include(../benchmark_dependency.pri)
+
+SOURCES += tst_components_memory.cpp
@@ -0,0 +1,304 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtCore/QDir>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QUrl>
+#include <QtCore/private/qhooks_p.h>
+#include <QtQml/QQmlComponent>
+#include <QtQml/QQmlEngine>
+#include <QtQml/private/qqmlabstractbinding_p.h>
+#include <QtQml/private/qqmldata_p.h>
+#include <QtQuick/QQuickItem>
+#include <QtQuick/QQuickWindow>
+#include <QtQuick/QSGRendererInterface>
+#include <QtQuick/private/qquickitem_p.h>
+#include <QtTest/QtTest>
+
+#include "benchmarkutils.h"
+#include "ucnamespace.h"
+
+/*
+ * Memory footprint of the components, for one instance and for 1000 instances
+ * of each Components and ListItems document:
+ *
+ *   heapBytes: heap bytes still allocated once the instances are created.
+ *   allocatedBytes: heap bytes allocated while creating the instances.
+ *   objects: QObjects still alive once the instances are created.
+ *   items: QQuickItems in the visual trees of the instances.
+ *   bindings: QML bindings set on the objects of the instances.
+ *   nodes: scene graph nodes of the instances, rendered with the software
+ *       adaptation. Not set if the window can't be rendered.
+ *
+ * The heap is tracked by benchmarkutils.h. The results are written as JSON to
+ * the file set in UITK_BENCHMARK_JSON under the "components" key, the heap
+ * bytes per instance are reported as the benchmark result of the regular
+ * output.
+ */
+
+// QObjects are counted with the hooks used by the debugging tools.
+static qint64 objectCount = 0;
+static QHooks::AddQObjectCallback previousAddQObject = Q_NULLPTR;
+static QHooks::RemoveQObjectCallback previousRemoveQObject = Q_NULLPTR;
+
+static void addQObject(QObject *object)
+{
+    __atomic_fetch_add(&objectCount, 1, __ATOMIC_RELAXED);
+    if (previousAddQObject) {
+        previousAddQObject(object);
+    }
+}
+
+static void removeQObject(QObject *object)
+{
+    __atomic_fetch_sub(&objectCount, 1, __ATOMIC_RELAXED);
+    if (previousRemoveQObject) {
+        previousRemoveQObject(object);
+    }
+}
+
+struct Footprint
+{
+    qint64 heapBytes;
+    quint64 allocatedBytes;
+    qint64 objects;
+    int items;
+    int bindings;
+    int nodes;
+};
+
+class tst_components_memory: public QObject
+{
+    Q_OBJECT
+
+private:
+    QQmlEngine *engine;
+    QQuickWindow *window;
+    QJsonArray results;
+
+    static qint64 currentObjectCount() { return __atomic_load_n(&objectCount, __ATOMIC_RELAXED); }
+
+    void addDocuments(const QString &path)
+    {
+        QDir dir(path);
+        QVERIFY2(dir.exists(), qPrintable(dir.absolutePath()));
+        dir.setNameFilters(QStringList() << "*.qml");
+        dir.setFilter(QDir::Files | QDir::Hidden | QDir::NoSymLinks);
+        dir.setSorting(QDir::Name);
+        QFileInfoList list = dir.entryInfoList();
+        QVERIFY2(list.size(), qPrintable(dir.absolutePath()));
+
+        for (int i = 0; i < list.size(); ++i) {
+            const QString fileName = list.at(i).absoluteFilePath();
+            const QString name = QDir(UBUNTU_COMPONENT_PATH).relativeFilePath(fileName);
+            QTest::newRow(qPrintable(name + " x1")) << fileName << 1;
+            QTest::newRow(qPrintable(name + " x1000")) << fileName << 1000;
+        }
+    }
+
+    static void flushDeletions()
+    {
+        QCoreApplication::sendPostedEvents(Q_NULLPTR, QEvent::DeferredDelete);
+        QCoreApplication::processEvents();
+    }
+
+    static int countItems(QQuickItem *item)
+    {
+        int count = 1;
+        Q_FOREACH(QQuickItem *child, item->childItems()) {
+            count += countItems(child);
+        }
+        return count;
+    }
+
+    static int countBindings(QObject *object)
+    {
+        int count = 0;
+        QList<QObject*> objects = object->findChildren<QObject*>();
+        objects.prepend(object);
+        Q_FOREACH(QObject *child, objects) {
+            QQmlData *data = QQmlData::get(child);
+            for (QQmlAbstractBinding *binding = data ? data->bindings : Q_NULLPTR; binding;
+                 binding = binding->nextBinding()) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    static int countNodes(QSGNode *node)
+    {
+        int count = 1;
+        for (QSGNode *child = node->firstChild(); child; child = child->nextSibling()) {
+            count += countNodes(child);
+        }
+        return count;
+    }
+
+    // Renders a frame, returns false if the window can't be rendered.
+    bool renderFrame()
+    {
+        if (!window->isExposed()) {
+            return false;
+        }
+        QSignalSpy spy(window, SIGNAL(frameSwapped()));
+        window->update();
+        return spy.wait(5000);
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        QString modules(UBUNTU_QML_IMPORT_PATH);
+        QVERIFY(QDir(modules).exists());
+        if (!BenchmarkUtils::hasHeapTracking()) {
+            QSKIP("The heap can't be tracked.");
+        }
+
+        // The software adaptation allows to get the scene graph nodes without
+        // OpenGL.
+        QQuickWindow::setSceneGraphBackend(QSGRendererInterface::Software);
+
+        previousAddQObject =
+            reinterpret_cast<QHooks::AddQObjectCallback>(qtHookData[QHooks::AddQObject]);
+        previousRemoveQObject =
+            reinterpret_cast<QHooks::RemoveQObjectCallback>(qtHookData[QHooks::RemoveQObject]);
+        qtHookData[QHooks::AddQObject] = reinterpret_cast<quintptr>(&addQObject);
+        qtHookData[QHooks::RemoveQObject] = reinterpret_cast<quintptr>(&removeQObject);
+
+        engine = new QQmlEngine;
+        QStringList imports = engine->importPathList();
+        imports.prepend(QDir(modules).absolutePath());
+        engine->setImportPathList(imports);
+
+        window = new QQuickWindow;
+        window->setGeometry(0, 0, 240, 320);
+        window->show();
+        QTest::qWaitForWindowExposed(window);
+    }
+
+    void cleanupTestCase()
+    {
+        delete window;
+        delete engine;
+        qtHookData[QHooks::AddQObject] = reinterpret_cast<quintptr>(previousAddQObject);
+        qtHookData[QHooks::RemoveQObject] = reinterpret_cast<quintptr>(previousRemoveQObject);
+
+        QString error;
+        QVERIFY2(BenchmarkUtils::writeResults(QStringLiteral("components"), results, &error),
+                 qPrintable(error));
+    }
+
+    void benchmark_memory_data()
+    {
+        QTest::addColumn<QString>("fileName");
+        QTest::addColumn<int>("instanceCount");
+
+        addDocuments(QString("%1/%2.%3").arg(UBUNTU_COMPONENT_PATH)
+                     .arg(MAJOR_VERSION(LATEST_UITK_VERSION))
+                     .arg(MINOR_VERSION(LATEST_UITK_VERSION)));
+        addDocuments(QString("%1/ListItems/%2.%3").arg(UBUNTU_COMPONENT_PATH)
+                     .arg(MAJOR_VERSION(LATEST_UITK_VERSION))
+                     .arg(MINOR_VERSION(LATEST_UITK_VERSION)));
+    }
+
+    void benchmark_memory()
+    {
+        QFETCH(QString, fileName);
+        QFETCH(int, instanceCount);
+
+        // Compile the document and create a first instance so that the
+        // caches and the one time allocations aren't accounted.
+        QQmlComponent component(engine, QUrl::fromLocalFile(fileName));
+        QObject *warmUp = component.create();
+        if (!warmUp) {
+            QSKIP(qPrintable(QStringLiteral("Can't create ") + component.errorString()));
+        }
+        delete warmUp;
+        flushDeletions();
+
+        QQuickItem *container = new QQuickItem;
+        container->setParentItem(window->contentItem());
+        renderFrame();
+        flushDeletions();
+
+        Footprint footprint;
+        const qint64 heapBytesBefore = BenchmarkUtils::heapBytes();
+        const quint64 allocatedBytesBefore = BenchmarkUtils::allocatedBytes();
+        const qint64 objectCountBefore = currentObjectCount();
+        QList<QObject*> instances;
+        for (int i = 0; i < instanceCount; ++i) {
+            QObject *instance = component.create();
+            QVERIFY(instance);
+            if (QQuickItem *item = qobject_cast<QQuickItem*>(instance)) {
+                item->setParentItem(container);
+            }
+            instances.append(instance);
+        }
+        flushDeletions();
+        footprint.heapBytes = BenchmarkUtils::heapBytes() - heapBytesBefore;
+        footprint.allocatedBytes = BenchmarkUtils::allocatedBytes() - allocatedBytesBefore;
+        footprint.objects = currentObjectCount() - objectCountBefore;
+
+        footprint.items = 0;
+        footprint.bindings = 0;
+        Q_FOREACH(QObject *instance, instances) {
+            if (QQuickItem *item = qobject_cast<QQuickItem*>(instance)) {
+                footprint.items += countItems(item);
+            }
+            footprint.bindings += countBindings(instance);
+        }
+
+        footprint.nodes = -1;
+        if (renderFrame()) {
+            footprint.nodes = 0;
+            Q_FOREACH(QObject *instance, instances) {
+                QQuickItem *item = qobject_cast<QQuickItem*>(instance);
+                QSGNode *node = item ? QQuickItemPrivate::get(item)->itemNodeInstance : Q_NULLPTR;
+                if (node) {
+                    footprint.nodes += countNodes(node);
+                }
+            }
+        }
+
+        qDeleteAll(instances);
+        delete container;
+        flushDeletions();
+
+        QJsonObject result;
+        result.insert(QStringLiteral("name"),
+                      QDir(UBUNTU_COMPONENT_PATH).relativeFilePath(fileName));
+        result.insert(QStringLiteral("instances"), instanceCount);
+        result.insert(QStringLiteral("heapBytes"), static_cast<double>(footprint.heapBytes));
+        result.insert(QStringLiteral("allocatedBytes"),
+                      static_cast<double>(footprint.allocatedBytes));
+        result.insert(QStringLiteral("objects"), static_cast<double>(footprint.objects));
+        result.insert(QStringLiteral("items"), footprint.items);
+        result.insert(QStringLiteral("bindings"), footprint.bindings);
+        if (footprint.nodes >= 0) {
+            result.insert(QStringLiteral("nodes"), footprint.nodes);
+        }
+        results.append(result);
+
+        QTest::setBenchmarkResult(
+            static_cast<qreal>(footprint.heapBytes) / instanceCount, QTest::BytesAllocated);
+    }
+};
+
+QTEST_MAIN(tst_components_memory)
+
+#include "tst_components_memory.moc"
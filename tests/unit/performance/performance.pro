@@ -1,4 +1,5 @@
 include(../test-include.pri)
+include(../benchmark_dependency.pri)
 SOURCES += tst_performance.cpp
 DEFINES += SRCDIR=\\\"$$PWD/\\\"
 
@@ -15,12 +15,232 @@
  */
 
 #include <QtCore/QCoreApplication>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonDocument>
+#include <QtCore/QJsonObject>
 #include <QtCore/QString>
 #include <QtQml/QQmlEngine>
 #include <QtQuick/QQuickItem>
 #include <QtQuick/QQuickView>
 #include <QtTest/QtTest>
 
+#include "benchmarkutils.h"
+
+#if defined(Q_OS_LINUX)
+#include <linux/perf_event.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+/*
+ * Machine-readable results. Besides the regular QtTest output, each benchmark
+ * can record its time, instruction count and allocation count per iteration:
+ *
+ *   UITK_BENCHMARK_JSON=<file>: writes the results as JSON, under the
+ *       "benchmarks" key.
+ *   UITK_BENCHMARK_BASELINE=<file>: compares the results against a JSON file
+ *       previously written, a benchmark fails if one of its metrics regresses
+ *       more than the allowed percentage.
+ *   UITK_BENCHMARK_MAX_REGRESSION=<percent>|<metric>=<percent>,...: allowed
+ *       regressions, 10% by default. Metrics are time, instructions and
+ *       allocations, for instance "time=25,instructions=2,allocations=0".
+ *
+ * Instructions are counted on the main thread with the perf counters when the
+ * kernel allows it (see /proc/sys/kernel/perf_event_paranoid), allocations are
+ * counted by the heap tracking of benchmarkutils.h. The -callgrind and -perf
+ * QtTest options can still be used for the regular output.
+ */
+
+class BenchmarkRecorder
+{
+public:
+    BenchmarkRecorder()
+        : m_instructionCounter(-1)
+        , m_iterations(0)
+        , m_time(0)
+        , m_instructions(0)
+        , m_allocations(0)
+    {
+    }
+
+    ~BenchmarkRecorder()
+    {
+#if defined(Q_OS_LINUX)
+        if (m_instructionCounter != -1) {
+            close(m_instructionCounter);
+        }
+#endif
+    }
+
+    // Reads the environment, returns false and sets error if the baseline or
+    // the regression thresholds are invalid.
+    bool initialize(QString *error)
+    {
+        m_maxRegressions.insert(QStringLiteral("time"), 10.0);
+        m_maxRegressions.insert(QStringLiteral("instructions"), 10.0);
+        m_maxRegressions.insert(QStringLiteral("allocations"), 10.0);
+        const QString maxRegression =
+            QString::fromLocal8Bit(qgetenv("UITK_BENCHMARK_MAX_REGRESSION"));
+        Q_FOREACH(const QString &item, maxRegression.split(',', QString::SkipEmptyParts)) {
+            const QStringList pair = item.split('=');
+            bool ok;
+            const double percent = pair.last().toDouble(&ok);
+            if (!ok || pair.size() > 2
+                || (pair.size() == 2 && !m_maxRegressions.contains(pair.first()))) {
+                *error = QStringLiteral("Invalid UITK_BENCHMARK_MAX_REGRESSION '%1'").arg(item);
+                return false;
+            }
+            if (pair.size() == 2) {
+                m_maxRegressions[pair.first()] = percent;
+            } else {
+                for (QHash<QString, double>::iterator it = m_maxRegressions.begin();
+                     it != m_maxRegressions.end(); ++it) {
+                    it.value() = percent;
+                }
+            }
+        }
+
+        const QString baselineFile = QString::fromLocal8Bit(qgetenv("UITK_BENCHMARK_BASELINE"));
+        if (!baselineFile.isEmpty()) {
+            QFile file(baselineFile);
+            if (!file.open(QIODevice::ReadOnly)) {
+                *error = QStringLiteral("Can't open baseline '%1'").arg(baselineFile);
+                return false;
+            }
+            const QJsonDocument document = QJsonDocument::fromJson(file.readAll());
+            if (!document.isObject()) {
+                *error = QStringLiteral("Invalid baseline '%1'").arg(baselineFile);
+                return false;
+            }
+            const QJsonArray benchmarks =
+                document.object().value(QStringLiteral("benchmarks")).toArray();
+            Q_FOREACH(const QJsonValue &benchmark, benchmarks) {
+                const QJsonObject object = benchmark.toObject();
+                m_baseline.insert(object.value(QStringLiteral("name")).toString(), object);
+            }
+        }
+
+#if defined(Q_OS_LINUX)
+        struct perf_event_attr attributes;
+        memset(&attributes, 0, sizeof(attributes));
+        attributes.type = PERF_TYPE_HARDWARE;
+        attributes.size = sizeof(attributes);
+        attributes.config = PERF_COUNT_HW_INSTRUCTIONS;
+        attributes.exclude_kernel = 1;
+        attributes.exclude_hv = 1;
+        m_instructionCounter = syscall(__NR_perf_event_open, &attributes, 0, -1, -1, 0);
+#endif
+        return true;
+    }
+
+    // Measures one benchmark iteration.
+    void begin()
+    {
+        m_beginInstructions = instructionCount();
+        m_beginAllocations = BenchmarkUtils::allocationCount();
+        m_timer.start();
+    }
+    void end()
+    {
+        m_time += m_timer.nsecsElapsed();
+        m_allocations += BenchmarkUtils::allocationCount() - m_beginAllocations;
+        m_instructions += instructionCount() - m_beginInstructions;
+        m_iterations++;
+    }
+
+    // Stores the per iteration averages of the benchmark measured since the
+    // last call and compares them against the baseline. Returns false and sets
+    // regression if a metric regressed more than allowed.
+    bool finish(const QString &name, QString *regression)
+    {
+        if (m_iterations == 0) {
+            return true;
+        }
+        QJsonObject result;
+        result.insert(QStringLiteral("name"), name);
+        result.insert(QStringLiteral("iterations"), static_cast<double>(m_iterations));
+        result.insert(QStringLiteral("time"), m_time / 1000000.0 / m_iterations);
+        if (m_instructionCounter != -1) {
+            result.insert(QStringLiteral("instructions"),
+                          static_cast<double>(m_instructions / m_iterations));
+        }
+        if (BenchmarkUtils::hasHeapTracking()) {
+            result.insert(QStringLiteral("allocations"),
+                          static_cast<double>(m_allocations / m_iterations));
+        }
+        m_results.append(result);
+        m_iterations = m_time = m_instructions = m_allocations = 0;
+
+        if (!m_baseline.contains(name)) {
+            return true;
+        }
+        const QJsonObject baseline = m_baseline.value(name);
+        QStringList regressions;
+        for (QHash<QString, double>::const_iterator it = m_maxRegressions.constBegin();
+             it != m_maxRegressions.constEnd(); ++it) {
+            if (!result.contains(it.key()) || !baseline.contains(it.key())) {
+                continue;
+            }
+            const double value = result.value(it.key()).toDouble();
+            const double baselineValue = baseline.value(it.key()).toDouble();
+            if (value > baselineValue * (1.0 + it.value() / 100.0)) {
+                regressions.append(QStringLiteral("%1 %2 -> %3 (+%4%, max +%5%)")
+                    .arg(it.key()).arg(baselineValue).arg(value)
+                    .arg(baselineValue > 0.0 ? (value / baselineValue - 1.0) * 100.0 : 100.0, 0,
+                         'f', 1)
+                    .arg(it.value()));
+            }
+        }
+        if (!regressions.isEmpty()) {
+            *regression = QStringLiteral("Regression: ") + regressions.join(QStringLiteral(", "));
+            return false;
+        }
+        return true;
+    }
+
+    bool write(QString *error)
+    {
+        return BenchmarkUtils::writeResults(QStringLiteral("benchmarks"), m_results, error);
+    }
+
+private:
+    quint64 instructionCount()
+    {
+        quint64 count = 0;
+#if defined(Q_OS_LINUX)
+        if (m_instructionCounter != -1
+            && read(m_instructionCounter, &count, sizeof(count)) != sizeof(count)) {
+            count = 0;
+        }
+#endif
+        return count;
+    }
+
+    QHash<QString, double> m_maxRegressions;
+    QHash<QString, QJsonObject> m_baseline;
+    QJsonArray m_results;
+    QElapsedTimer m_timer;
+    int m_instructionCounter;
+    quint64 m_beginInstructions;
+    quint64 m_beginAllocations;
+    quint64 m_iterations;
+    quint64 m_time;
+    quint64 m_instructions;
+    quint64 m_allocations;
+};
+
+// Records the enclosing benchmark iteration.
+class BenchmarkMeasure
+{
+public:
+    BenchmarkMeasure(BenchmarkRecorder *recorder) : m_recorder(recorder) { recorder->begin(); }
+    ~BenchmarkMeasure() { m_recorder->end(); }
+
+private:
+    BenchmarkRecorder *m_recorder;
+};
+
 class tst_Performance : public QObject
 {
     Q_OBJECT
@@ -31,6 +251,15 @@ public:
 private:
     QQuickView *quickView;
     QQmlEngine *quickEngine;
+    BenchmarkRecorder recorder;
+
+    void verifyBenchmark()
+    {
+        QString regression;
+        const QString name =
+            QStringLiteral("%1:%2").arg(QTest::currentTestFunction()).arg(QTest::currentDataTag());
+        QVERIFY2(recorder.finish(name, &regression), qPrintable(regression));
+    }
 
     QQuickItem *loadDocument(const QString &document)
     {
@@ -47,6 +276,9 @@ private Q_SLOTS:
         QString modules(UBUNTU_QML_IMPORT_PATH);
         QVERIFY(QDir(modules).exists());
 
+        QString error;
+        QVERIFY2(recorder.initialize(&error), qPrintable(error));
+
         quickView = new QQuickView(0);
         quickEngine = quickView->engine();
 
@@ -60,6 +292,8 @@ private Q_SLOTS:
     void cleanupTestCase()
     {
         delete quickView;
+        QString error;
+        QVERIFY2(recorder.write(&error), qPrintable(error));
     }
 
     void clean()
@@ -88,6 +322,7 @@ private Q_SLOTS:
         qputenv("SUPPRESS_DEPRECATED_NOTE", "yes");
         QQuickItem *root = 0;
         QBENCHMARK {
+            BenchmarkMeasure measure(&recorder);
             root = loadDocument(document);
             if (root && theme.isValid()) {
                 root->setProperty("newTheme", theme.toString());
@@ -95,6 +330,7 @@ private Q_SLOTS:
         }
         if (root)
             delete root;
+        verifyBenchmark();
     }
 
     void benchmark_GridOfComponents_data() {
@@ -142,6 +378,7 @@ private Q_SLOTS:
 
         QQuickItem *root = 0;
         QBENCHMARK {
+            BenchmarkMeasure measure(&recorder);
             root = loadDocument(document);
             if (root && theme.isValid()) {
                 root->setProperty("newTheme", theme.toString());
@@ -149,6 +386,7 @@ private Q_SLOTS:
         }
         if (root)
             delete root;
+        verifyBenchmark();
     }
 
     void benchmark_import_data()
@@ -163,8 +401,10 @@ private Q_SLOTS:
     {
         QFETCH(QString, document);
         QBENCHMARK {
+            BenchmarkMeasure measure(&recorder);
             loadDocument(document);
         }
+        verifyBenchmark();
     }
 };
 
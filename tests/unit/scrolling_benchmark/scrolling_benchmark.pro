@@ -0,0 +1,12 @@
+include(../test-include.pri)
+include(../qtprivate_dependency.pri)
+include(../benchmark_dependency.pri)
+QT += UbuntuMetrics
+SOURCES += tst_scrolling_benchmark.cpp
+DEFINES += SRCDIR=\\\"$$PWD/\\\"
+
+OTHER_FILES += \
+    ListViewOfListItem13.qml \
+    ListViewOfListItemLayout_labelsOnly.qml \
+    ListViewOfListItemLayout_complex1.qml \
+    ListViewOfListItemLayout_complex2.qml
@@ -0,0 +1,293 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QJsonArray>
+#include <QtCore/QJsonObject>
+#include <QtCore/QMutex>
+#include <QtCore/QPropertyAnimation>
+#include <QtCore/QVector>
+#include <QtQml/QQmlEngine>
+#include <QtQuick/QQuickView>
+#include <QtQuick/private/qquickitemview_p_p.h>
+#include <QtTest/QtTest>
+
+#include <UbuntuMetrics/applicationmonitor.h>
+
+#include "benchmarkutils.h"
+
+/*
+ * Frame rate of ListViews of toolkit delegates scrolled at fixed velocities.
+ * The content is scrolled by a linear animation driven by the render loop so
+ * that delegates are created and destroyed while frames are rendered, like
+ * when users flick a list. The frame events of the UMApplicationMonitor give
+ * the sync, render and delta times of each frame. The time spent by the GUI
+ * thread between the end of the animations and the synchronization, where the
+ * views create their delegates while polishing, is measured per frame along
+ * with the number of delegates created.
+ *
+ * The application monitor relies on OpenGL, run with QT_QPA_PLATFORM=offscreen
+ * on headless systems. The results are written as JSON to the file set in
+ * UITK_BENCHMARK_JSON under the "scrolling" key, the frame rate is reported as
+ * the benchmark result of the regular output.
+ */
+
+// Stores the frame events of the application monitor. Called from the logging
+// thread.
+class FrameCollector : public UMLogger
+{
+public:
+    void log(const UMEvent& event) Q_DECL_OVERRIDE
+    {
+        if (event.type == UMEvent::Frame) {
+            QMutexLocker locker(&m_mutex);
+            m_frames.append(event);
+        }
+    }
+    bool isOpen() Q_DECL_OVERRIDE { return true; }
+
+    QVector<UMEvent> takeFrames()
+    {
+        QMutexLocker locker(&m_mutex);
+        QVector<UMEvent> frames;
+        frames.swap(m_frames);
+        return frames;
+    }
+
+private:
+    QMutex m_mutex;
+    QVector<UMEvent> m_frames;
+};
+
+// Per frame polish time and delegates created. Appended at synchronization,
+// while the GUI thread is blocked.
+struct PolishFrame
+{
+    quint64 polishTime;
+    int delegateCount;
+};
+
+class tst_scrolling_benchmark: public QObject
+{
+    Q_OBJECT
+
+private:
+    QQuickView *quickView;
+    UMApplicationMonitor *monitor;
+    FrameCollector collector;
+    QJsonArray results;
+
+    QElapsedTimer polishTimer;
+    int delegateCount;
+    QVector<PolishFrame> polishFrames;
+
+    bool renderFrames(int count)
+    {
+        QSignalSpy spy(quickView, SIGNAL(frameSwapped()));
+        for (int i = 0; i < count; ++i) {
+            quickView->update();
+            if (!spy.wait(5000)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+public Q_SLOTS:
+    void windowAfterAnimating()
+    {
+        polishTimer.start();
+        delegateCount = 0;
+    }
+
+    void windowBeforeSynchronizing()
+    {
+        if (polishTimer.isValid()) {
+            const PolishFrame frame = {
+                static_cast<quint64>(polishTimer.nsecsElapsed()), delegateCount
+            };
+            polishFrames.append(frame);
+            polishTimer.invalidate();
+        }
+    }
+
+    void delegateCreated()
+    {
+        delegateCount++;
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        QString modules(UBUNTU_QML_IMPORT_PATH);
+        QVERIFY(QDir(modules).exists());
+
+        quickView = new QQuickView(0);
+        quickView->setResizeMode(QQuickView::SizeViewToRootObject);
+        QStringList imports = quickView->engine()->importPathList();
+        imports.prepend(QDir(modules).absolutePath());
+        quickView->engine()->setImportPathList(imports);
+        connect(quickView, SIGNAL(afterAnimating()), this, SLOT(windowAfterAnimating()),
+                Qt::DirectConnection);
+        connect(quickView, SIGNAL(beforeSynchronizing()), this, SLOT(windowBeforeSynchronizing()),
+                Qt::DirectConnection);
+
+        monitor = UMApplicationMonitor::instance();
+        QVERIFY(monitor->installLogger(&collector));
+        monitor->setLoggingFilter(UMApplicationMonitor::FrameEvent);
+        monitor->setLogging(true);
+    }
+
+    void cleanupTestCase()
+    {
+        delete quickView;
+        monitor->setLogging(false);
+        monitor->removeLogger(&collector, false);
+
+        QString error;
+        QVERIFY2(BenchmarkUtils::writeResults(QStringLiteral("scrolling"), results, &error),
+                 qPrintable(error));
+    }
+
+    void benchmark_scrolling_data()
+    {
+        QTest::addColumn<QString>("document");
+        QTest::addColumn<int>("velocity");
+
+        const char *documents[] = {
+            "ListViewOfListItem13.qml",
+            "ListViewOfListItemLayout_labelsOnly.qml",
+            "ListViewOfListItemLayout_complex1.qml",
+            "ListViewOfListItemLayout_complex2.qml"
+        };
+        const int velocities[] = { 1000, 4000 };
+        for (const char *document : documents) {
+            for (int velocity : velocities) {
+                const QString tag = QStringLiteral("%1 at %2 px/s").arg(document).arg(velocity);
+                QTest::newRow(qPrintable(tag)) << QString(document) << velocity;
+            }
+        }
+    }
+
+    void benchmark_scrolling()
+    {
+        QFETCH(QString, document);
+        QFETCH(int, velocity);
+        const int duration = 3000;
+
+        quickView->setSource(QUrl::fromLocalFile(SRCDIR + document));
+        QQuickItemView *view = qobject_cast<QQuickItemView*>(quickView->rootObject());
+        QVERIFY2(view, qPrintable(document));
+        QObject *model = QQuickItemViewPrivate::get(view)->model;
+        QVERIFY(model);
+        connect(model, SIGNAL(createdItem(int,QObject*)), this, SLOT(delegateCreated()),
+                Qt::DirectConnection);
+
+        quickView->show();
+        QVERIFY(QTest::qWaitForWindowExposed(quickView));
+        if (!renderFrames(2)) {
+            QSKIP("The scene graph can't be rendered.");
+        }
+        collector.takeFrames();
+
+        QPropertyAnimation animation(view, "contentY");
+        animation.setStartValue(view->contentY());
+        animation.setEndValue(view->contentY() + velocity * duration / 1000.0);
+        animation.setDuration(duration);
+        QSignalSpy finishedSpy(&animation, SIGNAL(finished()));
+
+        polishFrames.clear();
+        const quint64 startTime = UMEventUtils::timeStamp();
+        animation.start();
+        QVERIFY(finishedSpy.wait(duration + 10000));
+        const quint64 endTime = UMEventUtils::timeStamp();
+        const QVector<PolishFrame> scrollPolishFrames = polishFrames;
+
+        // Frame events are delayed until the GPU times are available, render
+        // a few more frames and let the logging thread catch up.
+        renderFrames(8);
+        QTest::qWait(100);
+        quickView->hide();
+        disconnect(model, SIGNAL(createdItem(int,QObject*)), this, SLOT(delegateCreated()));
+
+        // The first frame is skipped since its delta time includes the idle
+        // time before the animation started.
+        QVector<quint64> deltaTimes, syncTimes, renderTimes, gpuTimes, polishTimes;
+        bool first = true;
+        Q_FOREACH(const UMEvent &event, collector.takeFrames()) {
+            if (event.timeStamp <= startTime || event.timeStamp > endTime) {
+                continue;
+            }
+            if (first) {
+                first = false;
+                continue;
+            }
+            deltaTimes.append(event.frame.deltaTime);
+            syncTimes.append(event.frame.syncTime);
+            renderTimes.append(event.frame.renderTime);
+            if (event.frame.gpuTime) {
+                gpuTimes.append(event.frame.gpuTime);
+            }
+        }
+        QVERIFY2(deltaTimes.size(), "No frame events logged.");
+
+        int delegatesCreated = 0;
+        quint64 creationPolishTime = 0;
+        Q_FOREACH(const PolishFrame &frame, scrollPolishFrames) {
+            polishTimes.append(frame.polishTime);
+            if (frame.delegateCount) {
+                delegatesCreated += frame.delegateCount;
+                creationPolishTime += frame.polishTime;
+            }
+        }
+
+        quint64 totalTime = 0;
+        Q_FOREACH(quint64 deltaTime, deltaTimes) {
+            totalTime += deltaTime;
+        }
+        const qreal framesPerSecond = deltaTimes.size() * 1000000000.0 / totalTime;
+
+        QJsonObject result;
+        result.insert(QStringLiteral("document"), document);
+        result.insert(QStringLiteral("velocity"), velocity);
+        result.insert(QStringLiteral("frames"), deltaTimes.size());
+        result.insert(QStringLiteral("framesPerSecond"), framesPerSecond);
+        result.insert(QStringLiteral("deltaTime"),
+                      BenchmarkUtils::durationStatistics(deltaTimes));
+        result.insert(QStringLiteral("syncTime"),
+                      BenchmarkUtils::durationStatistics(syncTimes));
+        result.insert(QStringLiteral("renderTime"),
+                      BenchmarkUtils::durationStatistics(renderTimes));
+        if (!gpuTimes.isEmpty()) {
+            result.insert(QStringLiteral("gpuTime"),
+                          BenchmarkUtils::durationStatistics(gpuTimes));
+        }
+        result.insert(QStringLiteral("polishTime"),
+                      BenchmarkUtils::durationStatistics(polishTimes));
+        result.insert(QStringLiteral("delegatesCreated"), delegatesCreated);
+        // Polish time of the frames creating delegates divided by the number
+        // of delegates created, an upper bound since it includes the layout.
+        result.insert(QStringLiteral("delegateCreationTime"),
+                      delegatesCreated ? creationPolishTime / 1000000.0 / delegatesCreated : 0.0);
+        results.append(result);
+
+        QTest::setBenchmarkResult(framesPerSecond, QTest::FramesPerSecond);
+    }
+};
+
+QTEST_MAIN(tst_scrolling_benchmark)
+
+#include "tst_scrolling_benchmark.moc"
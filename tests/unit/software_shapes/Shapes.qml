@@ -0,0 +1,57 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+import QtQuick 2.4
+import Ubuntu.Components 1.3
+import Ubuntu.Components.Private 1.3
+
+Item {
+    width: 200
+    height: 200
+
+    UbuntuShape {
+        objectName: "shape"
+        width: 50
+        height: 50
+        backgroundColor: "red"
+    }
+    UbuntuShape {
+        objectName: "identicalShape"
+        x: 60
+        width: 50
+        height: 50
+        backgroundColor: "red"
+    }
+    UbuntuShapeOverlay {
+        objectName: "overlay"
+        y: 60
+        width: 50
+        height: 50
+        backgroundColor: "blue"
+        overlayColor: "green"
+        overlayRect: Qt.rect(0.0, 0.0, 0.5, 0.5)
+    }
+    Frame {
+        objectName: "frame"
+        x: 60
+        y: 60
+        width: 50
+        height: 50
+        thickness: 4
+        radius: 10
+        color: "black"
+    }
+}
@@ -0,0 +1,5 @@
+include(../test-include.pri)
+SOURCES += tst_software_shapes.cpp
+DEFINES += SRCDIR=\\\"$$PWD/\\\"
+
+OTHER_FILES += Shapes.qml
@@ -0,0 +1,150 @@
+/*
+ * Copyright 2016 Canonical Ltd.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU Lesser General Public License as published by
+ * the Free Software Foundation; version 3.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <QtQml/QQmlEngine>
+#include <QtQuick/QQuickItem>
+#include <QtQuick/QQuickView>
+#include <QtQuick/QSGRendererInterface>
+#include <QtTest/QtTest>
+
+#include <UbuntuToolkit/private/softwareshapes_p.h>
+
+UT_USE_NAMESPACE
+
+class tst_SoftwareShapes : public QObject
+{
+    Q_OBJECT
+
+private:
+    QQuickView *view;
+
+    bool renderFrame()
+    {
+        QSignalSpy spy(view, SIGNAL(frameSwapped()));
+        view->update();
+        return spy.wait(5000);
+    }
+
+    QQuickItem *item(const QString &objectName)
+    {
+        return view->rootObject()->findChild<QQuickItem*>(objectName);
+    }
+
+private Q_SLOTS:
+    void initTestCase()
+    {
+        QString modules(UBUNTU_QML_IMPORT_PATH);
+        QVERIFY(QDir(modules).exists());
+
+        QQuickWindow::setSceneGraphBackend(QSGRendererInterface::Software);
+
+        view = new QQuickView;
+        QStringList imports = view->engine()->importPathList();
+        imports.prepend(QDir(modules).absolutePath());
+        view->engine()->setImportPathList(imports);
+        view->show();
+        QVERIFY(QTest::qWaitForWindowExposed(view));
+        QCOMPARE(view->rendererInterface()->graphicsApi(), QSGRendererInterface::Software);
+    }
+
+    void cleanupTestCase()
+    {
+        delete view;
+    }
+
+    // Loads the shapes in an empty cache.
+    void init()
+    {
+        view->setSource(QUrl());
+        clearSoftwareShapeCache();
+        view->setSource(QUrl::fromLocalFile(SRCDIR "Shapes.qml"));
+        QVERIFY(view->rootObject());
+        QVERIFY(renderFrame());
+    }
+
+    void test_shapes_rasterized_once()
+    {
+        // The identical shapes share the same image, the overlay and the frame have their own.
+        const SoftwareShapeCacheStatistics statistics = softwareShapeCacheStatistics();
+        QCOMPARE(statistics.misses, 3);
+        QCOMPARE(statistics.hits, 1);
+
+        // Rendering unchanged shapes doesn't go through the cache.
+        QVERIFY(renderFrame());
+        QCOMPARE(softwareShapeCacheStatistics().misses, 3);
+        QCOMPARE(softwareShapeCacheStatistics().hits, 1);
+    }
+
+    void test_property_changes_data()
+    {
+        QTest::addColumn<QString>("objectName");
+        QTest::addColumn<QString>("property");
+        QTest::addColumn<QVariant>("value");
+        QTest::addColumn<int>("misses");
+
+        QTest::newRow("shape color") << "shape" << "backgroundColor"
+            << QVariant(QColor("green")) << 1;
+        QTest::newRow("shape size") << "shape" << "width" << QVariant(60.0) << 1;
+        QTest::newRow("shape position") << "shape" << "x" << QVariant(20.0) << 0;
+        QTest::newRow("shape opacity") << "shape" << "opacity" << QVariant(0.5) << 0;
+        QTest::newRow("overlay color") << "overlay" << "overlayColor"
+            << QVariant(QColor("yellow")) << 1;
+        QTest::newRow("overlay rectangle") << "overlay" << "overlayRect"
+            << QVariant(QRectF(0.0, 0.0, 1.0, 1.0)) << 1;
+        QTest::newRow("frame thickness") << "frame" << "thickness" << QVariant(8.0) << 1;
+        QTest::newRow("frame radius") << "frame" << "radius" << QVariant(5.0) << 1;
+        QTest::newRow("frame color") << "frame" << "color" << QVariant(QColor("white")) << 1;
+        QTest::newRow("frame position") << "frame" << "y" << QVariant(100.0) << 0;
+    }
+    void test_property_changes()
+    {
+        QFETCH(QString, objectName);
+        QFETCH(QString, property);
+        QFETCH(QVariant, value);
+        QFETCH(int, misses);
+
+        QQuickItem *shape = item(objectName);
+        QVERIFY(shape);
+        const SoftwareShapeCacheStatistics before = softwareShapeCacheStatistics();
+        QVERIFY(shape->setProperty(qPrintable(property), value));
+        QVERIFY(renderFrame());
+        const SoftwareShapeCacheStatistics after = softwareShapeCacheStatistics();
+        QCOMPARE(after.misses - before.misses, misses);
+        QCOMPARE(after.hits, before.hits);
+    }
+
+    void test_reverted_change_hits_cache()
+    {
+        QQuickItem *shape = item("identicalShape");
+        QVERIFY(shape);
+        const QVariant color = shape->property("backgroundColor");
+
+        shape->setProperty("backgroundColor", QColor("green"));
+        QVERIFY(renderFrame());
+        QCOMPARE(softwareShapeCacheStatistics().misses, 4);
+        QCOMPARE(softwareShapeCacheStatistics().hits, 1);
+
+        // The image of the original color is still used by the other shape.
+        shape->setProperty("backgroundColor", color);
+        QVERIFY(renderFrame());
+        QCOMPARE(softwareShapeCacheStatistics().misses, 4);
+        QCOMPARE(softwareShapeCacheStatistics().hits, 2);
+    }
+};
+
+QTEST_MAIN(tst_SoftwareShapes)
+
+#include "tst_software_shapes.moc"
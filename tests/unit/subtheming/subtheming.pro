@@ -10,6 +10,7 @@ OTHER_FILES += \
     themes/CustomTheme/parent_theme \
     themes/TestModule/TestTheme/1.2/TestStyle.qml \
     themes/TestModule/TestTheme/1.3/TestStyle.qml \
+    themes/TestModule/TestTheme/1.3/BrokenStyle.qml \
     themes/TestModule/TestTheme/qmldir \
     themes/TestModule/TestTheme/parent_theme \
     DynamicAssignment.qml \
@@ -17,6 +18,7 @@ OTHER_FILES += \
     TestMain.qml \
     TestStyleChange.qml \
     DifferentThemes.qml \
+    NestedSubthemes.qml \
     SameNamedPaletteSettings.qml \
     ChangePaletteValueWhenParentChanges.qml \
     ChangeDefaultPaletteInChildren.qml \
@@ -48,6 +50,7 @@ OTHER_FILES += \
     DefaultTheme.qml \
     themes/DerivedTheme/parent_theme \
     themes/DerivedTheme/1.2/TestStyle.qml \
-    themes/DerivedTheme/1.3/Palette.qml
+    themes/DerivedTheme/1.3/Palette.qml \
+    SharedStyles.qml
 
 
@@ -91,6 +91,13 @@ private:
     QString m_xdgDataPath;
     QString m_themesPath;
 
+    static bool writeFile(const QString &path, const QByteArray &content = QByteArray())
+    {
+        QDir().mkpath(QFileInfo(path).absolutePath());
+        QFile file(path);
+        return file.open(QIODevice::WriteOnly) && file.write(content) == content.size();
+    }
+
 private Q_SLOTS:
     void initTestCase()
     {
@@ -403,6 +410,65 @@ private Q_SLOTS:
         QCOMPARE(styled->getTheme()->name(), QString("Ubuntu.Components.Themes.SuruDark"));
     }
 
+    // a name change reloads the palette and each themed item once, right away
+    void test_theme_name_change_reloads_once()
+    {
+        QScopedPointer<ThemeTestCase> view(new ThemeTestCase("TestMain.qml"));
+        UCTheme *theme = view->globalTheme();
+        QVERIFY(theme);
+        QSignalSpy paletteSpy(theme, SIGNAL(paletteChanged()));
+        QSignalSpy themeChangeSpy(view->rootObject(), SIGNAL(themeChanged()));
+        QSignalSpy secondLevelSpy(view->findItem<UCStyledItemBase*>("secondLevelStyled"),
+                                  SIGNAL(themeChanged()));
+        theme->setName("Ubuntu.Components.Themes.SuruDark");
+        QCOMPARE(themeChangeSpy.count(), 1);
+        QCOMPARE(secondLevelSpy.count(), 1);
+        QCOMPARE(paletteSpy.count(), 1);
+
+        theme->setName("Ubuntu.Components.Themes.Ambiance");
+        QCOMPARE(themeChangeSpy.count(), 2);
+        QCOMPARE(secondLevelSpy.count(), 2);
+        QCOMPARE(paletteSpy.count(), 2);
+    }
+
+    // nested subthemes sharing the parent theme or having their own are reloaded once
+    void test_nested_subthemes_reload_once()
+    {
+        QScopedPointer<ThemeTestCase> view(new ThemeTestCase("NestedSubthemes.qml"));
+        UCTheme *theme = view->globalTheme();
+        QVERIFY(theme);
+        UCStyledItemBase *shared = view->findItem<UCStyledItemBase*>("sharedStyled");
+        UCStyledItemBase *subthemed = view->findItem<UCStyledItemBase*>("subthemedStyled");
+        UCStyledItemBase *nested = view->findItem<UCStyledItemBase*>("nestedStyled");
+        UCStyledItemBase *nestedShared = view->findItem<UCStyledItemBase*>("nestedSharedStyled");
+        QCOMPARE(shared->getTheme(), theme);
+        QVERIFY(subthemed->getTheme() != theme);
+        QVERIFY(nested->getTheme() != theme);
+        QVERIFY(nested->getTheme() != subthemed->getTheme());
+        QCOMPARE(nestedShared->getTheme(), subthemed->getTheme());
+
+        QSignalSpy sharedSpy(shared, SIGNAL(themeChanged()));
+        QSignalSpy subthemedSpy(subthemed, SIGNAL(themeChanged()));
+        QSignalSpy nestedSpy(nested, SIGNAL(themeChanged()));
+        QSignalSpy nestedSharedSpy(nestedShared, SIGNAL(themeChanged()));
+
+        // the subthemes follow the name of their parent
+        theme->setName("Ubuntu.Components.Themes.SuruDark");
+        QCOMPARE(subthemed->getTheme()->name(), QString("Ubuntu.Components.Themes.SuruDark"));
+        QCOMPARE(nested->getTheme()->name(), QString("Ubuntu.Components.Themes.SuruDark"));
+        QCOMPARE(sharedSpy.count(), 1);
+        QCOMPARE(subthemedSpy.count(), 1);
+        QCOMPARE(nestedSpy.count(), 1);
+        QCOMPARE(nestedSharedSpy.count(), 1);
+
+        // renaming a subtheme doesn't reload the items of the parent theme
+        subthemed->getTheme()->setName("Ubuntu.Components.Themes.Ambiance");
+        QCOMPARE(sharedSpy.count(), 1);
+        QCOMPARE(subthemedSpy.count(), 2);
+        QCOMPARE(nestedSpy.count(), 2);
+        QCOMPARE(nestedSharedSpy.count(), 2);
+    }
+
     // changing StyledItem.theme.name for different items within a tree where
     // no sub-theming si applied
     void test_set_styleditem_theme_name_data()
@@ -754,6 +820,138 @@ private Q_SLOTS:
         QScopedPointer<ThemeTestCase> view(new ThemeTestCase("DeprecatedTheme.qml"));
     }
 
+    // style URLs are resolved once per theme paths update, from a listing of the theme folders
+    void test_style_url_memoized()
+    {
+        QTemporaryDir themes;
+        QVERIFY(themes.isValid());
+        const QString theme = themes.filePath("MemoizedTheme/");
+        QVERIFY(writeFile(theme + "1.3/TestStyle.qml"));
+        QVERIFY(writeFile(theme + "1.3/RemovedStyle.qml"));
+        QVERIFY(writeFile(theme + "1.2/OlderStyle.qml"));
+        QVERIFY(writeFile(theme + "qmldir"));
+        QVERIFY(writeFile(themes.filePath("OtherTheme/1.3/TestStyle.qml")));
+        qputenv("UBUNTU_UI_TOOLKIT_THEMES_PATH", themes.path().toLocal8Bit());
+
+        UCTheme ucTheme;
+        ucTheme.setName("MemoizedTheme");
+        bool fallback = true;
+        QUrl url = ucTheme.styleUrl("TestStyle.qml", BUILD_VERSION(1, 3), &fallback);
+        QCOMPARE(url, QUrl::fromLocalFile(theme + "1.3/TestStyle.qml"));
+        QVERIFY(!fallback);
+
+        // the resolved URLs are kept, the files aren't checked again
+        QVERIFY(!ucTheme.styleUrl("RemovedStyle.qml", BUILD_VERSION(1, 3)).isEmpty());
+        QVERIFY(QFile::remove(theme + "1.3/RemovedStyle.qml"));
+        QVERIFY(!ucTheme.styleUrl("RemovedStyle.qml", BUILD_VERSION(1, 3)).isEmpty());
+        QCOMPARE(ucTheme.m_styleUrls.size(), 2);
+
+        // styles of older versions of shared themes are flagged as fallbacks, cached ones too
+        for (int i = 0; i < 2; i++) {
+            fallback = false;
+            url = ucTheme.styleUrl("OlderStyle.qml", BUILD_VERSION(1, 3), &fallback);
+            QCOMPARE(url, QUrl::fromLocalFile(theme + "1.2/OlderStyle.qml"));
+            QVERIFY(fallback);
+        }
+
+        // styles added after the theme folder has been listed are found once the theme paths
+        // are updated again, file system time stamps are coarse though
+        QTest::qSleep(50);
+        QVERIFY(writeFile(theme + "1.3/AddedStyle.qml"));
+        QVERIFY(ucTheme.styleUrl("AddedStyle.qml", BUILD_VERSION(1, 3)).isEmpty());
+        ucTheme.setName("OtherTheme");
+        QVERIFY(ucTheme.m_styleUrls.isEmpty());
+        ucTheme.setName("MemoizedTheme");
+        QCOMPARE(ucTheme.styleUrl("AddedStyle.qml", BUILD_VERSION(1, 3)),
+                 QUrl::fromLocalFile(theme + "1.3/AddedStyle.qml"));
+        QVERIFY(ucTheme.styleUrl("RemovedStyle.qml", BUILD_VERSION(1, 3)).isEmpty());
+    }
+
+    // deprecated themes provide non-versioned styles at the root of the theme folder
+    void test_style_url_of_deprecated_theme()
+    {
+        QTemporaryDir themes;
+        QVERIFY(themes.isValid());
+        const QString theme = themes.filePath("DeprecatedMemoizedTheme/");
+        QVERIFY(writeFile(theme + "TestStyle.qml"));
+        QVERIFY(writeFile(theme + "deprecated"));
+        QVERIFY(writeFile(theme + "Styles/IgnoredStyle.qml"));
+        qputenv("UBUNTU_UI_TOOLKIT_THEMES_PATH", themes.path().toLocal8Bit());
+
+        UCTheme ucTheme;
+        ucTheme.setName("DeprecatedMemoizedTheme");
+        bool fallback = true;
+        QCOMPARE(ucTheme.styleUrl("TestStyle.qml", BUILD_VERSION(1, 3), &fallback),
+                 QUrl::fromLocalFile(theme + "TestStyle.qml"));
+        QVERIFY(!fallback);
+        QCOMPARE(ucTheme.styleUrl("TestStyle.qml", BUILD_VERSION(1, 2), &fallback),
+                 QUrl::fromLocalFile(theme + "TestStyle.qml"));
+        // only the version folders are listed
+        QVERIFY(ucTheme.styleUrl("Styles/IgnoredStyle.qml", BUILD_VERSION(1, 3)).isEmpty());
+    }
+
+    // the styled items using the same style share the style component of the theme
+    void test_shared_style_component()
+    {
+        qputenv("UBUNTU_UI_TOOLKIT_THEMES_PATH", "");
+        qputenv("XDG_DATA_DIRS", "./themes:./themes/TestModule");
+        QScopedPointer<ThemeTestCase> view(new ThemeTestCase("SharedStyles.qml"));
+        UCStyledItemBase *first = view->findItem<UCStyledItemBase*>("firstStyled");
+        UCStyledItemBase *second = view->findItem<UCStyledItemBase*>("secondStyled");
+        QPointer<QQmlComponent> component = UCStyledItemBasePrivate::get(first)->sharedStyleComponent;
+        QVERIFY(component);
+        QCOMPARE(UCStyledItemBasePrivate::get(second)->sharedStyleComponent.data(), component.data());
+        QVERIFY(first->findChild<QQuickItem*>("TestStyle"));
+        QVERIFY(second->findChild<QQuickItem*>("TestStyle"));
+
+        // the component is deleted together with its last styled item
+        delete first;
+        QVERIFY(component);
+        delete second;
+        QVERIFY(!component);
+    }
+
+    void test_shared_style_component_released_when_theme_changes()
+    {
+        qputenv("UBUNTU_UI_TOOLKIT_THEMES_PATH", "");
+        qputenv("XDG_DATA_DIRS", "./themes:./themes/TestModule");
+        QScopedPointer<ThemeTestCase> view(new ThemeTestCase("SharedStyles.qml"));
+        UCStyledItemBase *first = view->findItem<UCStyledItemBase*>("firstStyled");
+        UCStyledItemBase *second = view->findItem<UCStyledItemBase*>("secondStyled");
+        QPointer<QQmlComponent> component = UCStyledItemBasePrivate::get(first)->sharedStyleComponent;
+        QVERIFY(component);
+
+        first->getTheme()->setName("CustomTheme");
+        QVERIFY(!component);
+        component = UCStyledItemBasePrivate::get(first)->sharedStyleComponent;
+        QVERIFY(component);
+        QCOMPARE(UCStyledItemBasePrivate::get(second)->sharedStyleComponent.data(), component.data());
+        QVERIFY(component->url().path().endsWith("CustomTheme/1.3/TestStyle.qml"));
+    }
+
+    // failing style components are not shared, each styled item reports the error
+    void test_shared_style_component_error()
+    {
+        qputenv("UBUNTU_UI_TOOLKIT_THEMES_PATH", "");
+        qputenv("XDG_DATA_DIRS", "./themes:./themes/TestModule");
+        QScopedPointer<ThemeTestCase> view(new ThemeTestCase("SharedStyles.qml"));
+        UCStyledItemBase *first = view->findItem<UCStyledItemBase*>("firstStyled");
+        UCStyledItemBase *second = view->findItem<UCStyledItemBase*>("secondStyled");
+        QPointer<QQmlComponent> component = UCStyledItemBasePrivate::get(first)->sharedStyleComponent;
+        QVERIFY(component);
+
+        const QRegularExpression error("BrokenStyle\\.qml:\\d+ Cannot assign to non-existent property");
+        QTest::ignoreMessage(QtWarningMsg, error);
+        first->setProperty("styleName", "BrokenStyle");
+        QTest::ignoreMessage(QtWarningMsg, error);
+        second->setProperty("styleName", "BrokenStyle");
+        QVERIFY(!component);
+        QVERIFY(!UCStyledItemBasePrivate::get(first)->sharedStyleComponent);
+        QVERIFY(!UCStyledItemBasePrivate::get(second)->sharedStyleComponent);
+        QVERIFY(!UCStyledItemBasePrivate::get(first)->styleInstance());
+        QVERIFY(!UCStyledItemBasePrivate::get(second)->styleInstance());
+    }
+
     void test_style_change_has_precedence()
     {
         QScopedPointer<ThemeTestCase> view(new ThemeTestCase("StyleOverride.qml"));
@@ -16,10 +16,109 @@
  * Author: Florian Boucault <florian.boucault@canonical.com>
  */
 
+#include <QtGui/QOffscreenSurface>
+#include <QtGui/QOpenGLContext>
+#if !defined(QT_OPENGL_ES_2)
+#include <QtGui/QOpenGLFunctions_1_1>
+#endif
+#include <QtQml/QQmlComponent>
 #include <QtQml/QQmlEngine>
+#include <QtQuick/QSGRendererInterface>
+#include <QtQuick/QSGTextureProvider>
 #include <QtQuick/QQuickView>
 #include <QtTest/QtTest>
 
+#include <UbuntuToolkit/private/ucubuntushape_p.h>
+
+#ifndef GL_TEXTURE_BASE_LEVEL
+#define GL_TEXTURE_BASE_LEVEL 0x813C
+#endif
+
+UT_USE_NAMESPACE
+
+// Counts the geometry and color updates of the shape and stores its vertices. The updates happen
+// at synchronization, while the GUI thread is blocked.
+class UpdateTrackingShape : public UCUbuntuShape
+{
+public:
+    UpdateTrackingShape() : geometryUpdates(0), colorUpdates(0) {}
+
+    int geometryUpdates;
+    int colorUpdates;
+    QByteArray vertices;
+
+protected:
+    void updateGeometry(
+        QSGNode *node, const QSizeF &itemSize, float radius, float shapeOffset,
+        const QVector4D &sourceCoordTransform, const QVector4D &sourceMaskTransform,
+        const quint32 backgroundColor[3]) override
+    {
+        UCUbuntuShape::updateGeometry(node, itemSize, radius, shapeOffset, sourceCoordTransform,
+                                      sourceMaskTransform, backgroundColor);
+        geometryUpdates++;
+        storeVertices(node);
+    }
+
+    void updateColors(QSGNode *node, const quint32 backgroundColor[3]) override
+    {
+        UCUbuntuShape::updateColors(node, backgroundColor);
+        colorUpdates++;
+        storeVertices(node);
+    }
+
+private:
+    void storeVertices(QSGNode *node)
+    {
+        const QSGGeometry *geometry = static_cast<ShapeNode*>(node)->geometry();
+        vertices = QByteArray(static_cast<const char*>(geometry->vertexData()),
+                              geometry->vertexCount() * geometry->sizeOfVertex());
+    }
+};
+
+// Stores the material of the shape node, updated at synchronization.
+class MaterialTrackingShape : public UCUbuntuShape
+{
+public:
+    MaterialTrackingShape() : material(nullptr) {}
+
+    ShapeMaterial *material;
+
+protected:
+    QSGNode *updatePaintNode(QSGNode *oldNode, UpdatePaintNodeData *data) override
+    {
+        QSGNode *node = UCUbuntuShape::updatePaintNode(oldNode, data);
+        const bool openGL =
+            window()->rendererInterface()->graphicsApi() == QSGRendererInterface::OpenGL;
+        material = node && openGL ? static_cast<ShapeNode*>(node)->material() : nullptr;
+        return node;
+    }
+};
+
+class FakeTexture : public QSGTexture
+{
+public:
+    FakeTexture(int id) : m_id(id) {}
+    int textureId() const override { return m_id; }
+    QSize textureSize() const override { return QSize(1, 1); }
+    bool hasAlphaChannel() const override { return false; }
+    bool hasMipmaps() const override { return false; }
+    void bind() override {}
+
+private:
+    int m_id;
+};
+
+class FakeTextureProvider : public QSGTextureProvider
+{
+public:
+    FakeTextureProvider(int id) : m_texture(id) {}
+    QSGTexture *texture() const override { return const_cast<FakeTexture*>(&m_texture); }
+    FakeTexture *fakeTexture() { return &m_texture; }
+
+private:
+    FakeTexture m_texture;
+};
+
 class tst_UbuntuShape: public QObject
 {
     Q_OBJECT
@@ -27,10 +126,46 @@ class tst_UbuntuShape: public QObject
 private:
     QQuickView *m_quickView;
 
+    bool renderFrame()
+    {
+        QSignalSpy spy(m_quickView, SIGNAL(frameSwapped()));
+        m_quickView->update();
+        return spy.wait(5000);
+    }
+
+    static QUrl saveImage(const QTemporaryDir &dir, const QString &name, const QColor &color,
+                          int size)
+    {
+        QImage image(size, size, QImage::Format_ARGB32_Premultiplied);
+        image.fill(color);
+        const QString path = dir.filePath(name);
+        return image.save(path) ? QUrl::fromLocalFile(path) : QUrl();
+    }
+
+#if !defined(QT_OPENGL_ES_2)
+    static int textureLevelWidth(QOpenGLFunctions_1_1 *functions, int level)
+    {
+        GLint width = 0;
+        functions->glGetTexLevelParameteriv(GL_TEXTURE_2D, level, GL_TEXTURE_WIDTH, &width);
+        return width;
+    }
+
+    static int textureBaseLevel(QOpenGLFunctions_1_1 *functions)
+    {
+        GLint baseLevel = -1;
+        functions->glGetTexParameteriv(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, &baseLevel);
+        return baseLevel;
+    }
+#endif
+
 private Q_SLOTS:
 
     void initTestCase()
     {
+        // Distance fields are used by default, the mipmap tests need the shape textures to be
+        // mipmapped.
+        qputenv("UC_SHAPE_MIPMAPS", "1");
+
         m_quickView = new QQuickView;
         m_quickView->setGeometry(0, 0, 900, 500);
         m_quickView->show();
@@ -56,6 +191,272 @@ private Q_SLOTS:
 
         QCOMPARE(result, expected);
     }
+
+    void colorChangeKeepsGeometry()
+    {
+        UpdateTrackingShape shape;
+        shape.setSize(QSizeF(100.0, 100.0));
+        shape.setBackgroundColor(Qt::red);
+        shape.setParentItem(m_quickView->contentItem());
+        if (!renderFrame()) {
+            QSKIP("The scene graph can't be rendered");
+        }
+        QCOMPARE(shape.geometryUpdates, 1);
+        QCOMPARE(shape.colorUpdates, 0);
+
+        // Color only changes don't update the rest of the geometry.
+        shape.setBackgroundColor(Qt::blue);
+        QVERIFY(renderFrame());
+        QCOMPARE(shape.geometryUpdates, 1);
+        QCOMPARE(shape.colorUpdates, 1);
+
+        // The vertices are the same as the ones of a shape created with the new color.
+        UpdateTrackingShape reference;
+        reference.setSize(QSizeF(100.0, 100.0));
+        reference.setBackgroundColor(Qt::blue);
+        reference.setParentItem(m_quickView->contentItem());
+        QVERIFY(renderFrame());
+        QCOMPARE(reference.geometryUpdates, 1);
+        QVERIFY(!shape.vertices.isEmpty());
+        QCOMPARE(shape.vertices, reference.vertices);
+
+        // Size changes still update the whole geometry.
+        shape.setWidth(120.0);
+        QVERIFY(renderFrame());
+        QCOMPARE(shape.geometryUpdates, 2);
+        QCOMPARE(shape.colorUpdates, 1);
+    }
+
+    // Shapes showing images of the same atlas are batched, as long as their sources aren't
+    // repeated and are filtered the same way.
+    void atlasBatching()
+    {
+        enum { Red, Green, Large, Nearest, RepeatedRed, RepeatedGreen, ShapeCount };
+        QTemporaryDir dir;
+        QVERIFY(dir.isValid());
+        const QUrl red = saveImage(dir, "red.png", Qt::red, 32);
+        const QUrl green = saveImage(dir, "green.png", Qt::green, 32);
+        const QUrl sources[ShapeCount] = {
+            red, green, saveImage(dir, "large.png", Qt::blue, 1024),
+            saveImage(dir, "nearest.png", Qt::gray, 32), red, green
+        };
+        QQmlComponent component(m_quickView->engine());
+        component.setData("import QtQuick 2.4\nImage {}", QUrl());
+
+        MaterialTrackingShape shapes[ShapeCount];
+        for (int i = 0; i < ShapeCount; i++) {
+            QQuickItem *image = qobject_cast<QQuickItem*>(component.create());
+            QVERIFY(image);
+            image->setParent(&shapes[i]);
+            image->setProperty("smooth", i != Nearest);
+            image->setProperty("source", sources[i]);
+            shapes[i].setSize(QSizeF(50.0, 50.0));
+            shapes[i].setX(i * 60.0);
+            shapes[i].setSource(QVariant::fromValue<QObject*>(image));
+            if (i == RepeatedRed || i == RepeatedGreen) {
+                shapes[i].setSourceHorizontalWrapMode(UCUbuntuShape::Repeat);
+            }
+            shapes[i].setParentItem(m_quickView->contentItem());
+        }
+
+        // Materials are compared on the render thread, the way the renderer does.
+        bool compared = false;
+        bool sameAtlas = false;
+        int compareResults[ShapeCount];
+        QMetaObject::Connection connection = connect(
+            m_quickView, &QQuickWindow::afterRendering, m_quickView, [&]() {
+                for (int i = 0; i < ShapeCount; i++) {
+                    if (!shapes[i].material) {
+                        return;
+                    }
+                }
+                const ShapeMaterial::Data *redData = shapes[Red].material->constData();
+                const ShapeMaterial::Data *greenData = shapes[Green].material->constData();
+                QSGTexture *redTexture = redData->sourceTextureProvider->texture();
+                QSGTexture *greenTexture = greenData->sourceTextureProvider->texture();
+                sameAtlas = redTexture && greenTexture && redTexture->isAtlasTexture()
+                    && greenTexture->isAtlasTexture()
+                    && redTexture->textureId() == greenTexture->textureId();
+                for (int i = 0; i < ShapeCount; i++) {
+                    compareResults[i] = shapes[Green].material->compare(shapes[i].material);
+                }
+                compareResults[RepeatedRed] =
+                    shapes[RepeatedRed].material->compare(shapes[RepeatedGreen].material);
+                compared = true;
+            }, Qt::DirectConnection);
+        const bool rendered = renderFrame();
+        disconnect(connection);
+        if (!rendered) {
+            QSKIP("The scene graph can't be rendered");
+        }
+        QVERIFY(compared);
+        if (!sameAtlas) {
+            QSKIP("The images aren't stored in the same atlas");
+        }
+        QCOMPARE(compareResults[Red], 0);
+        QCOMPARE(compareResults[Green], 0);
+        QVERIFY(compareResults[Large] != 0);
+        QVERIFY(compareResults[Nearest] != 0);
+        QVERIFY(compareResults[RepeatedGreen] != 0);
+        QVERIFY(compareResults[RepeatedRed] != 0);
+    }
+
+    void compareSourceTextures()
+    {
+        QOpenGLContext context;
+        if (!context.create()) {
+            QSKIP("This test requires an OpenGL context");
+        }
+        QOffscreenSurface surface;
+        surface.setFormat(context.format());
+        surface.create();
+        QVERIFY(context.makeCurrent(&surface));
+
+        {
+            FakeTextureProvider layer(0);
+            FakeTextureProvider otherLayer(0);
+            FakeTextureProvider atlasImage(1);
+            FakeTextureProvider otherAtlasImage(1);
+            FakeTextureProvider image(2);
+            ShapeMaterial material;
+            ShapeMaterial otherMaterial;
+            material.data()->flags = ShapeMaterial::Data::Textured;
+            otherMaterial.data()->flags = ShapeMaterial::Data::Textured;
+
+            // Textures without an id can't be told apart, their providers are compared.
+            material.data()->sourceTextureProvider = &layer;
+            otherMaterial.data()->sourceTextureProvider = &otherLayer;
+            QVERIFY(material.compare(&otherMaterial) != 0);
+            QCOMPARE(material.compare(&otherMaterial), -otherMaterial.compare(&material));
+            otherMaterial.data()->sourceTextureProvider = &layer;
+            QCOMPARE(material.compare(&otherMaterial), 0);
+            otherMaterial.data()->sourceTextureProvider = &atlasImage;
+            QVERIFY(material.compare(&otherMaterial) != 0);
+
+            // Different providers of the same texture are batched.
+            material.data()->sourceTextureProvider = &atlasImage;
+            otherMaterial.data()->sourceTextureProvider = &otherAtlasImage;
+            QCOMPARE(material.compare(&otherMaterial), 0);
+            otherAtlasImage.fakeTexture()->setFiltering(QSGTexture::Nearest);
+            QVERIFY(material.compare(&otherMaterial) != 0);
+            otherMaterial.data()->sourceTextureProvider = &image;
+            QVERIFY(material.compare(&otherMaterial) != 0);
+            QCOMPARE(material.compare(&otherMaterial), -otherMaterial.compare(&material));
+
+            // Repeated sources are never batched.
+            material.data()->flags |= ShapeMaterial::Data::HorizontallyRepeated;
+            otherMaterial.data()->flags |= ShapeMaterial::Data::HorizontallyRepeated;
+            otherMaterial.data()->sourceTextureProvider = &atlasImage;
+            QVERIFY(material.compare(&otherMaterial) != 0);
+        }
+
+        context.doneCurrent();
+    }
+
+    void mipmapLevelSelection_data()
+    {
+        QTest::addColumn<float>("physicalRadius");
+        QTest::addColumn<int>("level");
+
+        // The level sampled is log2(shapeTextureMipmapWidth / radius), the finer one is needed.
+        QTest::newRow("larger than the texture") << 512.0f << 0;
+        QTest::newRow("texture size") << 256.0f << 0;
+        QTest::newRow("half the texture size") << 128.0f << 0;
+        QTest::newRow("quarter of the texture size") << 64.0f << 1;
+        QTest::newRow("between two levels") << 40.0f << 1;
+        QTest::newRow("4 pixels") << 4.0f << 5;
+        QTest::newRow("1 pixel") << 1.0f << 7;
+        QTest::newRow("less than 1 pixel") << 0.5f << 7;
+    }
+    void mipmapLevelSelection()
+    {
+        QFETCH(float, physicalRadius);
+        QFETCH(int, level);
+
+        QCOMPARE(ShapeMaterial::shapeTextureLevel(physicalRadius), level);
+    }
+
+    void lazyMipmapUpload()
+    {
+#if defined(QT_OPENGL_ES_2)
+        QSKIP("The mipmap levels can't be read back with OpenGL ES 2");
+#else
+        QOpenGLContext context;
+        if (!context.create() || context.isOpenGLES()) {
+            QSKIP("This test requires a desktop OpenGL context");
+        }
+        QOffscreenSurface surface;
+        surface.setFormat(context.format());
+        surface.create();
+        QVERIFY(context.makeCurrent(&surface));
+        QOpenGLFunctions_1_1 *functions = context.versionFunctions<QOpenGLFunctions_1_1>();
+        QVERIFY(functions && functions->initializeOpenGLFunctions());
+        QVERIFY(!UCUbuntuShape::useDistanceFields(&context));
+
+        {
+            ShapeMaterial material;
+
+            // Nothing is uploaded until a shape is rendered.
+            QCOMPARE(static_cast<int>(material.shapeTextureBaseLevel(0)),
+                     shapeTextureMipmapCount);
+            functions->glBindTexture(GL_TEXTURE_2D, material.textureIds()[0]);
+            QCOMPARE(textureLevelWidth(functions, shapeTextureMipmapCount - 1), 0);
+
+            // Small shapes only upload the coarse levels and restrict the sampling to them.
+            const int coarseLevel = ShapeMaterial::shapeTextureLevel(4.0f);
+            material.updateShapeTexture(0, 4.0f);
+            QCOMPARE(static_cast<int>(material.shapeTextureBaseLevel(0)), coarseLevel);
+            QCOMPARE(static_cast<int>(material.shapeTextureBaseLevel(1)),
+                     shapeTextureMipmapCount);
+            functions->glBindTexture(GL_TEXTURE_2D, material.textureIds()[0]);
+            QCOMPARE(textureBaseLevel(functions), coarseLevel);
+            QCOMPARE(textureLevelWidth(functions, coarseLevel - 1), 0);
+            for (int i = coarseLevel; i < shapeTextureMipmapCount; i++) {
+                QCOMPARE(textureLevelWidth(functions, i), shapeTextureMipmapWidth >> i);
+            }
+
+            // Smaller shapes don't need more levels.
+            material.updateShapeTexture(0, 2.0f);
+            QCOMPARE(static_cast<int>(material.shapeTextureBaseLevel(0)), coarseLevel);
+
+            // Large shapes upload the missing finer levels.
+            material.updateShapeTexture(0, 128.0f);
+            QCOMPARE(static_cast<int>(material.shapeTextureBaseLevel(0)), 0);
+            functions->glBindTexture(GL_TEXTURE_2D, material.textureIds()[0]);
+            QCOMPARE(textureBaseLevel(functions), 0);
+            QCOMPARE(textureLevelWidth(functions, 0), shapeTextureMipmapWidth);
+
+            // Levels are generated from the finer one with a box filter.
+            const int width = shapeTextureMipmapWidth;
+            const int height = shapeTextureMipmapHeight;
+            QByteArray level0(width * height * 4, 0);
+            QByteArray level1((width / 2) * (height / 2) * 4, 0);
+            functions->glPixelStorei(GL_PACK_ALIGNMENT, 1);
+            functions->glGetTexImage(GL_TEXTURE_2D, 0, GL_RGBA, GL_UNSIGNED_BYTE, level0.data());
+            functions->glGetTexImage(GL_TEXTURE_2D, 1, GL_RGBA, GL_UNSIGNED_BYTE, level1.data());
+            const uchar *src = reinterpret_cast<const uchar*>(level0.constData());
+            const uchar *dst = reinterpret_cast<const uchar*>(level1.constData());
+            for (int y = 0; y < height / 2; y++) {
+                for (int x = 0; x < width / 2; x++) {
+                    for (int c = 0; c < 4; c++) {
+                        const int i = ((2 * y) * width + 2 * x) * 4 + c;
+                        const int expected = (src[i] + src[i + 4] + src[i + width * 4]
+                                              + src[i + width * 4 + 4] + 2) >> 2;
+                        QCOMPARE(static_cast<int>(dst[(y * (width / 2) + x) * 4 + c]), expected);
+                    }
+                }
+            }
+            functions->glBindTexture(GL_TEXTURE_2D, 0);
+
+            // Materials of the same share group share the uploaded levels.
+            ShapeMaterial otherMaterial;
+            QCOMPARE(otherMaterial.textureIds()[0], material.textureIds()[0]);
+            QCOMPARE(static_cast<int>(otherMaterial.shapeTextureBaseLevel(0)), 0);
+        }
+
+        context.doneCurrent();
+#endif
+    }
 };
 
 QTEST_MAIN(tst_UbuntuShape)
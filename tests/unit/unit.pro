@@ -11,12 +11,14 @@ SUBDIRS += testparser
 #######################################
 #!contains(QMAKE_HOST.arch,armv7l) {
     SUBDIRS += components \
-        components_benchmark
+        components_benchmark \
+        components_memory
 #}
 
 SUBDIRS += \
     visual \
     ubuntu_shape \
+    software_shapes \
     page \
     test \
     iconprovider \
@@ -28,17 +30,20 @@ SUBDIRS += \
     layouts \
     mousefilters \
     animator \
+    applicationmonitor \
     serviceproperties \
     subtheming \
     swipearea \
     touchregistry \
     bottomedge \
     asyncloader \
+    asyncstyles \
     custom_qpa \
     units \
     scaling_image_provider \
     qquick_image_extension \
     performance \
+    scrolling_benchmark \
     mainview11 \
     mainview13 \
 #   i18n \ FIXME: breaks xenial
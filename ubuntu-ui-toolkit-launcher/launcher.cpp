@@ -19,6 +19,7 @@
 // test cases that exhibit specific behavior.
 
 #include <iostream>
+#include <signal.h>
 #include <QtCore/qdebug.h>
 #include <QtQuick/QQuickItem>
 #include <QtQuick/QQuickView>
@@ -77,11 +78,23 @@ int main(int argc, const char *argv[])
     QCommandLineOption _metricsOverlay("metrics-overlay", "Enable the metrics overlay");
     QCommandLineOption _metricsLogging(
         "metrics-logging", "Enable metrics logging, <device> can be 'stdout', 'lttng' (Linux "
-        "only), a local or absolute filename", "device");
+        "only), a local or absolute filename, a filename prefixed by 'binary:' to log raw "
+        "events or by 'trace:' to log in the Trace Event JSON format, or 'socket' optionally "
+        "followed by ':' and a socket path to stream to ubuntu-metrics-collector", "device");
     QCommandLineOption _metricsLoggingFilter(
         "metrics-logging-filter", "Filter metrics logging, <filter> is a list of events separated "
-        "by a comma ('window', 'process', 'frame' or '*'), events not filtered are discarded",
-        "filter");
+        "by a comma ('window', 'process', 'frame', 'generic', 'summary', 'span', 'longframe' or "
+        "'*'), events not filtered are discarded", "filter");
+    QCommandLineOption _metricsFrameSummary(
+        "metrics-frame-summary", "Aggregate frame times and emit a frame summary event every "
+        "<interval> milliseconds", "interval");
+    QCommandLineOption _metricsLongFrameBudget(
+        "metrics-long-frame-budget", "Emit a long frame event attributing the overrun to a frame "
+        "phase when a frame takes more than <budget> microseconds, 0 for one and a half refresh "
+        "period", "budget");
+    QCommandLineOption _metricsFlightRecorder(
+        "metrics-flight-recorder", "Keep the last 10 seconds of events in memory and dump them "
+        "to the binary log <file> on SIGUSR2 or when the performance monitor warns", "file");
 
     args.addOption(_import);
     args.addOption(_enableTouch);
@@ -92,6 +105,9 @@ int main(int argc, const char *argv[])
     args.addOption(_metricsOverlay);
     args.addOption(_metricsLogging);
     args.addOption(_metricsLoggingFilter);
+    args.addOption(_metricsFrameSummary);
+    args.addOption(_metricsLongFrameBudget);
+    args.addOption(_metricsFlightRecorder);
     args.addPositionalArgument("filename", "Document to be viewed");
     args.setSingleDashWordOptionMode(QCommandLineParser::ParseAsLongOptions);
     args.addHelpOption();
@@ -230,6 +246,12 @@ int main(int argc, const char *argv[])
                 filter |= UMApplicationMonitor::FrameEvent;
             } else if (filterList[i] == "generic") {
                 filter |= UMApplicationMonitor::GenericEvent;
+            } else if (filterList[i] == "summary") {
+                filter |= UMApplicationMonitor::FrameSummaryEvent;
+            } else if (filterList[i] == "span") {
+                filter |= UMApplicationMonitor::SpanEvent;
+            } else if (filterList[i] == "longframe") {
+                filter |= UMApplicationMonitor::LongFrameEvent;
             }
         }
         applicationMonitor->setLoggingFilter(filter);
@@ -243,6 +265,14 @@ int main(int argc, const char *argv[])
         } else if (device == "lttng") {
             logger = new UMLTTNGLogger();
 #endif  // defined(Q_OS_LINUX)
+        } else if (device.startsWith("binary:")) {
+            logger = new UMBinaryLogger(device.mid(sizeof("binary:") - 1));
+        } else if (device.startsWith("trace:")) {
+            logger = new UMTraceEventLogger(device.mid(sizeof("trace:") - 1));
+        } else if (device == "socket") {
+            logger = new UMSocketLogger();
+        } else if (device.startsWith("socket:")) {
+            logger = new UMSocketLogger(device.mid(sizeof("socket:") - 1));
         } else {
             logger = new UMFileLogger(device);
         }
@@ -253,6 +283,18 @@ int main(int argc, const char *argv[])
             delete logger;
         }
     }
+    if (args.isSet(_metricsFrameSummary)) {
+        applicationMonitor->setUpdateInterval(
+            UMEvent::FrameSummary, args.value(_metricsFrameSummary).toInt());
+    }
+    if (args.isSet(_metricsLongFrameBudget)) {
+        applicationMonitor->setLongFrameBudget(args.value(_metricsLongFrameBudget).toInt());
+    }
+    if (args.isSet(_metricsFlightRecorder)) {
+        applicationMonitor->setFlightRecorderFile(args.value(_metricsFlightRecorder));
+        applicationMonitor->setFlightRecorderSignal(SIGUSR2);
+        applicationMonitor->setFlightRecorder(10000);
+    }
     if (args.isSet(_metricsOverlay)) {
         applicationMonitor->setOverlay(true);
     }